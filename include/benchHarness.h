@@ -0,0 +1,120 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <x86intrin.h>
+
+/* ================================================================================ */
+/* Repeated measurements of one benchmark case: warm-up runs, N timed repetitions,  */
+/* rejection of outliers by Tukey's fences and summary with 95% confidence interval  */
+/* ================================================================================ */
+
+static const int BENCH_DEFAULT_WARMUP = 2;
+static const int BENCH_DEFAULT_REPS   = 11;
+static const int BENCH_MAX_REPS       = 1000;
+/// Samples outside [Q1 - k * IQR, Q3 + k * IQR] are outliers
+static const double BENCH_OUTLIER_IQR = 1.5;
+
+/// @brief Benchmark case. Only run is timed, setup and teardown are called around every run
+typedef struct {
+    const char *scenario;
+    const char *corpus;
+
+    void    (*setup)(void *ctx);
+    int64_t (*run)(void *ctx);      ///< @return number of operations done
+    void    (*teardown)(void *ctx);
+    void    *ctx;
+} benchCase_t;
+
+typedef struct {
+    int    reps;        ///< Number of timed repetitions
+    int    outliers;    ///< Number of samples rejected as outliers
+    double median;      ///< All statistics except median and outliers are over kept samples
+    double mean;
+    double stddev;
+    double ciLow;       ///< 95% confidence interval of the mean
+    double ciHigh;
+    double min;
+    double max;
+} benchStats_t;
+
+typedef struct {
+    const benchCase_t *benchCase;
+    int64_t ops;                        ///< Operations per repetition
+    double  ticks[BENCH_MAX_REPS];      ///< Ticks per operation of every repetition
+    double  ms[BENCH_MAX_REPS];         ///< Time of every repetition
+    benchStats_t ticksStats;
+    benchStats_t msStats;
+} benchResult_t;
+
+/// @brief Pin calling thread to cpu. Negative cpu pins to the cpu thread is running on now
+/// @return cpu thread is pinned to or -1 if affinity can't be set
+int benchPinThread(int cpu);
+
+/// @brief Run warm-up and timed repetitions of benchCase
+void benchRun(const benchCase_t *benchCase, int warmup, int reps, benchResult_t *result);
+
+/// @brief Median, mean, stddev and 95% CI of samples, outliers are rejected first
+void benchComputeStats(const double *samples, int count, benchStats_t *stats);
+
+/// @brief Print header of the results table to file
+void benchPrintHeader(FILE *file);
+void benchPrintResult(FILE *file, const benchResult_t *result);
+
+/*!
+    @brief Write results as JSON: {"config": {...}, "cpu": N, "results": [...]}
+    @param configJson Object with build configuration, written as is
+    @return false if file can't be written
+*/
+bool benchWriteJson(const char *fileName, const char *configJson, int cpu,
+                    const benchResult_t *results, int count);
+
+/* ================================================================================ */
+/* Latencies of single calls: serialized rdtsc/rdtscp and log-bucketed histogram    */
+/* ================================================================================ */
+
+/// Every power of two is split into 2^LATENCY_SUB_BITS linear sub-buckets, so relative error is below 1/16
+static const int LATENCY_SUB_BITS = 4;
+/// Latencies from 2^LATENCY_MAX_BITS ticks fall into the last bucket (max is kept exactly)
+static const int LATENCY_MAX_BITS = 40;
+static const size_t LATENCY_BUCKETS = (size_t) (LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS;
+
+/// @brief HDR-style histogram: bucket width grows with value, so p99.9 and max cost the same memory as p50
+typedef struct {
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+} latencyHistogram_t;
+
+/// @brief Timestamp before measured code. lfence before rdtsc waits for preceding instructions,
+/// lfence after it keeps measured code from starting earlier
+static inline uint64_t latencyStart() {
+    _mm_lfence();
+    const uint64_t ticks = __rdtsc();
+    _mm_lfence();
+    return ticks;
+}
+
+/// @brief Timestamp after measured code. rdtscp waits for it to finish, lfence keeps next code out
+static inline uint64_t latencyStop() {
+    unsigned int cpu = 0;
+    const uint64_t ticks = __rdtscp(&cpu);
+    _mm_lfence();
+    return ticks;
+}
+
+void latencyRecord(latencyHistogram_t *hist, uint64_t ticks);
+
+/// @brief Upper bound of the bucket with given percentile (0-100) of recorded latencies, 100 gives exact max
+uint64_t latencyPercentile(const latencyHistogram_t *hist, double percentile);
+
+/// @brief Median latency of latencyStart/latencyStop pair around empty code, measured samples times
+uint64_t latencyCalibrate(int samples);
+
+void latencyPrintHeader(FILE *file);
+/// @brief Print count, mean and percentiles of hist in one row. Empty histograms are printed as dashes
+void latencyPrint(FILE *file, const char *name, const latencyHistogram_t *hist);
+
+#endif
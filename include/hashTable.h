@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/types.h>
 #include <immintrin.h>
 
 #define errprintf(...) fprintf(stderr, __VA_ARGS__)
@@ -20,9 +21,30 @@
 
 // #define HASH_TABLE_VERIFY
 
+/*! Instead of full hashTableVerify, every operation checks next VERIFY_BUDGET nodes of the table,
+    so the whole table is checked once in (size / VERIFY_BUDGET) operations (v2 only)              */
+// #define HASH_TABLE_VERIFY_INCREMENTAL
+#ifndef VERIFY_BUDGET
+#define VERIFY_BUDGET 16
+#endif
+
+/*! Counters of lookups, compares and allocations and histogram of bucket sizes (v2 only),
+    read by hashTableGetStats. Can be enabled with make STATS=1                        */
+// #define HASH_TABLE_STATS
+
+/*! Static tracepoints (USDT) of provider hashTable are compiled in when <sys/sdt.h> is found.
+    Each is a single nop until a tracer attaches. Define to remove them completely          */
+// #define HASH_TABLE_NO_PROBES
+
 /* ============================ Optimization defines ================================ */
 
-/*! Hash table architecture version. Read more in README.md */
+//! Switches in this block form a policy. Default build uses values below.
+//! Policy builds (-DHT_POLICY=<name>, see POLICIES in Makefile) get them from compiler flags,
+//! put all table types and functions into namespace <name> and can be linked side by side.
+#ifndef HT_POLICY
+
+/*! Hash table architecture version: 1 - lists, 2 - arrays of nodes, 3 - bucketized cuckoo hashing.
+    Read more in README.md */
 #define HASH_TABLE_ARCH 2
 
 /*! Uses SIMD optimized strcmp that compares strings up to SMALL_STR_LEN              */
@@ -38,15 +60,95 @@
 /*! Store short values (up to SMALL_STR_LEN bytes) in the node*/
 #define SHORT_VALUES_IN_NODE
 
+/*! Use hardware-optimized hash function                                              */
+#define FAST_CRC32
+
+/*! Sampled hits move their node one position closer to the head of the bucket       */
+// #define SELF_ORGANIZING_BUCKETS
+
+/*! Small direct-mapped cache of recently found nodes, checked before the bucket walk  */
+// #define HOT_KEY_CACHE
+
+/*! Array of buckets and arena of hashTableCompact are backed by 2 MB pages when they are
+    at least that big: reserved huge pages (MAP_HUGETLB) or transparent ones (madvise)  */
+// #define HUGE_PAGES
+
+/*! Keys of SMALL_STR_LEN..PACKED_KEY_MAX_LEN lower case letters (as left by scripts/prepareText.c) are packed
+    5 bits per letter into short key, so they are stored in the node instead of array of long keys   */
+// #define PACKED_KEYS
+
+/*! Keys are hashed by AES rounds with random per-table seed instead of unseeded crc32: colliding keys can't
+    be crafted without the seed, and all 64 bits of the hash index the buckets                            */
+// #define SEEDED_HASH
+
+#endif
+
+/*! Number of nodes stored right in the bucket, in the same cache line as its header.
+    Other nodes go to the overflow array. 0 restores plain {elements, size} buckets  */
+#ifndef BUCKET_INLINE_NODES
+    #define BUCKET_INLINE_NODES 1
+#endif
+
+/*! Overflow array with at least this many nodes is kept sorted by key and searched by bisection,
+    so a flood of colliding keys (or of long keys) costs log n comparisons. 0 keeps all arrays unsorted */
+#ifndef BUCKET_SORT_THRESHOLD
+    #define BUCKET_SORT_THRESHOLD 32
+#endif
+
+/*! Slots in bucket of cuckoo table (HASH_TABLE_ARCH 3). Keys of 4 slots fill one cache line */
+#ifndef CUCKOO_SLOTS
+    #define CUCKOO_SLOTS 4
+#endif
+
+/*! Evictions tried by cuckoo insert before homeless key goes to the stash          */
+#ifndef CUCKOO_MAX_KICKS
+    #define CUCKOO_MAX_KICKS 128
+#endif
+
+/*! Keys that found no place in both their buckets. Every lookup that misses both
+    buckets checks the stash, the table grows when it is full                        */
+#ifndef CUCKOO_STASH_SIZE
+    #define CUCKOO_STASH_SIZE 8
+#endif
+
+/*! Cuckoo table grows when this percent of slots is used: longer kick chains are not worth it */
+#ifndef CUCKOO_MAX_LOAD_PERCENT
+    #define CUCKOO_MAX_LOAD_PERCENT 90
+#endif
+
+/*! Doublings tried by cuckoo rehash when keys don't fit. More failures mean keys that collide
+    in both hashes, growing further wouldn't separate them                          */
+#ifndef CUCKOO_MAX_REHASH_GROWTH
+    #define CUCKOO_MAX_REHASH_GROWTH 4
+#endif
+
+/*! Load factor (elements per bucket) that hashTableReserve aims for                  */
+#ifndef RESERVE_LOAD_FACTOR
+    #define RESERVE_LOAD_FACTOR 1
+#endif
+
+/*! Every PROMOTE_SAMPLE_PERIOD-th hit outside the head of the bucket is promoted (power of 2)*/
+#ifndef PROMOTE_SAMPLE_PERIOD
+    #define PROMOTE_SAMPLE_PERIOD 8
+#endif
+
+/*! Number of entries in hot key cache (power of 2)                                   */
+#ifndef HOT_KEY_CACHE_SIZE
+    #define HOT_KEY_CACHE_SIZE 512
+#endif
+
 /*! Which SIMD instruction set is used for fastStrcmp                                 */
 //! Note: SSE is fastest
 #define SSE
 
-/*! Use hardware-optimized hash function                                              */
-#define FAST_CRC32
-
 # define INLINE_ASM_CRC32
 
+#if defined(PACKED_KEYS) && !(defined(FAST_STRCMP) && defined(ALIGNED_KEYS) && defined(FAST_CRC32) && \
+                              defined(INLINE_ASM_CRC32) && defined(SSE))
+    // Packed key starts with zero byte: it must be hashed and compared as whole block, not as C string
+    #error PACKED_KEYS needs FAST_STRCMP, ALIGNED_KEYS, FAST_CRC32 and SSE
+#endif
+
 #ifndef CMP_LEN_FIRST
     #define CMP_LEN_OPT(...)
 #else
@@ -62,7 +164,6 @@ hash_t checksum(const void *ptr);   ///< sum of ascii characters of the string
 hash_t djb2(const void *ptr);
 hash_t crc32(const void *data);
 
-#ifdef FAST_CRC32
 extern "C" {
     hash_t fastCrc32u(const void *data);
     hash_t fastCrc32(const void *data, const size_t len);
@@ -80,6 +181,35 @@ extern "C" {
     #endif
 
 }
+
+/// @brief Secret of seeded hash: two AES round keys. Keys that collide under one seed are unrelated under another
+typedef struct hashSeed {
+    __m128i keys[2];
+} hashSeed_t;
+
+/// @brief Fill seed with random bytes of the kernel (getrandom)
+void hashSeedInit(hashSeed_t *seed);
+
+/// @brief Halves of the state are folded together, so every bit of the hash depends on all bytes of the key
+static inline hash_t aesHashFold(__m128i state) {
+    return (hash_t) _mm_cvtsi128_si64(state) ^ (hash_t) _mm_extract_epi64(state, 1);
+}
+
+/*!
+    @brief Keyed 64-bit hash of aligned 16-byte block. First AES round mixes bytes within columns and
+    moves them between columns, second one spreads every byte over the whole block
+*/
+static inline hash_t aesHash16(const void *data, const hashSeed_t *seed) {
+    __m128i state = _mm_xor_si128(_mm_load_si128((const __m128i *) data), seed->keys[0]);
+    state = _mm_aesenc_si128(state, seed->keys[1]);
+    state = _mm_aesenc_si128(state, seed->keys[0]);
+    return aesHashFold(state);
+}
+
+/// @brief Keyed 64-bit hash of len bytes (unaligned, not null-terminated): one AES round per 16 bytes and two more
+hash_t aesHash(const void *data, size_t len, const hashSeed_t *seed);
+
+#ifdef FAST_CRC32
     #if defined(ALIGNED_KEYS) && defined(INLINE_ASM_CRC32)
         #define _HASH_FUNC FAST_CRC32_2k
     #else
@@ -108,8 +238,134 @@ static const size_t SMALL_STR_LEN = 64;
 #endif
 
 
+/* ====================== Cost of lookup (hashTableProbeCost) ========================== */
+
+/// Distinct cache lines remembered by hashTableProbe_t, further lines are counted as new ones
+static const size_t HT_PROBE_MAX_LINES = 64;
+
+/// @brief Work done by one lookup: same for every architecture, so they can be compared
+typedef struct hashTableProbe {
+    size_t    keysCompared;     ///< Stored keys compared with the searched one
+    size_t    cacheLines;       ///< Distinct cache lines of the table read (keys, nodes and value of found key)
+    bool      found;
+    uintptr_t lines[HT_PROBE_MAX_LINES];
+} hashTableProbe_t;
+
+/// @brief Count cache lines of [ptr, ptr + bytes) that the lookup hasn't read yet
+static inline void probeTouch(hashTableProbe_t *probe, const void *ptr, size_t bytes) {
+    const uintptr_t lineSize = 64;
+    const uintptr_t first = (uintptr_t) ptr / lineSize, last = ((uintptr_t) ptr + (bytes ? bytes : 1) - 1) / lineSize;
+
+    for (uintptr_t line = first; line <= last; line++) {
+        const size_t known = (probe->cacheLines < HT_PROBE_MAX_LINES) ? probe->cacheLines : HT_PROBE_MAX_LINES;
+        bool seen = false;
+        for (size_t idx = 0; idx < known && !seen; idx++)
+            seen = probe->lines[idx] == line;
+        if (seen)
+            continue;
+
+        if (probe->cacheLines < HT_PROBE_MAX_LINES)
+            probe->lines[probe->cacheLines] = line;
+        probe->cacheLines++;
+    }
+}
+
+/* ====================== Packed keys (PACKED_KEYS) ==================================== */
+#if defined(SSE)
+
+/// Bits of letter code: 'a' is 1, 'z' is 26, zero code ends the key
+static const size_t PACKED_LETTER_BITS = 5;
+/// Longest key that is packed: letters take bytes 1..14 of the block, its first and last bytes stay zero
+static const size_t PACKED_KEY_MAX_LEN = (SMALL_STR_LEN - 2) * 8 / PACKED_LETTER_BITS;
+
+/*!
+    @brief Pack key of SMALL_STR_LEN..PACKED_KEY_MAX_LEN lower case letters into aligned block of SMALL_STR_LEN bytes
+    Zero first byte tells packed key from raw short key, zero last byte lets it be copied as key of
+    SMALL_STR_LEN - 1 chars. Key may be unaligned and not null-terminated: nothing after its end is read
+    @return false (and packed is not written) if key has other length or other chars
+*/
+static inline bool packKeyLetters(const char *key, size_t keyLen, char *packed) {
+    if (keyLen - SMALL_STR_LEN > PACKED_KEY_MAX_LEN - SMALL_STR_LEN)
+        return false;
+
+    // Chars after the first SMALL_STR_LEN are shuffled down from the last block of the key, rest of it is zeroed
+    static const uint8_t TAIL_SHUFFLE[2 * SMALL_STR_LEN] =
+        {  0,    1,    2,    3,    4,    5,    6,    7,    8,    9,   10,   11,   12,   13,   14,   15,
+         128,  128,  128,  128,  128,  128,  128,  128,  128,  128,  128,  128,  128,  128,  128,  128};
+    const size_t tailLen = keyLen - SMALL_STR_LEN;
+    const __m128i head = _mm_loadu_si128((const __m128i_u *) key);
+    const __m128i tail = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i_u *) (key + tailLen)),
+                                          _mm_loadu_si128((const __m128i_u *) (TAIL_SHUFFLE + SMALL_STR_LEN - tailLen)));
+
+    // Bytes above 127 are negative and fail the first comparison
+    const __m128i beforeA = _mm_set1_epi8('a' - 1), afterZ = _mm_set1_epi8('z' + 1);
+    const __m128i headLetters = _mm_and_si128(_mm_cmpgt_epi8(head, beforeA), _mm_cmplt_epi8(head, afterZ));
+    const __m128i tailLetters = _mm_and_si128(_mm_cmpgt_epi8(tail, beforeA), _mm_cmplt_epi8(tail, afterZ));
+    const unsigned tailMask = (1u << tailLen) - 1;
+    if ((unsigned) _mm_movemask_epi8(headLetters) != 0xFFFF ||
+        ((unsigned) _mm_movemask_epi8(tailLetters) & tailMask) != tailMask)
+        return false;
+
+    // Codes are merged pairwise: 10 bits of two letters in 16-bit lane, 20 bits in 32-bit lane, 40 bits in 64-bit lane
+    __m128i headBits = _mm_and_si128(_mm_sub_epi8(head, beforeA), headLetters);
+    __m128i tailBits = _mm_and_si128(_mm_sub_epi8(tail, beforeA), tailLetters);
+    headBits = _mm_madd_epi16(_mm_maddubs_epi16(headBits, _mm_set1_epi16(1 << 13 | 1)), _mm_set1_epi32(1 << 26 | 1));
+    tailBits = _mm_madd_epi16(_mm_maddubs_epi16(tailBits, _mm_set1_epi16(1 << 13 | 1)), _mm_set1_epi32(1 << 26 | 1));
+    const __m128i low32 = _mm_set1_epi64x(0xFFFFFFFF);
+    headBits = _mm_or_si128(_mm_and_si128(headBits, low32), _mm_slli_epi64(_mm_srli_epi64(headBits, 32), 20));
+    tailBits = _mm_or_si128(_mm_and_si128(tailBits, low32), _mm_slli_epi64(_mm_srli_epi64(tailBits, 32), 20));
+
+    // Letters 0..7, 8..15 and 16..21 take 40, 40 and 30 bits, all of them are shifted by the zero first byte
+    const uint64_t first  = (uint64_t) _mm_cvtsi128_si64(headBits);
+    const uint64_t second = (uint64_t) _mm_extract_epi64(headBits, 1);
+    const uint64_t third  = (uint64_t) _mm_cvtsi128_si64(tailBits);
+    _mm_store_si128((__m128i *) packed, _mm_set_epi64x((long long) (second >> 16 | third << 24),
+                                                       (long long) (first << 8 | second << 48)));
+    return true;
+}
+
+/// @brief Packed key has zero first byte and letter in the second one. Raw short key has no chars after zero byte
+static inline bool isPackedKey(const char *block) {
+    return block[0] == '\0' && block[1] != '\0';
+}
+
+/// @brief Write letters of packed key into key (at least PACKED_KEY_MAX_LEN + 1 bytes) and terminating zero
+/// @return Length of the key
+static inline size_t unpackKeyLetters(const char *packed, char *key) {
+    const __m128i block = _mm_loadu_si128((const __m128i_u *) packed);
+    const uint64_t words[2] = {(uint64_t) _mm_cvtsi128_si64(block), (uint64_t) _mm_extract_epi64(block, 1)};
+
+    size_t len = 0;
+    for (; len < PACKED_KEY_MAX_LEN; len++) {
+        const size_t bit = 8 + len * PACKED_LETTER_BITS;
+        uint64_t code = (bit < 64) ? words[0] >> bit : words[1] >> (bit - 64);
+        if (bit < 64 && bit + PACKED_LETTER_BITS > 64)
+            code |= words[1] << (64 - bit);
+        code &= (1u << PACKED_LETTER_BITS) - 1;
+        if (!code)
+            break;
+        key[len] = (char) ('a' - 1 + code);
+    }
+    key[len] = '\0';
+
+    return len;
+}
+#endif
+
 /* ========================= Struct definitions ============================= */
 
+#ifdef HT_POLICY
+    #define HT_NAMESPACE_BEGIN namespace HT_POLICY {
+    #define HT_NAMESPACE_END   }
+#else
+    #define HT_NAMESPACE_BEGIN
+    #define HT_NAMESPACE_END
+#endif
+
+HT_NAMESPACE_BEGIN
+
+static const size_t CACHE_LINE_SIZE = 64;
+
 #if HASH_TABLE_ARCH == 2
 
 union StrOrPtr {
@@ -134,16 +390,148 @@ typedef struct hashTableNode {
     CMP_LEN_OPT(uint32_t len;)
 } hashTableNode_t;
 
-typedef struct hashTableBucket {
-    hashTableNode_t *elements;  ///< Array of nodes with key and value
-    size_t size;                ///< Number of nodes in bucket
+#if BUCKET_INLINE_NODES > 0
+    #define BUCKET_ALIGNAS alignas(CACHE_LINE_SIZE)
+#else
+    #define BUCKET_ALIGNAS
+#endif
+
+typedef struct BUCKET_ALIGNAS hashTableBucket {
+    hashTableNode_t *elements;  ///< Overflow array of nodes with key and value
+    size_t size;                ///< Number of nodes in bucket (inlined + overflow)
+    #if BUCKET_INLINE_NODES > 0
+    hashTableNode_t inlined[BUCKET_INLINE_NODES]; ///< First nodes of the bucket
+    #endif
 } hashTableBucket_t;
 
+/// @brief Get node with index idx from the bucket (first inlined nodes, then overflow array)
+static inline hashTableNode_t *bucketGetNode(hashTableBucket_t *bucket, size_t idx) {
+    #if BUCKET_INLINE_NODES > 0
+    if (idx < BUCKET_INLINE_NODES)
+        return bucket->inlined + idx;
+    #endif
+    return bucket->elements + (idx - BUCKET_INLINE_NODES);
+}
+
+static inline const hashTableNode_t *bucketGetNode(const hashTableBucket_t *bucket, size_t idx) {
+    #if BUCKET_INLINE_NODES > 0
+    if (idx < BUCKET_INLINE_NODES)
+        return bucket->inlined + idx;
+    #endif
+    return bucket->elements + (idx - BUCKET_INLINE_NODES);
+}
+
+/// @brief Entry of hot key cache. Node pointer is valid only while epoch matches the table's one
+typedef struct hotKeyEntry {
+    hashTableNode_t *node;
+    size_t epoch;
+} hotKeyEntry_t;
+
+/// Last bin of the histogram of bucket sizes counts buckets of this size and bigger
+static const size_t HT_STATS_HISTOGRAM_SIZE = 16;
+
+/// @brief Snapshot of runtime statistics. Counters are maintained incrementally, snapshot is O(1)
+typedef struct hashTableStats {
+    uint64_t lookups;           ///< Searches of key (find, access, insert, erase)
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t nodesCompared;     ///< Keys compared with searched one
+    uint64_t longKeyScans;      ///< Lookups that scanned array of long keys
+    uint64_t allocations;       ///< Separately allocated values and long keys
+    uint64_t reallocs;          ///< Reallocations of overflow arrays of buckets
+    uint64_t bucketSizes[HT_STATS_HISTOGRAM_SIZE]; ///< Number of buckets (without long keys) of each size
+
+    size_t size;                ///< Filled by hashTableGetStats
+    size_t bucketsCount;
+    size_t longKeysCount;
+} hashTableStats_t;
+
+/// @brief Bytes used by the table (without hashTable_t itself), see hashTableMemoryUsage
+typedef struct hashTableMemory {
+    size_t buckets;             ///< Array of buckets with inlined nodes
+    size_t overflowNodes;       ///< Nodes in overflow arrays of buckets and in array of long keys
+    size_t longKeys;            ///< Strings of long keys with terminating zeros
+    size_t values;              ///< Values allocated outside of nodes
+    size_t other;               ///< Hot key cache
+    size_t allocatorOverhead;   ///< Estimated: malloc headers, unused capacity of blocks and of arena
+    size_t total;
+} hashTableMemory_t;
+
 typedef struct hashTable {
     hashTableBucket_t *buckets; ///< Array of buckets
     size_t bucketsCount;        ///< Number of buckets
 
     hashTableBucket_t longKeys; ///< Separate array for elements with long keys
+    bool borrowedLongKeys;      ///< Long keys belong to the caller and outlive the table: nodes point to the passed
+                                ///< zero-terminated keys, which are never copied or freed (see hashTableIntern.h)
+
+    char  *arena;               ///< Single block made by hashTableCompact, parts of it are never freed one by one
+    size_t arenaSize;
+
+    size_t valSize;             ///< Size of data stored in element
+    size_t size;                ///< Number of elements
+
+    #ifdef SELF_ORGANIZING_BUCKETS
+    size_t promoteTick;         ///< Counter of hits outside the head of the bucket
+    #endif
+
+    #ifdef SEEDED_HASH
+    hashSeed_t seed;            ///< Secret of the hash, chosen in hashTableCtor and kept by rehash and clone
+    #endif
+
+    #ifdef HOT_KEY_CACHE
+    hotKeyEntry_t *hotKeys;     ///< HOT_KEY_CACHE_SIZE entries indexed by hash of the key
+    size_t hotKeysEpoch;        ///< Incremented whenever nodes are moved to other memory
+    #endif
+
+    #ifdef HASH_TABLE_STATS
+    hashTableStats_t stats;
+    #endif
+
+    size_t verifyBucket;        ///< Cursor of hashTableVerifyIncremental (bucketsCount is array of long keys)
+    size_t verifyNode;
+
+    HDBG(int (*printElem)(const void *ptr);)
+} hashTable_t;
+
+#elif HASH_TABLE_ARCH == 3
+
+/// Last byte of slot with long key. Short keys are padded with zeros, so their last byte is always zero
+static const uint8_t CUCKOO_LONG_MARK = 0xFF;
+
+/// @brief Slot of cuckoo bucket: short key (up to SMALL_STR_LEN - 1 chars) padded with zeros or long key by pointer.
+/// Empty slot is all zeros, so the empty key lives in the stash
+typedef union cuckooSlot {
+    MMi_t MM;
+    struct {
+        char     *ptr;
+        uint32_t  hash;         ///< Second hash of the key, compared before the string
+    } longKey;                  ///< Last byte of the slot is CUCKOO_LONG_MARK, see cuckooSlotIsLong
+} cuckooSlot_t;
+
+/// @brief Mark is the last byte of the whole slot, so long key needs no padding up to it
+static inline bool cuckooSlotIsLong(const cuckooSlot_t *slot) {
+    return ((const uint8_t *) slot)[SMALL_STR_LEN - 1] == CUCKOO_LONG_MARK;
+}
+
+/// @brief Keys of the bucket. Values of its slots (valSize bytes each) follow them,
+/// whole bucket takes bucketStride bytes of the array
+typedef struct alignas(CACHE_LINE_SIZE) cuckooBucket {
+    cuckooSlot_t slots[CUCKOO_SLOTS];
+} cuckooBucket_t;
+
+typedef struct hashTable {
+    cuckooBucket_t *buckets;    ///< Every key is in one of its two candidate buckets or in the stash
+    size_t bucketsCount;
+    size_t bucketStride;        ///< Bytes between buckets: keys and values, rounded up to cache line
+
+    cuckooSlot_t stash[CUCKOO_STASH_SIZE];
+    char  *stashValues;         ///< Value of stash[idx] is at idx * valSize
+    size_t stashSize;           ///< Stash entries are stash[0, stashSize)
+
+    char  *carryValue;          ///< Value of the key that is being moved by insert
+    uint64_t kickState;         ///< PRNG choosing victims of evictions
+    hashSeed_t seed;            ///< Secret of the second hash, chosen in hashTableCtor and kept by rehash
 
     size_t valSize;             ///< Size of data stored in element
     size_t size;                ///< Number of elements
@@ -204,8 +592,19 @@ hashTableStatus_t hashTableCtor(hashTable_t *table, size_t valueSize, size_t buc
 /// @brief Destruct hashTable and free it's memory
 hashTableStatus_t hashTableDtor(hashTable_t *table);
 
+/*!
+    @brief Prepare table for expectedKeys elements without overloading buckets
+    Rehashes table to expectedKeys / RESERVE_LOAD_FACTOR buckets if it has fewer.
+    Pointers to values stored in nodes become invalid
+*/
+hashTableStatus_t hashTableReserve(hashTable_t *table, size_t expectedKeys);
+
 //! If ALIGNED_KEYS is defined, following functions expect key to be aligned on KEY_ALIGNMENT boundary
 //! and have trailing zeros up to the end of the aligned block
+//! With SELF_ORGANIZING_BUCKETS lookups reorder nodes of the bucket, so pointers to values stored in nodes
+//! are valid only until the next call on the same table
+//! In cuckoo table (HASH_TABLE_ARCH 3) inserts move keys with their values between buckets,
+//! so pointers to values are valid only until the next insert
 
 /// @brief Insert element in hashTable or rewrite it's value if already inserted
 hashTableStatus_t hashTableInsert(hashTable_t *table, const char *key, const void *value);
@@ -218,12 +617,125 @@ void *hashTableAccess(hashTable_t *table, const char *key);
 /// @return Ptr to value of NULL if there's no element with given key
 void *hashTableFind(hashTable_t *table, const char *key);
 
+/// @brief Remove element with given key from hash table
+/// Pointers to values stored in nodes of the same bucket become invalid
+/// @return HT_NO_KEY if there's no element with given key
+hashTableStatus_t hashTableErase(hashTable_t *table, const char *key);
+
+/*!
+    @brief Access count keys at once, inserting missing ones with default value
+    Keys are hashed first and partitioned by bucket index, then inserted partition by partition
+    while their buckets are in cache
+    @param values Receives pointer to value of each key, in order of keys
+*/
+hashTableStatus_t hashTableBulkAccess(hashTable_t *table, const char *const *keys, size_t count, void **values);
+
+#if HASH_TABLE_ARCH != 3
 /// @brief Extract ptr to value from given node of hashTable
 void *getValueFromNode(const hashTable_t *table, hashTableNode_t *node);
+#endif
+
+/// @brief Count work of hashTableFind(table, key) without doing it: keys compared and cache lines read.
+/// Structure of the table is measured, so caches of recent keys and reordering of buckets are not used
+hashTableStatus_t hashTableProbeCost(hashTable_t *table, const char *key, hashTableProbe_t *probe);
+
+#if HASH_TABLE_ARCH == 2
+/* ---------------- Node-level access (used by typed C++ front-end, hashTable.hpp) ---------------- */
+//! Key of these functions is given with its length: it may be unaligned and not null-terminated
+
+/// @brief Find node by key
+/// @return Ptr to node or NULL if there's no element with given key
+hashTableNode_t *hashTableFindNode(hashTable_t *table, const char *key, size_t keyLen);
+
+/// @brief Find node by key or insert new node with zeroed value
+/// @param inserted Set to true if node was created by this call
+/// @return Ptr to node or NULL in case of error
+hashTableNode_t *hashTableAccessNode(hashTable_t *table, const char *key, size_t keyLen, bool *inserted);
+#endif
+
+#if HASH_TABLE_ARCH == 2
+/// @brief Initializer of value of new element: must write all valSize bytes of value
+typedef void (*hashTableValueInit_t)(void *value, void *ctx);
+
+/*!
+    @brief Access element or insert it with value written by init(value, ctx)
+    init is called only for new key, directly on the storage of value in the table: value is neither
+    zeroed before nor copied after it. Key is passed as to hashTableAccess
+    @return Ptr to value (existing or just initialized) or NULL in case of error
+*/
+void *hashTableEmplace(hashTable_t *table, const char *key, hashTableValueInit_t init, void *ctx);
+#endif
+
+#if HASH_TABLE_ARCH == 2
+/* ---------------- Counters: table constructed with valueSize == sizeof(hashTableCounter_t) ---------------- */
+//! Keys are passed as to hashTableAccess. Tables with other value size are rejected with HT_WRONG_SIZE
+
+typedef int64_t hashTableCounter_t;
+
+/// @brief Add delta to counter of key, missing key is inserted with counter equal to delta
+hashTableStatus_t hashTableIncrement(hashTable_t *table, const char *key, hashTableCounter_t delta);
+
+/*!
+    @brief Add delta to counters of count keys, key that occurs several times is incremented several times
+    Keys are processed in batches: repeated keys of the batch are merged into one update,
+    then buckets are updated with prefetch ahead
+*/
+hashTableStatus_t hashTableIncrementBatch(hashTable_t *table, const char *const *keys, size_t count,
+                                          hashTableCounter_t delta);
+#endif
+
+#if HASH_TABLE_ARCH == 2
+/// @brief Bytes used by the table by category. Allocator overhead is estimated with malloc_usable_size
+hashTableStatus_t hashTableMemoryUsage(const hashTable_t *table, hashTableMemory_t *usage);
+
+/*!
+    @brief Move overflow arrays, long keys and values into one contiguous block without gaps
+    Meant to be called after building the table or after many erases. Elements inserted later
+    are allocated as usual, memory of the old block is released by the next compaction or destructor.
+    Pointers to values and nodes become invalid
+*/
+hashTableStatus_t hashTableCompact(hashTable_t *table);
+
+/*!
+    @brief Deep copy of table into copy (not constructed before), laid out as after hashTableCompact
+    All memory of the copy is allocated and first written by the calling thread, so on NUMA systems
+    it is placed on the node of that thread (see hashTableNuma.h). Table is only read, so several threads
+    may clone it at once. On error copy is left unconstructed
+*/
+hashTableStatus_t hashTableClone(hashTable_t *copy, const hashTable_t *table);
+#endif
+
+#if HASH_TABLE_ARCH == 2 && defined(HASH_TABLE_STATS)
+/// @brief Copy current statistics of the table
+hashTableStatus_t hashTableGetStats(const hashTable_t *table, hashTableStats_t *stats);
+
+/// @brief Zero counters (histogram of bucket sizes describes current state and is kept)
+hashTableStatus_t hashTableResetStats(hashTable_t *table);
+#endif
 
 /// @brief Check whether table is built correctly
 hashTableStatus_t hashTableVerify(hashTable_t *table);
 
+#if HASH_TABLE_ARCH == 2
+/*!
+    @brief Check up to budget nodes starting where previous call stopped, wrapping around the table
+    Each node is checked as in hashTableVerify, but sum of bucket sizes is checked only by full verify
+*/
+hashTableStatus_t hashTableVerifyIncremental(hashTable_t *table, size_t budget);
+
+/*!
+    @brief Start full hashTableVerify of the snapshot of table in background
+    Table is snapshotted by fork(): child checks copy-on-write pages, parent continues at once.
+    Don't call from multithreaded program while other threads modify the table
+    @param child Receives pid of the child, result is collected by hashTableVerifySnapshotWait
+*/
+hashTableStatus_t hashTableVerifySnapshot(hashTable_t *table, pid_t *child);
+
+/// @brief Wait for background check started by hashTableVerifySnapshot
+/// @return Result of hashTableVerify of the snapshot, HT_ERROR if child failed
+hashTableStatus_t hashTableVerifySnapshotWait(pid_t child);
+#endif
+
 /// @brief Print dump of given hash table to stderr
 hashTableStatus_t hashTableDump(hashTable_t *table);
 
@@ -272,7 +784,16 @@ static void htStackTrace(const char *file, int line, const char *function) {
 
 
 
-#ifdef HASH_TABLE_VERIFY
+#if defined(HASH_TABLE_VERIFY_INCREMENTAL) && HASH_TABLE_ARCH == 2
+    #define _VERIFY(table, ret) do {                        \
+        hashTableStatus_t status = hashTableVerifyIncremental(table, VERIFY_BUDGET); \
+        if (status != HT_SUCCESS) {                         \
+            htStackTrace(__FILE__, __LINE__, __PRETTY_FUNCTION__); \
+            return ret;                                     \
+        }                                                   \
+    } while(0)
+
+#elif defined(HASH_TABLE_VERIFY)
     #define _VERIFY(table, ret) do {                             \
         hashTableStatus_t status = hashTableVerify(table);  \
         if (status != HT_SUCCESS) {                         \
@@ -286,4 +807,6 @@ static void htStackTrace(const char *file, int line, const char *function) {
     #define _VERIFY(table, ret)
 #endif
 
+HT_NAMESPACE_END
+
 #endif
@@ -0,0 +1,116 @@
+#ifndef HASH_TABLE_HPP
+#define HASH_TABLE_HPP
+
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "hashTable.h"
+
+#if HASH_TABLE_ARCH == 2
+
+/*!
+    @brief Typed front-end over v2 hashTable
+
+    Storage of the value is chosen at compile time: values up to SMALL_STR_LEN bytes are
+    stored in the node (with SHORT_VALUES_IN_NODE), bigger ones are allocated separately.
+    Keys are std::string_view: they don't have to be aligned or null-terminated, lookups don't allocate.
+    As with C API, pointers to values are valid until next insertion into the same bucket.
+    Value must be trivially copyable: table moves nodes and values with realloc and memcpy
+    (growth of overflow arrays, erase, rehash, promotion, hashTableCompact) without calling constructors.
+*/
+template <typename Value>
+class HashTable {
+public:
+    #ifdef SHORT_VALUES_IN_NODE
+    static constexpr bool VALUE_IN_NODE = sizeof(Value) <= SMALL_STR_LEN;
+    #else
+    static constexpr bool VALUE_IN_NODE = false;
+    #endif
+
+    static_assert(alignof(Value) <= KEY_ALIGNMENT, "Values with alignment bigger than node alignment are not supported");
+    static_assert(std::is_nothrow_move_constructible<Value>::value, "Values are moved into the table");
+    static_assert(std::is_trivially_copyable<Value>::value, "Values are relocated by memcpy inside the table");
+
+    explicit HashTable(size_t bucketsCount) : table_(), status_(HT_SUCCESS) {
+        status_ = hashTableCtor(&table_, sizeof(Value), bucketsCount);
+    }
+
+    HashTable(const HashTable &) = delete;
+    HashTable &operator=(const HashTable &) = delete;
+
+    ~HashTable() {
+        // Trivially copyable values have trivial destructors, nothing to call before freeing them
+        if (status_ == HT_SUCCESS)
+            hashTableDtor(&table_);
+    }
+
+    /// @brief Status of construction. Table can't be used if it isn't HT_SUCCESS
+    hashTableStatus_t status() const { return status_; }
+
+    size_t size() const { return table_.size; }
+
+    /// @brief Find value by key
+    /// @return Ptr to value or nullptr if there's no element with given key
+    Value *find(std::string_view key) {
+        hashTableNode_t *node = hashTableFindNode(&table_, key.data(), key.size());
+        return node ? valueOf(node) : nullptr;
+    }
+
+    /// @brief Access element or insert it with value constructed by Value()
+    /// @return Ptr to value or nullptr in case of error
+    Value *access(std::string_view key) {
+        bool inserted = false;
+        hashTableNode_t *node = hashTableAccessNode(&table_, key.data(), key.size(), &inserted);
+        if (!node)
+            return nullptr;
+
+        if (inserted)
+            return new (valueOf(node)) Value();
+
+        return valueOf(node);
+    }
+
+    /// @brief Insert element or rewrite its value. Value is moved into the table
+    hashTableStatus_t insert(std::string_view key, Value &&value) {
+        bool inserted = false;
+        hashTableNode_t *node = hashTableAccessNode(&table_, key.data(), key.size(), &inserted);
+        if (!node)
+            return HT_MEMORY_ERROR;
+
+        if (inserted)
+            new (valueOf(node)) Value(std::move(value));
+        else
+            *valueOf(node) = std::move(value);
+
+        return HT_SUCCESS;
+    }
+
+    hashTableStatus_t insert(std::string_view key, const Value &value) {
+        return insert(key, Value(value));
+    }
+
+    /// @brief Underlying C table (e.g. for hashTableVerify or hashTableDump)
+    hashTable_t *raw() { return &table_; }
+
+private:
+    /// @brief Location of value is known at compile time, no check of valSize
+    static Value *valueOf(hashTableNode_t *node) {
+        #ifdef SHORT_VALUES_IN_NODE
+        if constexpr (VALUE_IN_NODE)
+            return reinterpret_cast<Value *>(&node->value.MM);
+        else
+            return static_cast<Value *>(node->value.Ptr);
+        #else
+        return static_cast<Value *>(node->value);
+        #endif
+    }
+
+    hashTable_t table_;
+    hashTableStatus_t status_;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef HASH_TABLE_INT_H
+#define HASH_TABLE_INT_H
+
+#include <stdint.h>
+
+#include "hashTable.h"
+
+/* ================================================================================ */
+/* Table keyed by 64-bit integers. Same scheme as v2: buckets with first nodes      */
+/* inlined into the cache line of the bucket and overflow arrays for the rest.      */
+/* Key is hashed by one crc32 instruction, several keys are compared by one SIMD    */
+/* load. Node is 16 bytes: key and value (or pointer to value bigger than 8 bytes)  */
+/* ================================================================================ */
+
+/// Nodes in the cache line of the bucket, header of the bucket takes the place of the fourth one
+static const uint32_t INT_BUCKET_INLINE_NODES = 3;
+
+typedef struct hashTableIntNode {
+    uint64_t key;
+    union {
+        uint64_t Imm;           ///< Values up to 8 bytes are stored in node
+        void    *Ptr;
+    } value;
+} hashTableIntNode_t;
+
+typedef struct alignas(CACHE_LINE_SIZE) hashTableIntBucket {
+    hashTableIntNode_t  inlined[INT_BUCKET_INLINE_NODES];  ///< First nodes of the bucket
+    hashTableIntNode_t *elements;   ///< Overflow array
+    uint32_t size;                  ///< Number of nodes in bucket (inlined + overflow)
+    uint32_t capacity;              ///< Nodes allocated in overflow array
+} hashTableIntBucket_t;
+
+static_assert(sizeof(hashTableIntBucket_t) == CACHE_LINE_SIZE, "Bucket of integer table must fill one cache line");
+
+typedef struct hashTableInt {
+    hashTableIntBucket_t *buckets;
+    size_t bucketsCount;
+
+    size_t valSize;             ///< Size of data stored in element
+    size_t size;                ///< Number of elements
+} hashTableInt_t;
+
+//! Pointers to values stored in nodes are valid until the next insertion into or erase from the same bucket
+
+hashTableStatus_t hashTableIntCtor(hashTableInt_t *table, size_t valueSize, size_t bucketsCount);
+hashTableStatus_t hashTableIntDtor(hashTableInt_t *table);
+
+/// @brief Rehash table to expectedKeys / RESERVE_LOAD_FACTOR buckets if it has fewer
+hashTableStatus_t hashTableIntReserve(hashTableInt_t *table, size_t expectedKeys);
+
+/// @brief Insert element or rewrite its value if already inserted
+hashTableStatus_t hashTableIntInsert(hashTableInt_t *table, uint64_t key, const void *value);
+
+/// @brief Access element or insert it with zeroed value
+/// @return Ptr to value or NULL in case of error
+void *hashTableIntAccess(hashTableInt_t *table, uint64_t key);
+
+/// @return Ptr to value or NULL if there's no element with given key
+void *hashTableIntFind(hashTableInt_t *table, uint64_t key);
+
+/// @return HT_NO_KEY if there's no element with given key
+hashTableStatus_t hashTableIntErase(hashTableInt_t *table, uint64_t key);
+
+/// @brief Check that every key is in its bucket and sizes add up
+hashTableStatus_t hashTableIntVerify(hashTableInt_t *table);
+
+#endif
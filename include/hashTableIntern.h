@@ -0,0 +1,71 @@
+#ifndef HASH_TABLE_INTERN_H
+#define HASH_TABLE_INTERN_H
+
+#include <stdint.h>
+#include <assert.h>
+
+#include "hashTable.h"
+
+/* ================================================================================ */
+/* Interning of strings: every distinct key gets dense ID 0, 1, 2, ... in order of  */
+/* first appearance. Key -> ID is a v2 table with ID as the value of the node,      */
+/* ID -> key is an array of pointers into append-only pool of keys. Long keys are   */
+/* stored once: nodes of the table point into the pool. Per-key data lives in       */
+/* caller's arrays indexed by ID                                                    */
+/* ================================================================================ */
+
+#if HASH_TABLE_ARCH == 2
+
+/// Returned instead of ID when key is not interned or interning failed
+static const uint32_t INTERN_NO_ID = UINT32_MAX;
+
+/// Keys are copied into blocks of this size, longer keys get a block of their own
+static const size_t INTERN_POOL_BLOCK = 1 << 16;
+
+typedef struct {
+    hashTable_t table;          ///< Key -> ID
+
+    const char **keys;          ///< Key of each ID, in the pool
+    uint32_t    *lengths;       ///< Length of key of each ID
+    uint32_t     count;         ///< IDs [0, count) are in use
+    uint32_t     capacity;      ///< Allocated entries of keys and lengths
+
+    char  **blocks;             ///< Blocks of the pool, they are never moved or freed before destruction
+    size_t  blocksCount;
+    size_t  blocksCapacity;
+    size_t  blockUsed;          ///< Bytes used in the last block
+    size_t  blockSize;          ///< Size of the last block
+} hashTableInterner_t;
+
+/// @param bucketsCount Initial number of buckets of key -> ID table
+hashTableStatus_t hashTableInternerCtor(hashTableInterner_t *interner, size_t bucketsCount);
+hashTableStatus_t hashTableInternerDtor(hashTableInterner_t *interner);
+
+/*!
+    @brief ID of key, new key gets the next ID and its copy is appended to the pool
+    Key is passed as to hashTableAccess (aligned and padded with zeros if ALIGNED_KEYS is defined)
+    @return ID or INTERN_NO_ID in case of error
+*/
+uint32_t hashTableIntern(hashTableInterner_t *interner, const char *key);
+
+/// @brief ID of key without interning it
+/// @return ID or INTERN_NO_ID if key is not interned
+uint32_t hashTableInternFind(hashTableInterner_t *interner, const char *key);
+
+/*!
+    @brief Key of the ID. Pointer stays valid until the interner is destroyed.
+    Key is aligned on KEY_ALIGNMENT and padded with zeros, so it can be passed to hashTable functions as is
+*/
+static inline const char *hashTableKeyById(const hashTableInterner_t *interner, uint32_t id) {
+    assert(id < interner->count);
+    return interner->keys[id];
+}
+
+static inline uint32_t hashTableKeyLengthById(const hashTableInterner_t *interner, uint32_t id) {
+    assert(id < interner->count);
+    return interner->lengths[id];
+}
+
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef HASH_TABLE_NUMA_H
+#define HASH_TABLE_NUMA_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "hashTable.h"
+
+/* ================================================================================ */
+/* Read replicas of a finished table on every NUMA node. Each replica is cloned by  */
+/* a thread pinned to cpus of its node, so first touch places its memory there.     */
+/* Readers pick replica of the node they are running on                             */
+/* ================================================================================ */
+
+#if HASH_TABLE_ARCH == 2
+
+static const int NUMA_MAX_NODES = 64;
+static const int NUMA_MAX_CPUS  = 1024;
+
+/// Fake topology for single-node machines: HASH_TABLE_FAKE_NUMA=N splits online cpus into N nodes
+/// in contiguous blocks, as sockets number them. Memory is not really separated then
+#define NUMA_FAKE_ENV "HASH_TABLE_FAKE_NUMA"
+
+typedef struct {
+    int     nodesCount;
+    int     nodeIds[NUMA_MAX_NODES];    ///< System id of each node (node<id> in sysfs), equal to index for fake nodes
+    int     cpusCount;                  ///< Entries of cpuNode in use
+    int16_t cpuNode[NUMA_MAX_CPUS];     ///< Index of node of each cpu, -1 for cpus that are offline
+    bool    fake;
+} numaTopology_t;
+
+/// @brief Read topology from /sys/devices/system/node or make a fake one (NUMA_FAKE_ENV).
+/// Machines without sysfs NUMA information are one node with all online cpus
+hashTableStatus_t numaTopologyDetect(numaTopology_t *topology);
+
+/// @brief Index of the node of the cpu the calling thread is running on, 0 if unknown
+int numaCurrentNode(const numaTopology_t *topology);
+
+/// Calls of numaCachedNode between checks of the cpu: getcpu waits for preceding loads (rdtscp/rdpid),
+/// so checking it on every lookup keeps cache misses of neighbouring lookups from overlapping
+static const uint32_t NUMA_NODE_CHECK_PERIOD = 1024;
+
+/// @brief numaCurrentNode, remembered by the calling thread for NUMA_NODE_CHECK_PERIOD calls.
+/// Thread moved to other node reads remote replica until the next check, which is still correct
+int numaCachedNode(const numaTopology_t *topology);
+
+/// @brief System id of the node where page with ptr is placed (move_pages query), -1 if not known
+int numaMemoryNode(const void *ptr);
+
+/*!
+    @brief Start thread pinned to cpus of node. Node without cpus (possible in fake topology) gets unpinned thread
+    @return false if thread couldn't be created
+*/
+bool numaStartOnNode(const numaTopology_t *topology, int node, void *(*func)(void *), void *arg, pthread_t *thread);
+
+typedef struct {
+    numaTopology_t topology;
+    hashTable_t   *replicas;    ///< One per node, indexed as nodes of topology
+} hashTableReplicas_t;
+
+/*!
+    @brief Clone table onto every node of the detected topology, replicas are built in parallel.
+    Replicas are independent of table: later changes of it are not seen by readers until replicas
+    are rebuilt. Readers share replicas, so lookups must not write to the table: builds with
+    SELF_ORGANIZING_BUCKETS, HOT_KEY_CACHE, HASH_TABLE_STATS or incremental verification race
+*/
+hashTableStatus_t hashTableReplicasCtor(hashTableReplicas_t *replicas, const hashTable_t *table);
+hashTableStatus_t hashTableReplicasDtor(hashTableReplicas_t *replicas);
+
+/// @brief Replica on the node of the calling thread (see numaCachedNode)
+static inline hashTable_t *hashTableReplicasLocal(hashTableReplicas_t *replicas) {
+    return replicas->replicas + numaCachedNode(&replicas->topology);
+}
+
+/// @brief hashTableFind in the replica of the calling thread's node
+void *hashTableReplicasFind(hashTableReplicas_t *replicas, const char *key);
+
+#endif
+
+#endif
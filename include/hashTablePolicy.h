@@ -0,0 +1,106 @@
+#ifndef HASH_TABLE_POLICY_H
+#define HASH_TABLE_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hashTable.h"
+
+/* ================================================================================ */
+/* Policy is a set of optimization switches from hashTable.h (HASH_TABLE_ARCH,      */
+/* FAST_STRCMP, CMP_LEN_FIRST, ...). Every policy listed in POLICIES in Makefile    */
+/* is compiled from hashTable_v<arch>.c into its own namespace and                 */
+/* registers itself here, so all of them can be used from one binary                */
+/* ================================================================================ */
+
+/// @brief Type-erased interface of hashTable compiled with one policy
+typedef struct hashTablePolicy {
+    const char *name;
+
+    void  *(*ctor)(size_t valueSize, size_t bucketsCount); ///< @return new table or NULL
+    void   (*dtor)(void *table);
+    void  *(*access)(void *table, const char *key);
+    void  *(*find)(void *table, const char *key);
+    size_t (*size)(const void *table);
+    void   (*compact)(void *table);     ///< hashTableCompact, does nothing for v1
+
+    /// Loops of benchmark are compiled together with the policy, so there's no indirect call per key
+    void    (*accessAll)(void *table, char **keys, int64_t count);
+    int64_t (*findAll)(void *table, char **keys, int64_t count); ///< Increments int values, returns found count
+    void    (*probeCost)(void *table, const char *key, hashTableProbe_t *probe);
+
+    struct hashTablePolicy *next;
+} hashTablePolicy_t;
+
+/// @brief Add policy to the list (called by constructors of policy objects before main)
+void hashTableRegisterPolicy(hashTablePolicy_t *policy);
+
+/// @brief First registered policy (list is sorted by name), others are linked by next
+hashTablePolicy_t *hashTablePolicies();
+
+#if defined(HASH_TABLE_ARCH) && HASH_TABLE_ARCH == 2
+    #define HT_POLICY_COMPACT(table) hashTableCompact((hashTable_t *) table)
+#else
+    #define HT_POLICY_COMPACT(table) (void) table
+#endif
+
+#define HT_STRINGIFY_(x) #x
+#define HT_STRINGIFY(x) HT_STRINGIFY_(x)
+
+/// @brief Defines type-erased wrappers of current policy and registers it.
+/// Must be used in the namespace of the policy after all hashTable functions
+#define HT_DEFINE_POLICY()                                                              \
+    static void *policyCtor(size_t valueSize, size_t bucketsCount) {                    \
+        hashTable_t *table = (hashTable_t *) aligned_alloc(alignof(hashTable_t), sizeof(hashTable_t)); \
+        if (!table) return NULL;                                                        \
+        memset((void *) table, 0, sizeof(hashTable_t));                                 \
+        if (hashTableCtor(table, valueSize, bucketsCount) != HT_SUCCESS) {              \
+            free(table);                                                                \
+            return NULL;                                                                \
+        }                                                                               \
+        return table;                                                                   \
+    }                                                                                   \
+    static void policyDtor(void *table) {                                               \
+        hashTableDtor((hashTable_t *) table);                                           \
+        free(table);                                                                    \
+    }                                                                                   \
+    static void *policyAccess(void *table, const char *key) {                           \
+        return hashTableAccess((hashTable_t *) table, key);                             \
+    }                                                                                   \
+    static void *policyFind(void *table, const char *key) {                             \
+        return hashTableFind((hashTable_t *) table, key);                               \
+    }                                                                                   \
+    static size_t policySize(const void *table) {                                       \
+        return ((const hashTable_t *) table)->size;                                     \
+    }                                                                                   \
+    static void policyCompact(void *table) {                                            \
+        HT_POLICY_COMPACT(table);                                                       \
+    }                                                                                   \
+    static void policyAccessAll(void *table, char **keys, int64_t count) {              \
+        for (int64_t idx = 0; idx < count; idx++)                                       \
+            hashTableAccess((hashTable_t *) table, keys[idx]);                          \
+    }                                                                                   \
+    static int64_t policyFindAll(void *table, char **keys, int64_t count) {             \
+        int64_t found = 0;                                                              \
+        for (int64_t idx = 0; idx < count; idx++) {                                     \
+            void *value = hashTableFind((hashTable_t *) table, keys[idx]);              \
+            if (value) {                                                                \
+                (*(int *)value)++;                                                      \
+                found++;                                                                \
+            }                                                                           \
+        }                                                                               \
+        return found;                                                                   \
+    }                                                                                   \
+    static void policyProbeCost(void *table, const char *key, hashTableProbe_t *probe) { \
+        hashTableProbeCost((hashTable_t *) table, key, probe);                          \
+    }                                                                                   \
+    static hashTablePolicy_t policy = {                                                 \
+        HT_STRINGIFY(HT_POLICY), policyCtor, policyDtor, policyAccess, policyFind,      \
+        policySize, policyCompact, policyAccessAll, policyFindAll, policyProbeCost,     \
+        NULL                                                                            \
+    };                                                                                  \
+    __attribute__((constructor)) static void registerPolicy() {                         \
+        hashTableRegisterPolicy(&policy);                                               \
+    }
+
+#endif
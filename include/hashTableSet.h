@@ -0,0 +1,86 @@
+#ifndef HASH_TABLE_SET_H
+#define HASH_TABLE_SET_H
+
+#include <stdint.h>
+
+#include "hashTable.h"
+
+/* ================================================================================ */
+/* Set of strings: keys without values (stop-word lists, dedup filters). Same       */
+/* scheme as v2, but node holds only the key: SMALL_STR_LEN bytes instead of twice  */
+/* as much, so twice as many nodes fit in a cache line. Long keys are stored by     */
+/* pointer in the same buckets and are told apart by the last byte of the node      */
+/* ================================================================================ */
+
+/// Last byte of node with long key. Short keys are padded with zeros, so their last byte is always zero
+static const uint8_t SET_LONG_MARK = 0xFF;
+
+typedef union hashTableSetNode {
+    MMi_t MM;                   ///< Short key (up to SMALL_STR_LEN - 1 chars) padded with zeros
+    struct {
+        char    *ptr;           ///< Copy of long key
+        uint32_t hash;          ///< Hash of long key, compared before the strings
+        uint8_t  padding[SMALL_STR_LEN - sizeof(char *) - sizeof(uint32_t) - 1];
+        uint8_t  mark;          ///< SET_LONG_MARK
+    } Long;
+} hashTableSetNode_t;
+
+static_assert(sizeof(hashTableSetNode_t) == SMALL_STR_LEN, "Node of set must be as big as short key");
+
+/// Nodes in the cache line of the bucket, header of the bucket takes the rest of it
+static const uint32_t SET_BUCKET_INLINE_NODES =
+    (2 * SMALL_STR_LEN <= CACHE_LINE_SIZE) ? (uint32_t) ((CACHE_LINE_SIZE - 16) / SMALL_STR_LEN) : 1;
+
+/// Keys per bucket after hashTableSetReserve. Bucket holds three nodes (with SSE), so at two keys on average
+/// few of them overflow, while at one key per bucket most of the array of buckets is empty nodes
+#ifndef SET_RESERVE_LOAD_FACTOR
+    #define SET_RESERVE_LOAD_FACTOR 2
+#endif
+
+typedef struct alignas(CACHE_LINE_SIZE) hashTableSetBucket {
+    hashTableSetNode_t  inlined[SET_BUCKET_INLINE_NODES];  ///< First nodes of the bucket
+    hashTableSetNode_t *elements;   ///< Overflow array
+    uint32_t size;                  ///< Number of nodes in bucket (inlined + overflow)
+    uint32_t capacity;              ///< Nodes allocated in overflow array
+} hashTableSetBucket_t;
+
+typedef struct hashTableSet {
+    hashTableSetBucket_t *buckets;
+    size_t bucketsCount;
+
+    size_t size;                ///< Number of keys
+} hashTableSet_t;
+
+//! Keys are passed as to hashTableAccess (aligned and padded with zeros if ALIGNED_KEYS is defined)
+
+hashTableStatus_t hashTableSetCtor(hashTableSet_t *set, size_t bucketsCount);
+hashTableStatus_t hashTableSetDtor(hashTableSet_t *set);
+
+/// @brief Rehash set to expectedKeys / SET_RESERVE_LOAD_FACTOR buckets if it has fewer
+hashTableStatus_t hashTableSetReserve(hashTableSet_t *set, size_t expectedKeys);
+
+/// @brief Add key to the set
+/// @param inserted Set to true if key wasn't in the set before, may be NULL
+hashTableStatus_t hashTableSetInsert(hashTableSet_t *set, const char *key, bool *inserted);
+
+bool hashTableContains(hashTableSet_t *set, const char *key);
+
+/*!
+    @brief hashTableContains for every key. Keys are hashed and their buckets are prefetched
+    some keys ahead of the searched one, so cache misses of neighbouring keys overlap
+    @param found Receives result of each key, in order of keys
+    @return Number of keys found
+*/
+size_t hashTableContainsBatch(hashTableSet_t *set, const char *const *keys, size_t count, bool *found);
+
+/// @return HT_NO_KEY if key is not in the set
+hashTableStatus_t hashTableSetErase(hashTableSet_t *set, const char *key);
+
+/// @brief Bytes taken by the set (without hashTableSet_t itself): buckets, overflow arrays with their spare
+/// capacity and long keys, with malloc headers and slack. Counted as hashTableMemoryUsage counts total
+size_t hashTableSetMemoryUsage(const hashTableSet_t *set);
+
+/// @brief Check that every key is in its bucket only once and sizes add up
+hashTableStatus_t hashTableSetVerify(hashTableSet_t *set);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef HYPER_LOG_LOG_H
+#define HYPER_LOG_LOG_H
+
+#include <stdint.h>
+
+#include "perfTester.h"
+
+/*! Number of index bits: 2^HLL_PRECISION registers, standard error is about 1.04 / sqrt(2^HLL_PRECISION) */
+static const int HLL_PRECISION = 12;
+static const int HLL_REGISTERS = 1 << HLL_PRECISION;
+
+/// @brief Streaming estimator of number of distinct elements (HyperLogLog)
+typedef struct {
+    uint8_t registers[HLL_REGISTERS]; ///< Max rank of hashes that fell into each register
+} hyperLogLog_t;
+
+void hllInit(hyperLogLog_t *hll);
+
+/// @brief Add element by its 64-bit hash. Hash must be well mixed: all bits are used
+void hllAddHash(hyperLogLog_t *hll, uint64_t hash);
+
+/// @brief Hash C-string for hllAddHash
+uint64_t hllHashString(const char *str);
+
+/// @brief Estimated number of distinct elements added so far
+double hllEstimate(const hyperLogLog_t *hll);
+
+/// @brief One pass over text: estimated number of distinct words
+int64_t textEstimateUniqueWords(text_t text);
+
+#endif
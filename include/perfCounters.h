@@ -0,0 +1,50 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* ================================================================================ */
+/* Hardware counters of one benchmark phase (perf_event_open on the calling thread) */
+/* Sibling of codeClock_t: open, start/stop around measured code, close             */
+/* ================================================================================ */
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,        ///< L1 data cache read misses
+    PERF_LLC_MISSES,        ///< Last level cache read misses
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,       ///< Data TLB read misses
+    PERF_COUNTERS_COUNT
+} perfCounter_t;
+
+typedef struct {
+    int      groupFd;                           ///< First opened counter, -1 if none could be opened
+    int      fds[PERF_COUNTERS_COUNT];          ///< -1 for counters not supported here
+    uint64_t values[PERF_COUNTERS_COUNT];       ///< Counted between start and stop (scaled if multiplexed)
+    bool     counted[PERF_COUNTERS_COUNT];      ///< Value is valid
+    int      error;                             ///< errno of the first counter that failed to open
+} perfCounters_t;
+
+/// @brief Open counter group of the calling thread (user space only, so it works with perf_event_paranoid <= 2)
+/// Counters that are missing (no PMU in VM, no permission) are skipped
+/// @return false if no counter could be opened
+bool perfCountersOpen(perfCounters_t *counters);
+void perfCountersClose(perfCounters_t *counters);
+
+/// @brief Reset and enable all counters of the group at once
+void perfCountersStart(perfCounters_t *counters);
+/// @brief Disable group and read values
+void perfCountersStop(perfCounters_t *counters);
+
+/// @brief Print counters divided by ops (per operation), IPC and reason of missing counters.
+/// Values read by perfCountersStop stay valid after perfCountersClose
+void perfCountersPrint(FILE *file, const char *phase, const perfCounters_t *counters, int64_t ops);
+
+#define MEASURE_COUNTERS(counters, ...) \
+    perfCountersStart(&counters);       \
+    __VA_ARGS__                         \
+    perfCountersStop(&counters);
+
+#endif
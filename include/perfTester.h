@@ -7,6 +7,20 @@
 
 static const int TEST_LOOPS = 10;
 const int HASH_TABLE_SIZE = 1500;
+/// Load factors (elements per bucket) checked by testLoadFactors
+const size_t LOAD_FACTORS[] = {1, 2, 4, 8, 16};
+/// Nodes checked per operation by hashTableVerifyIncremental in testVerifyBudgets
+const size_t VERIFY_BUDGETS[] = {1, 4, 16, 64, 256};
+/// Number of round-robin runs of all policies in testPolicies
+static const int POLICY_ROUNDS = 3;
+/// Number of words in synthetic corpus of testBulkInsert (should be much larger than LLC)
+static const int64_t BULK_TEST_WORDS = 16000000;
+/// Vocabulary, number of requests and load factor of testSkewedTraffic
+static const int64_t SKEW_TEST_VOCABULARY  = 1 << 20;
+static const int64_t SKEW_TEST_REQUESTS    = 8000000;
+static const size_t  SKEW_TEST_LOAD_FACTOR = 4;
+/// Exponent of Zipf's law for natural language
+static const double  SKEW_TEST_EXPONENT    = 1.0;
 
 #define ALIGN_USER_KEYS
 
@@ -38,7 +52,138 @@ text_t readFileSplitUnaligned(const char *fileName);
 
 void textDtor(text_t *text);
 
+/// @brief Read raw text: words are runs of letters converted to lower case (as scripts/prepareText.c does)
+/// Words are aligned and padded as in readFileSplitAligned
+text_t readCorpusAligned(const char *fileName);
+
+/// @brief xorshift64* PRNG used by synthetic texts. State must be non-zero
+uint64_t xorshiftNext(uint64_t *state);
+
+static const uint64_t RANDOM_WORD_MIN_LEN = 3;
+static const uint64_t RANDOM_WORD_MAX_LEN = 14;
+
+/// @brief Text of wordsCount words uniformly drawn from vocabulary of random words (3-14 letters)
+/// Words are aligned and padded as in readFileSplitAligned; same seed gives same text
+text_t generateRandomText(int64_t wordsCount, int64_t vocabulary, uint64_t seed);
+
+/// @brief Text drawn from the same vocabulary as generateRandomText with the same seed,
+/// but with Zipf distribution: frequency of k-th most frequent word ~ 1 / k^exponent (0 is uniform).
+/// Ranks are assigned to words of vocabulary in random order
+text_t generateZipfText(int64_t wordsCount, int64_t vocabulary, double exponent, uint64_t seed);
+
+/// Requests per repetition of lookup scenarios of testHarness
+static const int64_t HARNESS_REQUESTS = 2000000;
+/// Size of the pool of random words that are (almost) never found
+static const int64_t HARNESS_GIBBERISH = 1 << 16;
+/// Parts of found words in miss-heavy and mixed scenarios, parts of inserts and erases in mixed one
+static const double  HARNESS_MISS_HEAVY_FOUND = 0.1;
+static const double  HARNESS_MIXED_FOUND      = 0.9;
+static const double  HARNESS_MIXED_INSERT     = 0.1;
+static const double  HARNESS_MIXED_ERASE      = 0.1;
+
+/// Every LATENCY_SAMPLE_PERIOD-th call is timed by testLatency, others run without fences in between
+static const int64_t LATENCY_SAMPLE_PERIOD       = 4;
+/// Empty measurements used to estimate overhead of timing
+static const int     LATENCY_CALIBRATION_SAMPLES = 1000000;
+
+/// Vocabulary, requests and load factor of testHugePages: table of about 400 MB, far beyond L2 and most LLCs
+static const int64_t HUGE_PAGE_TEST_VOCABULARY  = 1 << 23;
+static const int64_t HUGE_PAGE_TEST_REQUESTS    = 1 << 23;
+static const size_t  HUGE_PAGE_TEST_LOAD_FACTOR = 2;
+
+/// Vocabulary, requests and load factor of testNumaReplicas
+static const int64_t NUMA_TEST_VOCABULARY  = 1 << 22;
+static const int64_t NUMA_TEST_REQUESTS    = 1 << 23;
+static const size_t  NUMA_TEST_LOAD_FACTOR = 2;
+static const int     NUMA_TEST_ROUNDS      = 3;
+
+/// Random words looked up as misses by testProbeCost
+static const int64_t PROBE_TEST_MISSES = 1 << 16;
+
+/// Random words checked by testCollisions: about 1 / COLLISION_TEST_BUCKETS of them fall into bucket 0
+static const int64_t COLLISION_TEST_CANDIDATES = 1 << 22;
+static const size_t  COLLISION_TEST_BUCKETS    = 256;
+/// Colliding keys inserted by testCollisions, as many other colliding keys are looked up as misses
+static const int64_t COLLISION_TEST_KEYS       = 4096;
+
+/// Keys of testIntKeys, as many hits and misses are looked up
+static const int64_t INT_TEST_KEYS = 1 << 20;
+
+/// Keys of testEmplace and the biggest size of their values
+static const int64_t EMPLACE_TEST_KEYS      = 1 << 18;
+static const size_t  EMPLACE_TEST_MAX_VALUE = 256;
+
+/// Words of 16+ letters are few in corpora: testPackedKeys packs and looks them up in repeated passes
+/// until at least this many keys are done
+static const int64_t PACKED_TEST_MIN_KEYS = 1 << 16;
+
+/// Sequential keys whose dispersion is measured by testSeededHash, and keys of every length in its speed test
+static const int64_t SEEDED_TEST_KEYS = 1 << 17;
+
+/// Size of values in the second table of testMemoryUsage: too big to be stored in nodes
+static const size_t MEMORY_TEST_BIG_VALUE = 64;
+
+/// Prefixes of requests in workload files (see scripts/generateTest.c), requests without prefix are finds
+static const char WORKLOAD_INSERT = '+';
+static const char WORKLOAD_ERASE  = '-';
+
+typedef struct {
+    text_t keys;    ///< Keys without prefixes, aligned and padded as in readFileSplitAligned
+    char  *ops;     ///< WORKLOAD_INSERT, WORKLOAD_ERASE or 0 (find) for every key
+} workload_t;
+
+/// @brief Read workload file: one request per line, optional operation prefix
+workload_t readWorkload(const char *fileName);
+void workloadDtor(workload_t *workload);
+
 void testPerformance(const char *stringsFile, const char *requestsFile, bool printLess);
+void testLoadFactors(const char *stringsFile, const char *requestsFile);
+void testTypedFrontend(const char *stringsFile, const char *requestsFile);
+void testPolicies(const char *stringsFile, const char *requestsFile);
+void testReserve(const char *stringsFile);
+void testBulkInsert(int64_t wordsCount);
+void testSkewedTraffic();
+void testWorkload(const char *stringsFile, const char *workloadFile);
+/// @brief Latency percentiles of single hashTableAccess (build) and hashTableFind (requests) calls,
+/// split by hit/miss and short/long key
+void testLatency(const char *stringsFile, const char *requestsFile);
+/// @brief Cost of finds followed by incremental verification with different budgets, of full verification
+/// and of starting verification of snapshot in background
+void testVerifyBudgets(const char *stringsFile, const char *requestsFile);
+/// @brief Bytes per key on corpora after build, compaction, erase of half of keys and second compaction
+void testMemoryUsage();
+/// @brief Lookups in big table with v2_all and v2_hugePages policies, before and after hashTableCompact:
+/// ns per lookup, dTLB misses and amount of transparent huge pages
+void testHugePages();
+/// @brief Table built on one node and its replicas (see hashTableNuma.h): reader pinned to every node
+/// looks up in the original and in its local replica. Set HASH_TABLE_FAKE_NUMA=N to emulate N nodes
+void testNumaReplicas();
+/// @brief Keys compared and cache lines read per hit and miss of v2 and cuckoo policies on corpora (average
+/// and worst case, see hashTableProbeCost), with latency percentiles of the same finds
+void testProbeCost();
+/// @brief Build, hits and misses of table where all keys collide, with and without sorted overflow arrays
+void testCollisions();
+/// @brief Counting words by interned IDs and dense array against counters stored in the table
+void testInterning(const char *stringsFile);
+/// @brief Integer-keyed table against the same keys encoded as strings
+void testIntKeys();
+/// @brief Word count on corpora and Zipf text by access and increment through pointer, hashTableIncrement
+/// and hashTableIncrementBatch, in table of default size and in table reserved for unique words
+void testIncrement();
+/// @brief Get-or-create of new and existing keys with 64 and 256-byte values: find and insert of temporary,
+/// access and fill in place, hashTableEmplace
+void testEmplace();
+/// @brief Membership lookups and bytes per key of table with int values against set with key-only nodes
+void testSet(const char *stringsFile, const char *requestsFile);
+/// @brief Fraction of unique words kept in nodes, cost of packing and lookups of all words and of 16+ letter words
+/// in tables with and without packed keys (see PACKED_KEYS) on corpora
+void testPackedKeys();
+/// @brief Seeded aesHash16 and aesHash against unseeded crc32: ticks per key of short and long keys, dispersion
+/// of corpora words, sequential keys and keys crafted to collide under crc32, lookups of v2_all and v2_seededHash
+void testSeededHash();
+/// @brief Scenarios on corpora with warm-up, repetitions and statistics. Options are name=value:
+/// reps, warmup, cpu (-1: current one), scenario, corpus (filters) and json (file for results)
+int testHarness(int argc, const char *argv[]);
 
 #define CODE_CLOCK_MODE CLOCK_THREAD_CPUTIME_ID
 
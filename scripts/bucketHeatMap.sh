@@ -0,0 +1,64 @@
+#!/bin/sh
+# Heat map of buckets built from USDT probes of hashTable (hashTable_v2.c).
+# Needs bpftrace, root and a build that found <sys/sdt.h>. Run from directory with test files:
+#   sudo scripts/bucketHeatMap.sh ./hashMap.exe [arguments of hashMap.exe]
+# Every character is one bucket, darker characters are buckets with more lookups.
+# Bucket indexes of all tables created by the program are merged.
+
+BINARY=${1:-./hashMap.exe}
+[ $# -gt 0 ] && shift
+ROW_LENGTH=${ROW_LENGTH:-100}
+
+bpftrace -q -c "$BINARY $*" -e "
+usdt:$BINARY:hashTable:lookup             { @lookups[arg0] = count(); @size[arg0] = max(arg1); }
+usdt:$BINARY:hashTable:lookup /arg3 == 0/ { @misses[arg0] = count(); }
+usdt:$BINARY:hashTable:allocate /arg3/    { @reallocs[arg0] = count(); }
+usdt:$BINARY:hashTable:long_key_search    { @longSearches = count(); @longScanned = sum(arg0); }
+" 2>/dev/null | awk -v rowLength="$ROW_LENGTH" '
+    # bpftrace prints maps as "@name[key]: value" and scalars as "@name: value"
+    /^@[a-zA-Z]+\[/ {
+        line = $0
+        gsub(/[\[\]:]/, " ", line)
+        split(line, field, " ")
+        name = substr(field[1], 2); key = field[2] + 0; value = field[3] + 0
+        data[name, key] = value
+        if (name == "lookups" && key > maxBucket) maxBucket = key
+        if (name == "lookups" && value > maxLookups) maxLookups = value
+        next
+    }
+    /^@[a-zA-Z]+:/ { scalar[substr($1, 2, length($1) - 2)] = $NF; next }
+
+    END {
+        if (maxLookups == 0) {
+            print "No probes fired: is bpftrace running as root and was <sys/sdt.h> found at build time?"
+            exit 1
+        }
+
+        shades = " .:-=+*#%@"
+        printf "Lookups per bucket, \"%s\" from 0 to %d lookups\n", shades, maxLookups
+        for (bucket = 0; bucket <= maxBucket; bucket++) {
+            if (bucket % rowLength == 0)
+                printf "%s%6d |", (bucket ? "|\n" : ""), bucket
+            shade = int(data["lookups", bucket] * (length(shades) - 1) / maxLookups + 0.5)
+            printf "%s", substr(shades, shade + 1, 1)
+        }
+        printf "|\n\n"
+
+        # Hottest buckets by selection of maximum, there are only a few thousands of buckets
+        printf "%8s %10s %10s %8s %8s\n", "bucket", "lookups", "misses", "size", "reallocs"
+        for (top = 0; top < 10; top++) {
+            best = -1
+            for (bucket = 0; bucket <= maxBucket; bucket++)
+                if (!((bucket) in printed) && (best < 0 || data["lookups", bucket] > data["lookups", best]))
+                    best = bucket
+            if (data["lookups", best] == 0)
+                break
+            printed[best] = 1
+            printf "%8d %10d %10d %8d %8d\n", best, data["lookups", best], data["misses", best],
+                   data["size", best], data["reallocs", best]
+        }
+
+        if (scalar["longSearches"])
+            printf "\nLong key searches: %d, average size of array of long keys: %.1f\n",
+                   scalar["longSearches"], scalar["longScanned"] / scalar["longSearches"]
+    }'
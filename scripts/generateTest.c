@@ -1,9 +1,28 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <assert.h>
-// #include <random.h>
-
+#include <nmmintrin.h>
+
+/* ================================================================================ */
+/* Generator of request streams for hashMap.exe                                     */
+/*                                                                                  */
+/* Usage: generateTest.exe <words file> <output file> <requests> <found part> [option=value ...] */
+/*   found part - part of keys taken from words file, others are random gibberish   */
+/* Options (parts are fractions of all requests):                                   */
+/*   seed=1        seed of PRNG: same arguments give the same stream                */
+/*   zipf=0        exponent of Zipf's law over unique words of the file,            */
+/*                 0 keeps frequencies of the words in the file                     */
+/*   insert=0      part of inserts, written as +key                                 */
+/*   erase=0       part of erases, written as -key (other requests are finds)       */
+/*   long=0        part of keys from the pool of long keys (16 chars and longer)    */
+/*   collide=0     part of keys from the pool of keys colliding in one bucket       */
+/*   buckets=1500  number of buckets of the table that colliding keys are built for */
+/*   minlen=3 maxlen=14  lengths of random gibberish                                */
+/* ================================================================================ */
 
 int64_t getFileLen(FILE *file) {
     fseek(file, 0, SEEK_END);
@@ -12,36 +31,97 @@ int64_t getFileLen(FILE *file) {
     return len;
 }
 
-const int MAX_WORD_LEN = 32;
-const int MIN_RNDWORD_LEN = 3;
-const int MAX_RNDWORD_LEN = 14;
-const int BUFFERING_SIZE = 1 << 18;
+const int MAX_WORD_LEN = 64;
+const int BUFFERING_SIZE = 1 << 20;
+
+/// Long keys are concatenations of words of the file, at least LONG_KEY_MIN_LEN chars
+const int LONG_KEY_MIN_LEN   = 16;
+const int LONG_KEYS_POOL     = 4096;
+/// Colliding keys are random words with crc32 of aligned block giving the same bucket
+const int COLLIDE_KEY_MIN_LEN = 4;
+const int COLLIDE_KEY_MAX_LEN = 12;
+const int COLLIDE_KEYS_POOL   = 1024;
+
+typedef struct {
+    char *data;
+    int64_t length;
+    char **words;
+    int64_t wordsCount;
+} text_t;
+
+typedef struct {
+    uint64_t seed;
+    double zipf;
+    double insertPart;
+    double erasePart;
+    double longPart;
+    double collidePart;
+    uint64_t buckets;
+    int minLen;
+    int maxLen;
+} generatorOptions_t;
+
+/* ========================== PRNG ==================== */
+/// xorshift64*: much faster than rand() and gives the same stream on every platform
+static uint64_t rngState = 1;
+
+static inline uint64_t rngNext() {
+    uint64_t x = rngState;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rngState = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+/// Uniform double in [0, 1)
+static inline double rngUniform() {
+    return (double) (rngNext() >> 11) * 0x1.0p-53;
+}
 
-int generateRandomWord(char *word, int minLen, int maxLen) {
+static int generateRandomWord(char *word, int minLen, int maxLen) {
     assert(minLen > 0);
-    assert(maxLen > minLen);
+    assert(maxLen >= minLen && maxLen <= MAX_WORD_LEN);
 
-    int len = minLen + rand() % (maxLen - minLen);
+    int len = minLen + (int) (rngNext() % (uint64_t) (maxLen - minLen + 1));
     for (int idx = 0; idx < len; idx++) {
-        word[idx] = 'a' + rand() % ('z' - 'a');
+        word[idx] = (char) ('a' + rngNext() % 26);
     }
     word[len] = '\0';
     return len;
 }
 
+/* ========================== Zipf sampling ==================== */
+/// Alias table (Vose's method): O(1) per sample for any number of words
 typedef struct {
-    char *data;
-    int64_t length;
-    char **words;
-    int64_t wordsCount;
-} text_t;
+    double   *prob;
+    uint32_t *alias;
+    uint32_t  count;
+} aliasTable_t;
+
+static aliasTable_t buildZipfAlias(uint32_t count, double exponent);
+static inline uint32_t aliasSample(const aliasTable_t *table) {
+    uint32_t idx = (uint32_t) (rngNext() % table->count);
+    return (rngUniform() < table->prob[idx]) ? idx : table->alias[idx];
+}
+
+/* ========================== Pools of keys ==================== */
+static char *buildLongKeys(text_t uniqueWords);
+static char *buildCollidingKeys(const generatorOptions_t *options);
 
 text_t readFileSplit(const char *fileName);
+static text_t uniqueWordsOf(text_t text);
+static bool parseOption(generatorOptions_t *options, const char *arg);
 
-void writeTestsToFile(const char *fileName, text_t text, int tests, float foundPercent);
+void writeTestsToFile(const char *fileName, text_t text, int64_t tests, double foundPercent,
+                      const generatorOptions_t *options);
 
 
 int main(int argc, const char *argv[]) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <words file> <output file> <requests> <found part> [option=value ...]\n", argv[0]);
+        return 1;
+    }
 
     text_t text = readFileSplit(argv[1]);
     if (!text.data) {
@@ -49,10 +129,25 @@ int main(int argc, const char *argv[]) {
         return 1;
     }
 
-    int totalRequests = 0; sscanf(argv[3], "%d", &totalRequests);
-    float foundPercent = 0.; sscanf(argv[4], "%f", &foundPercent);
+    int64_t totalRequests = 0; sscanf(argv[3], "%ji", &totalRequests);
+    double foundPercent = 0.; sscanf(argv[4], "%lf", &foundPercent);
+
+    generatorOptions_t options = {1, 0., 0., 0., 0., 0., 1500, 3, 14};
+    for (int argIdx = 5; argIdx < argc; argIdx++) {
+        if (!parseOption(&options, argv[argIdx])) {
+            fprintf(stderr, "Unknown option %s\n", argv[argIdx]);
+            return 1;
+        }
+    }
+    if (options.insertPart + options.erasePart > 1 || options.longPart + options.collidePart > 1 ||
+        options.minLen < 1 || options.maxLen < options.minLen || options.maxLen > MAX_WORD_LEN || options.buckets == 0) {
+        fprintf(stderr, "Inconsistent options\n");
+        return 1;
+    }
+
+    rngState = options.seed | 1;
 
-    writeTestsToFile(argv[2], text, totalRequests, foundPercent);
+    writeTestsToFile(argv[2], text, totalRequests, foundPercent, &options);
 
     free(text.words);
     free(text.data);
@@ -60,6 +155,20 @@ int main(int argc, const char *argv[]) {
     return 0;
 }
 
+static bool parseOption(generatorOptions_t *options, const char *arg) {
+    unsigned long long seed = 0, buckets = 0;
+    if (sscanf(arg, "seed=%llu", &seed) == 1)               { options->seed = seed;       return true; }
+    if (sscanf(arg, "buckets=%llu", &buckets) == 1)         { options->buckets = buckets; return true; }
+    if (sscanf(arg, "zipf=%lf", &options->zipf) == 1)           return true;
+    if (sscanf(arg, "insert=%lf", &options->insertPart) == 1)   return true;
+    if (sscanf(arg, "erase=%lf", &options->erasePart) == 1)     return true;
+    if (sscanf(arg, "long=%lf", &options->longPart) == 1)       return true;
+    if (sscanf(arg, "collide=%lf", &options->collidePart) == 1) return true;
+    if (sscanf(arg, "minlen=%d", &options->minLen) == 1)        return true;
+    if (sscanf(arg, "maxlen=%d", &options->maxLen) == 1)        return true;
+    return false;
+}
+
 text_t readFileSplit(const char *fileName) {
     text_t result = {0};
 
@@ -76,7 +185,7 @@ text_t readFileSplit(const char *fileName) {
     char *text = (char*) calloc(result.length + 1, 1); // last byte serves as terminator
     char **words = (char **) calloc(result.length, sizeof(char *));
 
-    assert(fread(text, 1, result.length, file) == result.length);
+    assert(fread(text, 1, result.length, file) == (size_t) result.length);
     fclose(file);
 
     int64_t wordCount = 0;
@@ -108,34 +217,204 @@ text_t readFileSplit(const char *fileName) {
     return result;
 }
 
-void writeTestsToFile(const char *fileName, text_t text, int tests, float foundPercent) {
+static int compareWords(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/// @brief Unique words of the text (data is shared with text)
+static text_t uniqueWordsOf(text_t text) {
+    text_t result = {0};
+    result.words = (char **) calloc(text.wordsCount, sizeof(char *));
+    assert(result.words);
+
+    memcpy(result.words, text.words, text.wordsCount * sizeof(char *));
+    qsort(result.words, text.wordsCount, sizeof(char *), compareWords);
+
+    for (int64_t idx = 0; idx < text.wordsCount; idx++) {
+        if (result.wordsCount == 0 || strcmp(result.words[result.wordsCount - 1], result.words[idx]) != 0)
+            result.words[result.wordsCount++] = result.words[idx];
+    }
+
+    return result;
+}
+
+static aliasTable_t buildZipfAlias(uint32_t count, double exponent) {
+    aliasTable_t table = {0};
+    table.count = count;
+    table.prob  = (double *)   calloc(count, sizeof(double));
+    table.alias = (uint32_t *) calloc(count, sizeof(uint32_t));
+    uint32_t *small = (uint32_t *) calloc(count, sizeof(uint32_t));
+    uint32_t *large = (uint32_t *) calloc(count, sizeof(uint32_t));
+    assert(table.prob && table.alias && small && large);
+
+    double total = 0;
+    for (uint32_t rank = 0; rank < count; rank++)
+        total += pow((double) rank + 1, -exponent);
+
+    // Scaled probabilities: average is 1
+    uint32_t smallCount = 0, largeCount = 0;
+    for (uint32_t rank = 0; rank < count; rank++) {
+        table.prob[rank] = pow((double) rank + 1, -exponent) / total * count;
+        if (table.prob[rank] < 1) small[smallCount++] = rank;
+        else                      large[largeCount++] = rank;
+    }
+
+    while (smallCount && largeCount) {
+        uint32_t less = small[--smallCount], more = large[--largeCount];
+        table.alias[less] = more;
+        table.prob[more] -= 1 - table.prob[less];
+        if (table.prob[more] < 1) small[smallCount++] = more;
+        else                      large[largeCount++] = more;
+    }
+    // Leftovers differ from 1 only by rounding errors
+    while (smallCount) table.prob[small[--smallCount]] = 1;
+    while (largeCount) table.prob[large[--largeCount]] = 1;
+
+    free(small);
+    free(large);
+    return table;
+}
+
+static char *buildLongKeys(text_t uniqueWords) {
+    char *keys = (char *) calloc(LONG_KEYS_POOL, MAX_WORD_LEN + 1);
+    assert(keys);
+
+    for (int keyIdx = 0; keyIdx < LONG_KEYS_POOL; keyIdx++) {
+        char *key = keys + keyIdx * (MAX_WORD_LEN + 1);
+        int len = 0;
+        while (len < LONG_KEY_MIN_LEN) {
+            const char *word = uniqueWords.words[rngNext() % uniqueWords.wordsCount];
+            int wordLen = (int) strlen(word);
+            if (len + wordLen > MAX_WORD_LEN)
+                wordLen = MAX_WORD_LEN - len;
+            memcpy(key + len, word, wordLen);
+            len += wordLen;
+        }
+    }
+
+    return keys;
+}
+
+/// @brief crc32 of key in aligned zero-padded block, same as fastCrc32_16 in the default build
+static uint64_t alignedKeyCrc32(const char *key) {
+    alignas(16) char block[16] = {0};
+    memcpy(block, key, strlen(key));
+    uint64_t crc = 0xFFFFFFFF;
+    crc = _mm_crc32_u64(crc, *(const uint64_t *) block);
+    crc = _mm_crc32_u64(crc, *(const uint64_t *) (block + 8));
+    return crc;
+}
+
+static char *buildCollidingKeys(const generatorOptions_t *options) {
+    char *keys = (char *) calloc(COLLIDE_KEYS_POOL, MAX_WORD_LEN + 1);
+    assert(keys);
+
+    // All keys go to the bucket of the first one: expected buckets tries per key
+    uint64_t targetBucket = 0;
+    for (int keyIdx = 0; keyIdx < COLLIDE_KEYS_POOL; keyIdx++) {
+        char *key = keys + keyIdx * (MAX_WORD_LEN + 1);
+        do {
+            generateRandomWord(key, COLLIDE_KEY_MIN_LEN, COLLIDE_KEY_MAX_LEN);
+        } while (keyIdx > 0 && alignedKeyCrc32(key) % options->buckets != targetBucket);
+
+        if (keyIdx == 0)
+            targetBucket = alignedKeyCrc32(key) % options->buckets;
+    }
+
+    return keys;
+}
+
+/// @brief Buffered writer: one fwrite per BUFFERING_SIZE bytes instead of fputs per word
+typedef struct {
+    FILE *file;
+    char *buffer;
+    size_t used;
+} outBuffer_t;
+
+static inline void outWrite(outBuffer_t *out, const char *str, size_t len) {
+    if (out->used + len > (size_t) BUFFERING_SIZE) {
+        fwrite(out->buffer, 1, out->used, out->file);
+        out->used = 0;
+    }
+    memcpy(out->buffer + out->used, str, len);
+    out->used += len;
+}
+
+void writeTestsToFile(const char *fileName, text_t text, int64_t tests, double foundPercent,
+                      const generatorOptions_t *options) {
     FILE *output = fopen(fileName, "w");
     if (!output) {
         fprintf(stderr, "Failed to open %s for writing\n", fileName);
         return;
     }
 
-    setvbuf(output, NULL, _IOFBF, BUFFERING_SIZE);
-    int wordsFromText = 0;
+    outBuffer_t out = {output, (char *) calloc(BUFFERING_SIZE, 1), 0};
+    assert(out.buffer);
+
+    text_t uniqueWords = uniqueWordsOf(text);
+    fprintf(stderr, "Unique words: %ji\n", uniqueWords.wordsCount);
+
+    // Zipf ranks are shuffled, so frequent words are not sorted alphabetically
+    aliasTable_t zipf = {0};
+    if (options->zipf > 0) {
+        zipf = buildZipfAlias((uint32_t) uniqueWords.wordsCount, options->zipf);
+        for (int64_t idx = uniqueWords.wordsCount - 1; idx > 0; idx--) {
+            int64_t swapIdx = (int64_t) (rngNext() % (uint64_t) (idx + 1));
+            char *tmp = uniqueWords.words[idx];
+            uniqueWords.words[idx] = uniqueWords.words[swapIdx];
+            uniqueWords.words[swapIdx] = tmp;
+        }
+    }
+
+    char *longKeys      = (options->longPart > 0)    ? buildLongKeys(uniqueWords)    : NULL;
+    char *collidingKeys = (options->collidePart > 0) ? buildCollidingKeys(options)   : NULL;
 
-    for (int cnt = 0; cnt < tests; cnt++) {
-        float normalRand = (float) rand() / RAND_MAX;
-        bool wordFromText = normalRand <= foundPercent;
+    int64_t wordsFromText = 0, inserts = 0, erases = 0, longKeysCount = 0, collisions = 0;
 
-        if (wordFromText) {
+    for (int64_t cnt = 0; cnt < tests; cnt++) {
+        const double opRand = rngUniform();
+        if (opRand < options->insertPart) {
+            outWrite(&out, "+", 1);
+            inserts++;
+        } else if (opRand < options->insertPart + options->erasePart) {
+            outWrite(&out, "-", 1);
+            erases++;
+        }
+
+        const char *key = NULL;
+        char word[MAX_WORD_LEN+1];
+
+        const double keyRand = rngUniform();
+        if (keyRand < options->collidePart) {
+            key = collidingKeys + (rngNext() % COLLIDE_KEYS_POOL) * (MAX_WORD_LEN + 1);
+            collisions++;
+        } else if (keyRand < options->collidePart + options->longPart) {
+            key = longKeys + (rngNext() % LONG_KEYS_POOL) * (MAX_WORD_LEN + 1);
+            longKeysCount++;
+        } else if (rngUniform() < foundPercent) {
+            key = (options->zipf > 0) ? uniqueWords.words[aliasSample(&zipf)]
+                                      : text.words[rngNext() % text.wordsCount];
             wordsFromText++;
-            int idx = rand() % text.wordsCount;
-            fputs(text.words[idx], output);
         } else {
-            char word[MAX_WORD_LEN+1];
-            generateRandomWord(word, MIN_RNDWORD_LEN, MAX_RNDWORD_LEN);
-            fputs(word, output);
+            generateRandomWord(word, options->minLen, options->maxLen);
+            key = word;
         }
 
-        fputc('\n', output);
+        outWrite(&out, key, strlen(key));
+        outWrite(&out, "\n", 1);
     }
 
-    printf("Words from text: %d\n", wordsFromText);
+    fwrite(out.buffer, 1, out.used, output);
+
+    printf("Words from text: %ji, long keys: %ji, colliding keys: %ji\n", wordsFromText, longKeysCount, collisions);
+    printf("Inserts: %ji, erases: %ji\n", inserts, erases);
+
+    free(out.buffer);
+    free(uniqueWords.words);
+    free(zipf.prob);
+    free(zipf.alias);
+    free(longKeys);
+    free(collidingKeys);
     fclose(output);
     return;
 }
@@ -0,0 +1,282 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <sched.h>
+
+#include "benchHarness.h"
+#include "perfTester.h"
+
+int benchPinThread(int cpu) {
+    if (cpu < 0)
+        cpu = sched_getcpu();
+    if (cpu < 0)
+        return -1;
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET((size_t) cpu, &cpuSet);
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+        return -1;
+
+    return cpu;
+}
+
+void benchRun(const benchCase_t *benchCase, int warmup, int reps, benchResult_t *result) {
+    assert(benchCase);
+    assert(benchCase->run);
+    assert(result);
+    assert(reps > 0 && reps <= BENCH_MAX_REPS);
+
+    memset(result, 0, sizeof(*result));
+    result->benchCase = benchCase;
+
+    for (int rep = -warmup; rep < reps; rep++) {
+        if (benchCase->setup)
+            benchCase->setup(benchCase->ctx);
+
+        codeClock_t clock;
+        int64_t ops = 0;
+        MEASURE_TIME(clock,
+            ops = benchCase->run(benchCase->ctx);
+        )
+
+        if (benchCase->teardown)
+            benchCase->teardown(benchCase->ctx);
+
+        // Warm-up runs fill caches and let frequency settle, their results are dropped
+        if (rep < 0)
+            continue;
+
+        result->ops = ops;
+        result->ticks[rep] = (double) (clock.clocksEnd - clock.clocksStart) / (double) (ops ? ops : 1);
+        result->ms[rep]    = codeClockGetTimeMs(&clock);
+    }
+
+    benchComputeStats(result->ticks, reps, &result->ticksStats);
+    benchComputeStats(result->ms,    reps, &result->msStats);
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    const double lhs = *(const double *) a, rhs = *(const double *) b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+/// Quantile of sorted samples with linear interpolation
+static double quantile(const double *sorted, int count, double q) {
+    const double pos = q * (count - 1);
+    const int lower = (int) pos;
+    if (lower + 1 >= count)
+        return sorted[count - 1];
+    return sorted[lower] + (pos - lower) * (sorted[lower + 1] - sorted[lower]);
+}
+
+/// Two-sided 95% quantile of Student's t-distribution
+static double studentT95(int degreesOfFreedom) {
+    static const double T95[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+         2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+         2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    const int tableSize = (int) (sizeof(T95) / sizeof(T95[0]));
+
+    if (degreesOfFreedom < 1)
+        return 0;
+    if (degreesOfFreedom <= tableSize)
+        return T95[degreesOfFreedom - 1];
+    return 1.960;
+}
+
+void benchComputeStats(const double *samples, int count, benchStats_t *stats) {
+    assert(samples);
+    assert(stats);
+    assert(count > 0 && count <= BENCH_MAX_REPS);
+
+    double *sorted = (double *) calloc((size_t) count, sizeof(double));
+    assert(sorted);
+    memcpy(sorted, samples, (size_t) count * sizeof(double));
+    qsort(sorted, (size_t) count, sizeof(double), compareDoubles);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->reps   = count;
+    stats->median = quantile(sorted, count, 0.5);
+
+    const double q1 = quantile(sorted, count, 0.25), q3 = quantile(sorted, count, 0.75);
+    const double lowFence  = q1 - BENCH_OUTLIER_IQR * (q3 - q1);
+    const double highFence = q3 + BENCH_OUTLIER_IQR * (q3 - q1);
+
+    int kept = 0;
+    double sum = 0, sumSquares = 0;
+    stats->min = sorted[count - 1];
+    stats->max = sorted[0];
+    for (int idx = 0; idx < count; idx++) {
+        if (sorted[idx] < lowFence || sorted[idx] > highFence)
+            continue;
+
+        kept++;
+        sum        += sorted[idx];
+        sumSquares += sorted[idx] * sorted[idx];
+        if (sorted[idx] < stats->min) stats->min = sorted[idx];
+        if (sorted[idx] > stats->max) stats->max = sorted[idx];
+    }
+    stats->outliers = count - kept;
+
+    stats->mean = sum / kept;
+    // Sample standard deviation (with N - 1)
+    const double variance = (kept > 1) ? (sumSquares - sum * sum / kept) / (kept - 1) : 0;
+    stats->stddev = sqrt(variance > 0 ? variance : 0);
+
+    const double halfWidth = studentT95(kept - 1) * stats->stddev / sqrt((double) kept);
+    stats->ciLow  = stats->mean - halfWidth;
+    stats->ciHigh = stats->mean + halfWidth;
+
+    free(sorted);
+}
+
+void benchPrintHeader(FILE *file) {
+    fprintf(file, "%-10s %-12s %10s %10s %18s %20s %8s %9s\n", "scenario", "corpus", "ops",
+            "median", "mean +- stddev", "95% CI", "outliers", "median ms");
+}
+
+void benchPrintResult(FILE *file, const benchResult_t *result) {
+    const benchStats_t *stats = &result->ticksStats;
+    fprintf(file, "%-10s %-12s %10ji %10.2f %9.2f +- %6.2f [%8.2f, %8.2f] %5d/%-2d %9.2f\n",
+            result->benchCase->scenario, result->benchCase->corpus, result->ops,
+            stats->median, stats->mean, stats->stddev, stats->ciLow, stats->ciHigh,
+            stats->outliers, stats->reps, result->msStats.median);
+}
+
+static void writeStatsJson(FILE *file, const char *name, const benchStats_t *stats, const double *samples) {
+    fprintf(file, "      \"%s\": {\"median\": %.4f, \"mean\": %.4f, \"stddev\": %.4f, "
+                  "\"ci95\": [%.4f, %.4f], \"min\": %.4f, \"max\": %.4f, \"outliers\": %d, \"samples\": [",
+            name, stats->median, stats->mean, stats->stddev, stats->ciLow, stats->ciHigh,
+            stats->min, stats->max, stats->outliers);
+    for (int rep = 0; rep < stats->reps; rep++)
+        fprintf(file, "%s%.4f", rep ? ", " : "", samples[rep]);
+    fprintf(file, "]}");
+}
+
+bool benchWriteJson(const char *fileName, const char *configJson, int cpu,
+                    const benchResult_t *results, int count) {
+    assert(fileName);
+    assert(configJson);
+    assert(results || count == 0);
+
+    FILE *file = fopen(fileName, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s for writing\n", fileName);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"config\": %s,\n  \"cpu\": %d,\n  \"results\": [\n", configJson, cpu);
+    for (int idx = 0; idx < count; idx++) {
+        const benchResult_t *result = results + idx;
+        fprintf(file, "    {\n      \"scenario\": \"%s\",\n      \"corpus\": \"%s\",\n      \"ops\": %ji,\n",
+                result->benchCase->scenario, result->benchCase->corpus, result->ops);
+        writeStatsJson(file, "ticks_per_op", &result->ticksStats, result->ticks);
+        fprintf(file, ",\n");
+        writeStatsJson(file, "ms", &result->msStats, result->ms);
+        fprintf(file, "\n    }%s\n", (idx + 1 < count) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    fclose(file);
+    return true;
+}
+
+/* ========================== Latency histograms ========================== */
+
+static size_t latencyBucket(uint64_t ticks) {
+    const uint64_t subBuckets = 1ull << LATENCY_SUB_BITS;
+    if (ticks < subBuckets)
+        return ticks;
+
+    const int topBit = 63 - __builtin_clzll(ticks);
+    if (topBit >= LATENCY_MAX_BITS)
+        return LATENCY_BUCKETS - 1;
+
+    // Values [2^topBit, 2^(topBit + 1)) are split into subBuckets buckets of width 2^shift
+    const int shift = topBit - LATENCY_SUB_BITS;
+    return ((size_t) shift << LATENCY_SUB_BITS) + (ticks >> shift);
+}
+
+/// Largest value that falls into bucket
+static uint64_t latencyBucketHighest(size_t bucket) {
+    const size_t subBuckets = (size_t) 1 << LATENCY_SUB_BITS;
+    if (bucket < subBuckets)
+        return bucket;
+
+    const int shift = (int) (bucket >> LATENCY_SUB_BITS) - 1;
+    const uint64_t lowest = (subBuckets + (bucket & (subBuckets - 1))) << shift;
+    return lowest + (1ull << shift) - 1;
+}
+
+void latencyRecord(latencyHistogram_t *hist, uint64_t ticks) {
+    assert(hist);
+
+    hist->counts[latencyBucket(ticks)]++;
+    hist->total++;
+    hist->sum += ticks;
+    if (ticks > hist->max)
+        hist->max = ticks;
+}
+
+uint64_t latencyPercentile(const latencyHistogram_t *hist, double percentile) {
+    assert(hist);
+    assert(percentile >= 0 && percentile <= 100);
+
+    if (hist->total == 0)
+        return 0;
+
+    // Smallest value that is not less than rank recorded values
+    uint64_t rank = (uint64_t) ceil(percentile / 100 * (double) hist->total);
+    if (rank == 0)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += hist->counts[bucket];
+        if (seen >= rank) {
+            const uint64_t highest = latencyBucketHighest(bucket);
+            return (highest < hist->max) ? highest : hist->max;
+        }
+    }
+
+    return hist->max;
+}
+
+uint64_t latencyCalibrate(int samples) {
+    assert(samples > 0);
+
+    latencyHistogram_t *hist = (latencyHistogram_t *) calloc(1, sizeof(latencyHistogram_t));
+    assert(hist);
+
+    for (int sample = 0; sample < samples; sample++) {
+        const uint64_t start = latencyStart();
+        const uint64_t end   = latencyStop();
+        latencyRecord(hist, end - start);
+    }
+
+    const uint64_t overhead = latencyPercentile(hist, 50);
+    free(hist);
+
+    return overhead;
+}
+
+void latencyPrintHeader(FILE *file) {
+    fprintf(file, "%-22s %10s %8s %8s %8s %8s %10s\n", "ticks", "count", "mean", "p50", "p99", "p99.9", "max");
+}
+
+void latencyPrint(FILE *file, const char *name, const latencyHistogram_t *hist) {
+    assert(name);
+    assert(hist);
+
+    if (hist->total == 0) {
+        fprintf(file, "%-22s %10d %8s %8s %8s %8s %10s\n", name, 0, "-", "-", "-", "-", "-");
+        return;
+    }
+
+    fprintf(file, "%-22s %10ju %8.1f %8ju %8ju %8ju %10ju\n", name, hist->total,
+            (double) hist->sum / (double) hist->total, latencyPercentile(hist, 50),
+            latencyPercentile(hist, 99), latencyPercentile(hist, 99.9), hist->max);
+}
@@ -0,0 +1,320 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <x86intrin.h>
+
+#include "hashTableInt.h"
+
+/* ========================== Hash and key compare ========================== */
+
+/// @brief crc32 instruction takes 64-bit operand as is: no length, no loop over chars
+static inline hash_t intKeyHash(uint64_t key) {
+    return _mm_crc32_u64(0xFFFFFFFF, key);
+}
+
+/* Keys of INT_NODES_PER_LOAD adjacent nodes are compared by one load. Key of node i
+   is lane 2 * i, odd lanes are values and are masked out. Loads may cover nodes after
+   the last one: header of the bucket or unused capacity of the overflow array */
+#if defined(__AVX512F__)
+static const uint32_t INT_NODES_PER_LOAD = 4;
+
+static inline uint32_t matchNodes(const hashTableIntNode_t *nodes, uint64_t key) {
+    const __m512i loaded = _mm512_loadu_si512(nodes);
+    return _mm512_cmpeq_epi64_mask(loaded, _mm512_set1_epi64((long long) key)) & 0x55;
+}
+#elif defined(__AVX2__)
+static const uint32_t INT_NODES_PER_LOAD = 2;
+
+static inline uint32_t matchNodes(const hashTableIntNode_t *nodes, uint64_t key) {
+    const __m256i loaded = _mm256_loadu_si256((const __m256i *) nodes);
+    const __m256i equal  = _mm256_cmpeq_epi64(loaded, _mm256_set1_epi64x((long long) key));
+    return (uint32_t) _mm256_movemask_pd(_mm256_castsi256_pd(equal)) & 0x5;
+}
+#else
+static const uint32_t INT_NODES_PER_LOAD = 1;
+
+static inline uint32_t matchNodes(const hashTableIntNode_t *nodes, uint64_t key) {
+    return nodes->key == key;
+}
+#endif
+
+static_assert((INT_BUCKET_INLINE_NODES + 1) % INT_NODES_PER_LOAD == 0, "Loads of inlined nodes must stay in the bucket");
+
+/// @return Index of node with key among nodes[0, count) or count if there's none
+static inline uint32_t searchNodes(const hashTableIntNode_t *nodes, uint32_t count, uint64_t key) {
+    for (uint32_t idx = 0; idx < count; idx += INT_NODES_PER_LOAD) {
+        uint32_t match = matchNodes(nodes + idx, key);
+        if (count - idx < INT_NODES_PER_LOAD)
+            match &= (1u << (2 * (count - idx))) - 1;
+        if (match)
+            return idx + (uint32_t) __builtin_ctz(match) / 2;
+    }
+
+    return count;
+}
+
+static inline hashTableIntNode_t *bucketGetIntNode(hashTableIntBucket_t *bucket, uint32_t idx) {
+    if (idx < INT_BUCKET_INLINE_NODES)
+        return bucket->inlined + idx;
+    return bucket->elements + (idx - INT_BUCKET_INLINE_NODES);
+}
+
+/// @return Index of node with key in bucket or bucket->size if there's none
+static inline uint32_t bucketSearch(const hashTableIntBucket_t *bucket, uint64_t key) {
+    const uint32_t inlined = (bucket->size < INT_BUCKET_INLINE_NODES) ? bucket->size : INT_BUCKET_INLINE_NODES;
+    const uint32_t idx = searchNodes(bucket->inlined, inlined, key);
+    if (idx < inlined || bucket->size <= INT_BUCKET_INLINE_NODES)
+        return idx;
+
+    return INT_BUCKET_INLINE_NODES + searchNodes(bucket->elements, bucket->size - INT_BUCKET_INLINE_NODES, key);
+}
+
+static inline void *getIntValue(const hashTableInt_t *table, hashTableIntNode_t *node) {
+    return (table->valSize > sizeof(node->value)) ? node->value.Ptr : &node->value.Imm;
+}
+
+/* ========================== Allocators ========================== */
+
+/// @brief Allocate array of bucketsCount empty buckets. *bucketsPtr is not changed on failure
+static hashTableStatus_t allocateIntBuckets(size_t bucketsCount, hashTableIntBucket_t **bucketsPtr)
+{
+    const size_t bucketsBytes = bucketsCount * sizeof(hashTableIntBucket_t);
+    hashTableIntBucket_t *buckets = (hashTableIntBucket_t *) aligned_alloc(alignof(hashTableIntBucket_t), bucketsBytes);
+    if (!buckets) {
+        hprintf("Failed to allocate buckets array\n");
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+    memset((void *) buckets, 0, bucketsBytes);
+    *bucketsPtr = buckets;
+
+    return HT_SUCCESS;
+}
+
+/// @brief Free overflow arrays of buckets and the array itself, values are not touched
+static void freeIntBuckets(hashTableIntBucket_t *buckets, size_t bucketsCount)
+{
+    for (size_t idx = 0; idx < bucketsCount; idx++)
+        free(buckets[idx].elements);
+
+    free(buckets);
+}
+
+/// @brief Add node at the end of bucket. Overflow capacity is kept multiple of 4 nodes,
+/// so SIMD loads never leave the array
+static hashTableStatus_t bucketAppendIntNode(hashTableIntBucket_t *bucket, hashTableIntNode_t **node)
+{
+    if (bucket->size >= INT_BUCKET_INLINE_NODES && bucket->size - INT_BUCKET_INLINE_NODES == bucket->capacity) {
+        const uint32_t newCapacity = bucket->capacity ? 2 * bucket->capacity : 4;
+        hashTableIntNode_t *newElements =
+            (hashTableIntNode_t *) realloc(bucket->elements, newCapacity * sizeof(hashTableIntNode_t));
+        if (!newElements) {
+            hprintf("Failed to reallocate overflow array\n");
+            _ERR_RET(HT_MEMORY_ERROR);
+        }
+        bucket->elements = newElements;
+        bucket->capacity = newCapacity;
+    }
+
+    *node = bucketGetIntNode(bucket, bucket->size++);
+
+    return HT_SUCCESS;
+}
+
+static hashTableStatus_t allocateIntNode(hashTableInt_t *table, hashTableIntBucket_t *bucket, uint64_t key,
+                                         hashTableIntNode_t **node)
+{
+    void *bigValue = NULL;
+    if (table->valSize > sizeof((*node)->value)) {
+        bigValue = calloc(1, table->valSize);
+        if (!bigValue) {
+            hprintf("Failed to allocate value\n");
+            _ERR_RET(HT_MEMORY_ERROR);
+        }
+    }
+
+    if (bucketAppendIntNode(bucket, node) != HT_SUCCESS) {
+        free(bigValue);
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+
+    (*node)->key = key;
+    (*node)->value.Imm = 0;
+    if (bigValue)
+        (*node)->value.Ptr = bigValue;
+
+    table->size++;
+
+    return HT_SUCCESS;
+}
+
+/* ========================== Hash table functions ========================== */
+
+hashTableStatus_t hashTableIntCtor(hashTableInt_t *table, size_t valueSize, size_t bucketsCount)
+{
+    assert(table);
+    assert(bucketsCount > 0);
+
+    table->bucketsCount = bucketsCount;
+    table->valSize = valueSize;
+    table->size = 0;
+
+    _ERR_RET(allocateIntBuckets(table->bucketsCount, &table->buckets));
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableIntDtor(hashTableInt_t *table)
+{
+    assert(table);
+
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        hashTableIntBucket_t *bucket = table->buckets + bucketIdx;
+        if (table->valSize > sizeof(bucket->inlined[0].value))
+            for (uint32_t idx = 0; idx < bucket->size; idx++)
+                free(bucketGetIntNode(bucket, idx)->value.Ptr);
+        free(bucket->elements);
+    }
+
+    free(table->buckets);
+    table->buckets = NULL;
+    table->bucketsCount = table->size = 0;
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableIntReserve(hashTableInt_t *table, size_t expectedKeys)
+{
+    assert(table);
+    assert(table->buckets);
+
+    const size_t neededBuckets = expectedKeys / RESERVE_LOAD_FACTOR + 1;
+    if (neededBuckets <= table->bucketsCount)
+        return HT_SUCCESS;
+
+    // Nodes are copied into new buckets, old ones are freed only when all of them fit: out of memory leaves
+    // the table as it was
+    hashTableIntBucket_t *newBuckets = NULL;
+    _ERR_RET(allocateIntBuckets(neededBuckets, &newBuckets));
+
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        hashTableIntBucket_t *bucket = table->buckets + bucketIdx;
+
+        for (uint32_t idx = 0; idx < bucket->size; idx++) {
+            hashTableIntNode_t *node = bucketGetIntNode(bucket, idx);
+            hashTableIntNode_t *newNode = NULL;
+            if (bucketAppendIntNode(newBuckets + intKeyHash(node->key) % neededBuckets, &newNode) != HT_SUCCESS) {
+                freeIntBuckets(newBuckets, neededBuckets);
+                _ERR_RET(HT_MEMORY_ERROR);
+            }
+            // Values stored in node are moved with it, pointers to bigger values stay the same
+            *newNode = *node;
+        }
+    }
+
+    freeIntBuckets(table->buckets, table->bucketsCount);
+    table->buckets      = newBuckets;
+    table->bucketsCount = neededBuckets;
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableIntInsert(hashTableInt_t *table, uint64_t key, const void *value)
+{
+    assert(table);
+    assert(table->valSize == 0 || value);
+
+    void *dest = hashTableIntAccess(table, key);
+    if (!dest)
+        _ERR_RET(HT_MEMORY_ERROR);
+
+    memcpy(dest, value, table->valSize);
+
+    return HT_SUCCESS;
+}
+
+void *hashTableIntAccess(hashTableInt_t *table, uint64_t key)
+{
+    assert(table);
+    assert(table->buckets);
+
+    hashTableIntBucket_t *bucket = table->buckets + intKeyHash(key) % table->bucketsCount;
+    const uint32_t idx = bucketSearch(bucket, key);
+
+    hashTableIntNode_t *node = NULL;
+    if (idx < bucket->size)
+        node = bucketGetIntNode(bucket, idx);
+    else
+        _ERR_RET_PTR(allocateIntNode(table, bucket, key, &node));
+
+    return getIntValue(table, node);
+}
+
+void *hashTableIntFind(hashTableInt_t *table, uint64_t key)
+{
+    assert(table);
+    assert(table->buckets);
+
+    hashTableIntBucket_t *bucket = table->buckets + intKeyHash(key) % table->bucketsCount;
+    const uint32_t idx = bucketSearch(bucket, key);
+
+    return (idx < bucket->size) ? getIntValue(table, bucketGetIntNode(bucket, idx)) : NULL;
+}
+
+hashTableStatus_t hashTableIntErase(hashTableInt_t *table, uint64_t key)
+{
+    assert(table);
+    assert(table->buckets);
+
+    hashTableIntBucket_t *bucket = table->buckets + intKeyHash(key) % table->bucketsCount;
+    const uint32_t idx = bucketSearch(bucket, key);
+    if (idx == bucket->size)
+        return HT_NO_KEY;
+
+    hashTableIntNode_t *node = bucketGetIntNode(bucket, idx);
+    if (table->valSize > sizeof(node->value))
+        free(node->value.Ptr);
+
+    // Last node fills the hole, overflow array is kept for the next insertions
+    *node = *bucketGetIntNode(bucket, bucket->size - 1);
+    bucket->size--;
+    table->size--;
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableIntVerify(hashTableInt_t *table)
+{
+    if (!table || !table->buckets || table->bucketsCount == 0)
+        return HT_NO_INIT;
+
+    size_t totalSize = 0;
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        hashTableIntBucket_t *bucket = table->buckets + bucketIdx;
+        totalSize += bucket->size;
+
+        if (bucket->size > INT_BUCKET_INLINE_NODES &&
+            (!bucket->elements || bucket->size - INT_BUCKET_INLINE_NODES > bucket->capacity)) {
+            hprintf("Overflow array of bucket %zu is too small for %u nodes\n", bucketIdx, bucket->size);
+            return HT_WRONG_SIZE;
+        }
+
+        for (uint32_t idx = 0; idx < bucket->size; idx++) {
+            const uint64_t key = bucketGetIntNode(bucket, idx)->key;
+            if (intKeyHash(key) % table->bucketsCount != bucketIdx) {
+                hprintf("Key %ju is in wrong bucket %zu\n", key, bucketIdx);
+                return HT_WRONG_HASH;
+            }
+            if (bucketSearch(bucket, key) != idx) {
+                hprintf("Key %ju is stored twice in bucket %zu\n", key, bucketIdx);
+                return HT_ERROR;
+            }
+        }
+    }
+
+    if (totalSize != table->size) {
+        hprintf("Buckets hold %zu nodes, table size is %zu\n", totalSize, table->size);
+        return HT_WRONG_SIZE;
+    }
+
+    return HT_SUCCESS;
+}
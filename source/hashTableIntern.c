@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "hashTableIntern.h"
+
+#if HASH_TABLE_ARCH == 2
+
+/* ========================== Pool of keys ========================== */
+
+/// @brief Bytes taken by key in the pool: terminating zero and padding up to KEY_ALIGNMENT
+static size_t pooledKeySize(size_t keyLen) {
+    return (keyLen + KEY_ALIGNMENT) / KEY_ALIGNMENT * KEY_ALIGNMENT;
+}
+
+/// @brief Make sure the last block has room for key of keyLen chars
+static hashTableStatus_t poolReserve(hashTableInterner_t *interner, size_t keyLen) {
+    const size_t bytes = pooledKeySize(keyLen);
+    if (interner->blocksCount > 0 && interner->blockUsed + bytes <= interner->blockSize)
+        return HT_SUCCESS;
+
+    if (interner->blocksCount == interner->blocksCapacity) {
+        const size_t newCapacity = interner->blocksCapacity ? 2 * interner->blocksCapacity : 16;
+        char **newBlocks = (char **) realloc(interner->blocks, newCapacity * sizeof(char *));
+        if (!newBlocks) {
+            hprintf("Failed to reallocate list of pool blocks\n");
+            _ERR_RET(HT_MEMORY_ERROR);
+        }
+        interner->blocks = newBlocks;
+        interner->blocksCapacity = newCapacity;
+    }
+
+    // Rest of the previous block is left unused: keys are never split between blocks
+    const size_t blockSize = (bytes > INTERN_POOL_BLOCK) ? bytes : INTERN_POOL_BLOCK;
+    char *block = (char *) aligned_alloc(KEY_ALIGNMENT, blockSize);
+    if (!block) {
+        hprintf("Failed to allocate pool block of %zu bytes\n", blockSize);
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+
+    interner->blocks[interner->blocksCount++] = block;
+    interner->blockUsed = 0;
+    interner->blockSize = blockSize;
+
+    return HT_SUCCESS;
+}
+
+/// @brief Make sure there's an entry for the next ID
+static hashTableStatus_t idsReserve(hashTableInterner_t *interner) {
+    if (interner->count < interner->capacity)
+        return HT_SUCCESS;
+
+    // Last value of uint32_t is INTERN_NO_ID
+    if (interner->capacity == INTERN_NO_ID) {
+        hprintf("All IDs are in use\n");
+        _ERR_RET(HT_WRONG_SIZE);
+    }
+
+    const uint32_t newCapacity = (interner->capacity < INTERN_NO_ID / 2) ? (interner->capacity ? 2 * interner->capacity : 1024)
+                                                                         : INTERN_NO_ID;
+    const char **newKeys = (const char **) realloc(interner->keys, newCapacity * sizeof(const char *));
+    if (newKeys)
+        interner->keys = newKeys;
+    uint32_t *newLengths = (uint32_t *) realloc(interner->lengths, newCapacity * sizeof(uint32_t));
+    if (newLengths)
+        interner->lengths = newLengths;
+
+    if (!newKeys || !newLengths) {
+        hprintf("Failed to reallocate arrays of %u IDs\n", newCapacity);
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+    interner->capacity = newCapacity;
+
+    return HT_SUCCESS;
+}
+
+/// @brief Copy key into the pool as the key of the next ID. Room for it must be reserved
+/// @return Copy of key in the pool
+static const char *appendKey(hashTableInterner_t *interner, const char *key, size_t keyLen) {
+    const size_t bytes = pooledKeySize(keyLen);
+    assert(interner->blockUsed + bytes <= interner->blockSize);
+    assert(interner->count < interner->capacity);
+
+    char *copy = interner->blocks[interner->blocksCount - 1] + interner->blockUsed;
+    memcpy(copy, key, keyLen);
+    memset(copy + keyLen, 0, bytes - keyLen);
+    interner->blockUsed += bytes;
+
+    interner->keys   [interner->count] = copy;
+    interner->lengths[interner->count] = (uint32_t) keyLen;
+    interner->count++;
+
+    return copy;
+}
+
+/// @brief Undo appendKey of the last key of keyLen chars
+static void dropLastKey(hashTableInterner_t *interner, size_t keyLen) {
+    assert(interner->count > 0);
+
+    interner->blockUsed -= pooledKeySize(keyLen);
+    interner->count--;
+}
+
+/* ========================== Interner ========================== */
+
+hashTableStatus_t hashTableInternerCtor(hashTableInterner_t *interner, size_t bucketsCount)
+{
+    assert(interner);
+
+    memset((void *) interner, 0, sizeof(*interner));
+    _ERR_RET(hashTableCtor(&interner->table, sizeof(uint32_t), bucketsCount));
+    // Long keys of the table are the pooled copies, which live until hashTableInternerDtor
+    interner->table.borrowedLongKeys = true;
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableInternerDtor(hashTableInterner_t *interner)
+{
+    assert(interner);
+
+    _ERR_RET(hashTableDtor(&interner->table));
+
+    for (size_t idx = 0; idx < interner->blocksCount; idx++)
+        free(interner->blocks[idx]);
+    free(interner->blocks);
+    free(interner->keys);
+    free(interner->lengths);
+
+    memset((void *) interner, 0, sizeof(*interner));
+
+    return HT_SUCCESS;
+}
+
+uint32_t hashTableIntern(hashTableInterner_t *interner, const char *key)
+{
+    assert(interner);
+    assert(key);
+
+    // Hit costs the same as hashTableAccess
+    const uint32_t *found = (const uint32_t *) hashTableFind(&interner->table, key);
+    if (found)
+        return *found;
+
+    const size_t keyLen = strlen(key);
+    if (keyLen >= UINT32_MAX || idsReserve(interner) != HT_SUCCESS || poolReserve(interner, keyLen) != HT_SUCCESS) {
+        hprintf("Failed to intern key of %zu chars\n", keyLen);
+        return INTERN_NO_ID;
+    }
+
+    // Key is copied into the pool first: long key of the node is this copy, not one more copy of the table
+    const uint32_t newId = interner->count;
+    uint32_t *id = (uint32_t *) hashTableAccess(&interner->table, appendKey(interner, key, keyLen));
+    if (!id) {
+        dropLastKey(interner, keyLen);
+        return INTERN_NO_ID;
+    }
+    *id = newId;
+
+    return newId;
+}
+
+uint32_t hashTableInternFind(hashTableInterner_t *interner, const char *key)
+{
+    assert(interner);
+    assert(key);
+
+    const uint32_t *id = (const uint32_t *) hashTableFind(&interner->table, key);
+
+    return id ? *id : INTERN_NO_ID;
+}
+
+#endif
@@ -0,0 +1,290 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "hashTableNuma.h"
+
+#if HASH_TABLE_ARCH == 2
+
+static const char NUMA_SYSFS_NODES[] = "/sys/devices/system/node";
+static const char ONLINE_CPUS_FILE[] = "/sys/devices/system/cpu/online";
+
+/* ========================== Topology ========================== */
+
+/// @brief Read first line of small sysfs file
+static bool readLine(const char *fileName, char *buffer, int size) {
+    FILE *file = fopen(fileName, "r");
+    if (!file)
+        return false;
+
+    const bool read = fgets(buffer, size, file) != NULL;
+    fclose(file);
+    return read;
+}
+
+/*!
+    @brief Parse list in sysfs format ("0-3,8,10-11")
+    @param ids Receives listed numbers, at most maxIds of them
+    @return Number of listed numbers
+*/
+static int parseIdList(const char *list, int *ids, int maxIds) {
+    int count = 0;
+    while (*list && *list != '\n') {
+        char *end = NULL;
+        const long first = strtol(list, &end, 10);
+        long last = first;
+        if (end == list)
+            break;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+
+        for (long id = first; id <= last && count < maxIds; id++)
+            ids[count++] = (int) id;
+
+        list = (*end == ',') ? end + 1 : end;
+    }
+
+    return count;
+}
+
+static void assignCpus(numaTopology_t *topology, const int *cpus, int cpusCount, int node) {
+    for (int idx = 0; idx < cpusCount; idx++) {
+        if (cpus[idx] >= NUMA_MAX_CPUS)
+            continue;
+        topology->cpuNode[cpus[idx]] = (int16_t) node;
+        if (cpus[idx] >= topology->cpusCount)
+            topology->cpusCount = cpus[idx] + 1;
+    }
+}
+
+/// @brief Online cpus from sysfs, or first ones up to number of online processors
+static int onlineCpus(int *cpus) {
+    char line[1024] = "";
+    if (readLine(ONLINE_CPUS_FILE, line, sizeof(line)))
+        return parseIdList(line, cpus, NUMA_MAX_CPUS);
+
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1)
+        count = 1;
+    if (count > NUMA_MAX_CPUS)
+        count = NUMA_MAX_CPUS;
+    for (int cpu = 0; cpu < count; cpu++)
+        cpus[cpu] = cpu;
+
+    return (int) count;
+}
+
+static void fakeTopology(numaTopology_t *topology, int nodesCount, const int *cpus, int cpusCount) {
+    topology->fake = true;
+    topology->nodesCount = nodesCount;
+    for (int node = 0; node < nodesCount; node++)
+        topology->nodeIds[node] = node;
+
+    // Contiguous blocks of cpus, as sockets number them. Nodes are left without cpus if there are not enough
+    for (int idx = 0; idx < cpusCount; idx++)
+        assignCpus(topology, cpus + idx, 1, (int) ((int64_t) idx * nodesCount / cpusCount));
+}
+
+hashTableStatus_t numaTopologyDetect(numaTopology_t *topology)
+{
+    assert(topology);
+
+    memset(topology, 0, sizeof(*topology));
+    for (int cpu = 0; cpu < NUMA_MAX_CPUS; cpu++)
+        topology->cpuNode[cpu] = -1;
+
+    int *cpus = (int *) calloc(NUMA_MAX_CPUS, sizeof(int));
+    if (!cpus) {
+        hprintf("Failed to allocate list of cpus\n");
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+
+    const char *fakeNodes = getenv(NUMA_FAKE_ENV);
+    if (fakeNodes && atoi(fakeNodes) > 0) {
+        int nodesCount = atoi(fakeNodes);
+        if (nodesCount > NUMA_MAX_NODES)
+            nodesCount = NUMA_MAX_NODES;
+        fakeTopology(topology, nodesCount, cpus, onlineCpus(cpus));
+        free(cpus);
+        return HT_SUCCESS;
+    }
+
+    char fileName[128] = "";
+    char line[1024] = "";
+    snprintf(fileName, sizeof(fileName), "%s/online", NUMA_SYSFS_NODES);
+    int nodeIds[NUMA_MAX_NODES] = {};
+    const int nodesCount = readLine(fileName, line, sizeof(line)) ? parseIdList(line, nodeIds, NUMA_MAX_NODES) : 0;
+
+    for (int node = 0; node < nodesCount; node++) {
+        snprintf(fileName, sizeof(fileName), "%s/node%d/cpulist", NUMA_SYSFS_NODES, nodeIds[node]);
+        // Memory-only nodes have empty cpulist, they get replicas built by unpinned threads
+        const int cpusCount = readLine(fileName, line, sizeof(line)) ? parseIdList(line, cpus, NUMA_MAX_CPUS) : 0;
+        topology->nodeIds[node] = nodeIds[node];
+        assignCpus(topology, cpus, cpusCount, node);
+    }
+    topology->nodesCount = nodesCount;
+
+    // No NUMA information (kernel without CONFIG_NUMA): everything is one node
+    if (nodesCount == 0)
+        fakeTopology(topology, 1, cpus, onlineCpus(cpus));
+
+    free(cpus);
+    return HT_SUCCESS;
+}
+
+int numaCurrentNode(const numaTopology_t *topology) {
+    assert(topology);
+
+    const int cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= topology->cpusCount || topology->cpuNode[cpu] < 0)
+        return 0;
+
+    return topology->cpuNode[cpu];
+}
+
+int numaCachedNode(const numaTopology_t *topology) {
+    static thread_local int      node  = 0;
+    static thread_local uint32_t calls = 0;
+
+    if (calls++ % NUMA_NODE_CHECK_PERIOD == 0)
+        node = numaCurrentNode(topology);
+
+    return node;
+}
+
+int numaMemoryNode(const void *ptr) {
+    const uintptr_t pageSize = (uintptr_t) sysconf(_SC_PAGESIZE);
+    void *page = (void *) ((uintptr_t) ptr / pageSize * pageSize);
+
+    // Without target nodes move_pages only reports where pages are, no libnuma is needed for that
+    int node = -1;
+    if (syscall(SYS_move_pages, 0, 1, &page, NULL, &node, 0) != 0)
+        return -1;
+
+    return (node >= 0) ? node : -1;
+}
+
+bool numaStartOnNode(const numaTopology_t *topology, int node, void *(*func)(void *), void *arg, pthread_t *thread) {
+    assert(topology);
+    assert(node >= 0 && node < topology->nodesCount);
+    assert(func);
+    assert(thread);
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu = 0; cpu < topology->cpusCount; cpu++)
+        if (topology->cpuNode[cpu] == node)
+            CPU_SET((size_t) cpu, &cpuSet);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (CPU_COUNT(&cpuSet) > 0)
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuSet), &cpuSet);
+
+    bool started = pthread_create(thread, &attr, func, arg) == 0;
+    if (!started && CPU_COUNT(&cpuSet) > 0) {
+        // Cpus of node may be outside of the cpuset of the process: replica is still usable, just not local
+        hprintf("Failed to start thread on node %d, starting it unpinned\n", topology->nodeIds[node]);
+        started = pthread_create(thread, NULL, func, arg) == 0;
+    }
+
+    pthread_attr_destroy(&attr);
+    return started;
+}
+
+/* ========================== Replicas ========================== */
+
+typedef struct {
+    hashTable_t       *copy;
+    const hashTable_t *table;
+    hashTableStatus_t  result;
+} cloneTask_t;
+
+static void *cloneTable(void *arg) {
+    cloneTask_t *task = (cloneTask_t *) arg;
+    task->result = hashTableClone(task->copy, task->table);
+    return NULL;
+}
+
+hashTableStatus_t hashTableReplicasCtor(hashTableReplicas_t *replicas, const hashTable_t *table)
+{
+    assert(replicas);
+    assert(table);
+
+    _ERR_RET(numaTopologyDetect(&replicas->topology));
+    const int nodesCount = replicas->topology.nodesCount;
+
+    // Table embeds bucket of long keys, which is aligned on cache line: calloc is not enough
+    replicas->replicas   = (hashTable_t *) aligned_alloc(alignof(hashTable_t), (size_t) nodesCount * sizeof(hashTable_t));
+    cloneTask_t *tasks   = (cloneTask_t *) calloc((size_t) nodesCount, sizeof(cloneTask_t));
+    pthread_t   *threads = (pthread_t *)   calloc((size_t) nodesCount, sizeof(pthread_t));
+    bool        *started = (bool *)        calloc((size_t) nodesCount, sizeof(bool));
+    if (!replicas->replicas || !tasks || !threads || !started) {
+        hprintf("Failed to allocate replicas\n");
+        free(replicas->replicas);
+        free(tasks);
+        free(threads);
+        free(started);
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+
+    // Every replica is written first by a thread on its node, so its pages are allocated there
+    for (int node = 0; node < nodesCount; node++) {
+        tasks[node] = {replicas->replicas + node, table, HT_SUCCESS};
+        started[node] = numaStartOnNode(&replicas->topology, node, cloneTable, tasks + node, threads + node);
+        if (!started[node])
+            cloneTable(tasks + node);
+    }
+
+    hashTableStatus_t result = HT_SUCCESS;
+    for (int node = 0; node < nodesCount; node++) {
+        if (started[node])
+            pthread_join(threads[node], NULL);
+        if (tasks[node].result != HT_SUCCESS)
+            result = tasks[node].result;
+    }
+
+    if (result != HT_SUCCESS) {
+        for (int node = 0; node < nodesCount; node++)
+            if (tasks[node].result == HT_SUCCESS)
+                hashTableDtor(replicas->replicas + node);
+        free(replicas->replicas);
+        replicas->replicas = NULL;
+    }
+
+    free(tasks);
+    free(threads);
+    free(started);
+
+    _ERR_RET(result);
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableReplicasDtor(hashTableReplicas_t *replicas)
+{
+    assert(replicas);
+
+    if (!replicas->replicas)
+        return HT_SUCCESS;
+
+    for (int node = 0; node < replicas->topology.nodesCount; node++)
+        _ERR_RET(hashTableDtor(replicas->replicas + node));
+
+    free(replicas->replicas);
+    replicas->replicas = NULL;
+
+    return HT_SUCCESS;
+}
+
+void *hashTableReplicasFind(hashTableReplicas_t *replicas, const char *key) {
+    assert(replicas);
+    assert(replicas->replicas);
+
+    return hashTableFind(hashTableReplicasLocal(replicas), key);
+}
+
+#endif
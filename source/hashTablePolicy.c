@@ -0,0 +1,20 @@
+#include <string.h>
+
+#include "hashTablePolicy.h"
+
+/* Initialized statically, so registration works from constructors of other objects */
+static hashTablePolicy_t *policiesHead = NULL;
+
+void hashTableRegisterPolicy(hashTablePolicy_t *policy) {
+    // Keeping list sorted by name: order of constructors between objects is not specified
+    hashTablePolicy_t **insertPos = &policiesHead;
+    while (*insertPos && strcmp((*insertPos)->name, policy->name) < 0)
+        insertPos = &(*insertPos)->next;
+
+    policy->next = *insertPos;
+    *insertPos = policy;
+}
+
+hashTablePolicy_t *hashTablePolicies() {
+    return policiesHead;
+}
@@ -0,0 +1,444 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+#include <x86intrin.h>
+
+#include "hashTableSet.h"
+
+/// How many keys ahead hashTableContainsBatch hashes keys and prefetches their buckets
+static const size_t SET_PREFETCH_DISTANCE = 16;
+
+/// glibc keeps size of the chunk before every allocated block
+static const size_t SET_MALLOC_CHUNK_HEADER = sizeof(size_t);
+
+/* ========================== Key compare ========================== */
+
+/* Short key is compared with whole node, long nodes never match it: their last byte is SET_LONG_MARK.
+   With AVX2 two adjacent nodes are compared by one load. Loads may cover a node after the last one:
+   header of the bucket or unused capacity of the overflow array */
+#if defined(SSE) && defined(__AVX2__)
+static const uint32_t SET_NODES_PER_LOAD = 2;
+typedef __m256i setSearchKey_t;
+
+static inline setSearchKey_t makeSearchKey(MMi_t key) {
+    return _mm256_broadcastsi128_si256(key);
+}
+
+/// @return Bit i is set if node i holds the key
+static inline uint32_t matchNodes(const hashTableSetNode_t *nodes, setSearchKey_t key) {
+    const __m256i loaded = _mm256_loadu_si256((const __m256i *) nodes);
+    const uint32_t equal = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(loaded, key));
+    return (uint32_t) ((equal & 0xFFFF) == 0xFFFF) | ((uint32_t) ((equal >> 16) == 0xFFFF) << 1);
+}
+#elif defined(SSE)
+static const uint32_t SET_NODES_PER_LOAD = 1;
+typedef MMi_t setSearchKey_t;
+
+static inline setSearchKey_t makeSearchKey(MMi_t key) {
+    return key;
+}
+
+static inline uint32_t matchNodes(const hashTableSetNode_t *nodes, setSearchKey_t key) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(nodes->MM, key)) == 0xFFFF;
+}
+#else
+static const uint32_t SET_NODES_PER_LOAD = 1;
+typedef MMi_t setSearchKey_t;
+
+static inline setSearchKey_t makeSearchKey(MMi_t key) {
+    return key;
+}
+
+static inline uint32_t matchNodes(const hashTableSetNode_t *nodes, setSearchKey_t key) {
+    return memcmp(&nodes->MM, &key, SMALL_STR_LEN) == 0;
+}
+#endif
+
+static_assert((SET_BUCKET_INLINE_NODES + 1) % SET_NODES_PER_LOAD == 0, "Loads of inlined nodes must stay in the bucket");
+
+/// @return Index of node with key among nodes[0, count) or count if there's none
+static inline uint32_t searchNodes(const hashTableSetNode_t *nodes, uint32_t count, setSearchKey_t key) {
+    for (uint32_t idx = 0; idx < count; idx += SET_NODES_PER_LOAD) {
+        uint32_t match = matchNodes(nodes + idx, key);
+        if (count - idx < SET_NODES_PER_LOAD)
+            match &= (1u << (count - idx)) - 1;
+        if (match)
+            return idx + (uint32_t) __builtin_ctz(match);
+    }
+
+    return count;
+}
+
+static inline hashTableSetNode_t *bucketGetSetNode(hashTableSetBucket_t *bucket, uint32_t idx) {
+    if (idx < SET_BUCKET_INLINE_NODES)
+        return bucket->inlined + idx;
+    return bucket->elements + (idx - SET_BUCKET_INLINE_NODES);
+}
+
+static inline bool nodeIsLong(const hashTableSetNode_t *node) {
+    return node->Long.mark == SET_LONG_MARK;
+}
+
+/// @return Index of node with short key in bucket or bucket->size if there's none
+static inline uint32_t bucketSearchShort(const hashTableSetBucket_t *bucket, MMi_t key) {
+    const setSearchKey_t searchKey = makeSearchKey(key);
+    const uint32_t inlined = (bucket->size < SET_BUCKET_INLINE_NODES) ? bucket->size : SET_BUCKET_INLINE_NODES;
+    const uint32_t idx = searchNodes(bucket->inlined, inlined, searchKey);
+    if (idx < inlined || bucket->size <= SET_BUCKET_INLINE_NODES)
+        return idx;
+
+    return SET_BUCKET_INLINE_NODES + searchNodes(bucket->elements, bucket->size - SET_BUCKET_INLINE_NODES, searchKey);
+}
+
+/// @return Index of node with long key in bucket or bucket->size if there's none
+static uint32_t bucketSearchLong(hashTableSetBucket_t *bucket, const char *key, uint32_t hash) {
+    for (uint32_t idx = 0; idx < bucket->size; idx++) {
+        const hashTableSetNode_t *node = bucketGetSetNode(bucket, idx);
+        if (nodeIsLong(node) && node->Long.hash == hash && strcmp(node->Long.ptr, key) == 0)
+            return idx;
+    }
+
+    return bucket->size;
+}
+
+/* ========================== Hash ========================== */
+
+/// @brief Searched key: short one is loaded into register, long one is hashed by its chars
+typedef struct {
+    MMi_t       shortKey;       ///< Key padded with zeros, only if longKey is NULL
+    const char *longKey;
+    uint32_t    hash;
+} setKey_t;
+
+static inline setKey_t makeSetKey(const char *key) {
+    setKey_t setKey = {};
+    const size_t keyLen = strlen(key);
+
+    if (keyLen >= SMALL_STR_LEN) {
+        setKey.longKey = key;
+        setKey.hash    = (uint32_t) fastCrc32(key, keyLen);
+        return setKey;
+    }
+
+    #ifdef ALIGNED_KEYS
+    assert((size_t) key % KEY_ALIGNMENT == 0);
+    setKey.shortKey = *(const MMi_t *) key;
+    #else
+    memcpy(&setKey.shortKey, key, keyLen);
+    #endif
+    setKey.hash = (uint32_t) _HASH_FUNC(&setKey.shortKey);
+
+    return setKey;
+}
+
+static inline uint32_t nodeHash(const hashTableSetNode_t *node) {
+    return nodeIsLong(node) ? node->Long.hash : (uint32_t) _HASH_FUNC(&node->MM);
+}
+
+static inline uint32_t bucketSearch(hashTableSetBucket_t *bucket, const setKey_t *setKey) {
+    return setKey->longKey ? bucketSearchLong(bucket, setKey->longKey, setKey->hash)
+                           : bucketSearchShort(bucket, setKey->shortKey);
+}
+
+/* ========================== Allocators ========================== */
+
+/// @brief Allocate array of bucketsCount empty buckets. *bucketsPtr is not changed on failure
+static hashTableStatus_t allocateSetBuckets(size_t bucketsCount, hashTableSetBucket_t **bucketsPtr)
+{
+    const size_t bucketsBytes = bucketsCount * sizeof(hashTableSetBucket_t);
+    hashTableSetBucket_t *buckets = (hashTableSetBucket_t *) aligned_alloc(alignof(hashTableSetBucket_t), bucketsBytes);
+    if (!buckets) {
+        hprintf("Failed to allocate buckets array\n");
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+    memset((void *) buckets, 0, bucketsBytes);
+    *bucketsPtr = buckets;
+
+    return HT_SUCCESS;
+}
+
+/// @brief Free overflow arrays of buckets and the array itself, long keys are not touched
+static void freeSetBuckets(hashTableSetBucket_t *buckets, size_t bucketsCount)
+{
+    for (size_t idx = 0; idx < bucketsCount; idx++)
+        free(buckets[idx].elements);
+
+    free(buckets);
+}
+
+/// @brief Add node at the end of bucket. Overflow capacity is kept even, so paired loads never leave the array
+static hashTableStatus_t bucketAppendSetNode(hashTableSetBucket_t *bucket, hashTableSetNode_t **node)
+{
+    if (bucket->size >= SET_BUCKET_INLINE_NODES && bucket->size - SET_BUCKET_INLINE_NODES == bucket->capacity) {
+        const uint32_t newCapacity = bucket->capacity ? 2 * bucket->capacity : 4;
+        hashTableSetNode_t *newElements =
+            (hashTableSetNode_t *) realloc(bucket->elements, newCapacity * sizeof(hashTableSetNode_t));
+        if (!newElements) {
+            hprintf("Failed to reallocate overflow array\n");
+            _ERR_RET(HT_MEMORY_ERROR);
+        }
+        bucket->elements = newElements;
+        bucket->capacity = newCapacity;
+    }
+
+    *node = bucketGetSetNode(bucket, bucket->size++);
+
+    return HT_SUCCESS;
+}
+
+static hashTableStatus_t allocateSetNode(hashTableSet_t *set, hashTableSetBucket_t *bucket, const setKey_t *setKey)
+{
+    char *longKey = NULL;
+    if (setKey->longKey) {
+        longKey = strdup(setKey->longKey);
+        if (!longKey) {
+            hprintf("Failed to allocate long key\n");
+            _ERR_RET(HT_MEMORY_ERROR);
+        }
+    }
+
+    hashTableSetNode_t *node = NULL;
+    if (bucketAppendSetNode(bucket, &node) != HT_SUCCESS) {
+        free(longKey);
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+
+    if (longKey) {
+        memset((void *) node, 0, sizeof(*node));
+        node->Long.ptr  = longKey;
+        node->Long.hash = setKey->hash;
+        node->Long.mark = SET_LONG_MARK;
+    } else {
+        node->MM = setKey->shortKey;
+    }
+
+    set->size++;
+
+    return HT_SUCCESS;
+}
+
+/* ========================== Set functions ========================== */
+
+hashTableStatus_t hashTableSetCtor(hashTableSet_t *set, size_t bucketsCount)
+{
+    assert(set);
+    assert(bucketsCount > 0);
+
+    set->bucketsCount = bucketsCount;
+    set->size = 0;
+
+    _ERR_RET(allocateSetBuckets(set->bucketsCount, &set->buckets));
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableSetDtor(hashTableSet_t *set)
+{
+    assert(set);
+
+    for (size_t bucketIdx = 0; bucketIdx < set->bucketsCount; bucketIdx++) {
+        hashTableSetBucket_t *bucket = set->buckets + bucketIdx;
+        for (uint32_t idx = 0; idx < bucket->size; idx++) {
+            hashTableSetNode_t *node = bucketGetSetNode(bucket, idx);
+            if (nodeIsLong(node))
+                free(node->Long.ptr);
+        }
+        free(bucket->elements);
+    }
+
+    free(set->buckets);
+    set->buckets = NULL;
+    set->bucketsCount = set->size = 0;
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableSetReserve(hashTableSet_t *set, size_t expectedKeys)
+{
+    assert(set);
+    assert(set->buckets);
+
+    const size_t neededBuckets = expectedKeys / SET_RESERVE_LOAD_FACTOR + 1;
+    if (neededBuckets <= set->bucketsCount)
+        return HT_SUCCESS;
+
+    // Nodes are copied into new buckets, old ones are freed only when all of them fit: out of memory leaves
+    // the set as it was
+    hashTableSetBucket_t *newBuckets = NULL;
+    _ERR_RET(allocateSetBuckets(neededBuckets, &newBuckets));
+
+    for (size_t bucketIdx = 0; bucketIdx < set->bucketsCount; bucketIdx++) {
+        hashTableSetBucket_t *bucket = set->buckets + bucketIdx;
+
+        for (uint32_t idx = 0; idx < bucket->size; idx++) {
+            hashTableSetNode_t *node = bucketGetSetNode(bucket, idx);
+            hashTableSetNode_t *newNode = NULL;
+            if (bucketAppendSetNode(newBuckets + nodeHash(node) % neededBuckets, &newNode) != HT_SUCCESS) {
+                freeSetBuckets(newBuckets, neededBuckets);
+                _ERR_RET(HT_MEMORY_ERROR);
+            }
+            // Long keys are moved by pointer, their hash is kept in node
+            *newNode = *node;
+        }
+    }
+
+    freeSetBuckets(set->buckets, set->bucketsCount);
+    set->buckets      = newBuckets;
+    set->bucketsCount = neededBuckets;
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableSetInsert(hashTableSet_t *set, const char *key, bool *inserted)
+{
+    assert(set);
+    assert(set->buckets);
+    assert(key);
+
+    const setKey_t setKey = makeSetKey(key);
+    hashTableSetBucket_t *bucket = set->buckets + setKey.hash % set->bucketsCount;
+
+    const bool isNew = bucketSearch(bucket, &setKey) == bucket->size;
+    if (inserted)
+        *inserted = isNew;
+    if (isNew)
+        _ERR_RET(allocateSetNode(set, bucket, &setKey));
+
+    return HT_SUCCESS;
+}
+
+bool hashTableContains(hashTableSet_t *set, const char *key)
+{
+    assert(set);
+    assert(set->buckets);
+    assert(key);
+
+    const setKey_t setKey = makeSetKey(key);
+    hashTableSetBucket_t *bucket = set->buckets + setKey.hash % set->bucketsCount;
+
+    return bucketSearch(bucket, &setKey) < bucket->size;
+}
+
+size_t hashTableContainsBatch(hashTableSet_t *set, const char *const *keys, size_t count, bool *found)
+{
+    assert(set);
+    assert(set->buckets);
+    assert(keys);
+    assert(found);
+
+    // Ring of keys hashed ahead: slot of the key being searched is refilled with the key SET_PREFETCH_DISTANCE later
+    setKey_t setKeys[SET_PREFETCH_DISTANCE];
+    hashTableSetBucket_t *buckets[SET_PREFETCH_DISTANCE];
+
+    for (size_t idx = 0; idx < count && idx < SET_PREFETCH_DISTANCE; idx++) {
+        setKeys[idx] = makeSetKey(keys[idx]);
+        buckets[idx] = set->buckets + setKeys[idx].hash % set->bucketsCount;
+        _mm_prefetch((const char *) buckets[idx], _MM_HINT_T0);
+    }
+
+    size_t foundCount = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        const size_t slot = idx % SET_PREFETCH_DISTANCE;
+        found[idx] = bucketSearch(buckets[slot], setKeys + slot) < buckets[slot]->size;
+        foundCount += found[idx];
+
+        if (idx + SET_PREFETCH_DISTANCE < count) {
+            setKeys[slot] = makeSetKey(keys[idx + SET_PREFETCH_DISTANCE]);
+            buckets[slot] = set->buckets + setKeys[slot].hash % set->bucketsCount;
+            _mm_prefetch((const char *) buckets[slot], _MM_HINT_T0);
+        }
+    }
+
+    return foundCount;
+}
+
+hashTableStatus_t hashTableSetErase(hashTableSet_t *set, const char *key)
+{
+    assert(set);
+    assert(set->buckets);
+    assert(key);
+
+    const setKey_t setKey = makeSetKey(key);
+    hashTableSetBucket_t *bucket = set->buckets + setKey.hash % set->bucketsCount;
+    const uint32_t idx = bucketSearch(bucket, &setKey);
+    if (idx == bucket->size)
+        return HT_NO_KEY;
+
+    hashTableSetNode_t *node = bucketGetSetNode(bucket, idx);
+    if (nodeIsLong(node))
+        free(node->Long.ptr);
+
+    // Last node fills the hole, overflow array is kept for the next insertions
+    *node = *bucketGetSetNode(bucket, bucket->size - 1);
+    bucket->size--;
+    set->size--;
+
+    return HT_SUCCESS;
+}
+
+size_t hashTableSetMemoryUsage(const hashTableSet_t *set)
+{
+    assert(set);
+
+    size_t bytes = malloc_usable_size(set->buckets) + SET_MALLOC_CHUNK_HEADER;
+    for (size_t bucketIdx = 0; bucketIdx < set->bucketsCount; bucketIdx++) {
+        hashTableSetBucket_t *bucket = set->buckets + bucketIdx;
+        if (bucket->elements)
+            bytes += malloc_usable_size(bucket->elements) + SET_MALLOC_CHUNK_HEADER;
+
+        for (uint32_t idx = 0; idx < bucket->size; idx++) {
+            const hashTableSetNode_t *node = bucketGetSetNode(bucket, idx);
+            if (nodeIsLong(node))
+                bytes += malloc_usable_size(node->Long.ptr) + SET_MALLOC_CHUNK_HEADER;
+        }
+    }
+
+    return bytes;
+}
+
+hashTableStatus_t hashTableSetVerify(hashTableSet_t *set)
+{
+    if (!set || !set->buckets || set->bucketsCount == 0)
+        return HT_NO_INIT;
+
+    size_t totalSize = 0;
+    for (size_t bucketIdx = 0; bucketIdx < set->bucketsCount; bucketIdx++) {
+        hashTableSetBucket_t *bucket = set->buckets + bucketIdx;
+        totalSize += bucket->size;
+
+        if (bucket->size > SET_BUCKET_INLINE_NODES &&
+            (!bucket->elements || bucket->size - SET_BUCKET_INLINE_NODES > bucket->capacity)) {
+            hprintf("Overflow array of bucket %zu is too small for %u nodes\n", bucketIdx, bucket->size);
+            return HT_WRONG_SIZE;
+        }
+
+        for (uint32_t idx = 0; idx < bucket->size; idx++) {
+            const hashTableSetNode_t *node = bucketGetSetNode(bucket, idx);
+            const char *key = nodeIsLong(node) ? node->Long.ptr : (const char *) &node->MM;
+
+            if (nodeIsLong(node) && (strlen(key) < SMALL_STR_LEN || (uint32_t) fastCrc32(key, strlen(key)) != node->Long.hash)) {
+                hprintf("Long key \"%s\" in bucket %zu has wrong length or hash\n", key, bucketIdx);
+                return HT_WRONG_HASH;
+            }
+            if (nodeHash(node) % set->bucketsCount != bucketIdx) {
+                hprintf("Key \"%s\" is in wrong bucket %zu\n", key, bucketIdx);
+                return HT_WRONG_HASH;
+            }
+
+            const setKey_t setKey = nodeIsLong(node) ? setKey_t{{}, key, node->Long.hash}
+                                                     : setKey_t{node->MM, NULL, nodeHash(node)};
+            if (bucketSearch(bucket, &setKey) != idx) {
+                hprintf("Key \"%s\" is stored twice in bucket %zu\n", key, bucketIdx);
+                return HT_ERROR;
+            }
+        }
+    }
+
+    if (totalSize != set->size) {
+        hprintf("Buckets hold %zu nodes, set size is %zu\n", totalSize, set->size);
+        return HT_WRONG_SIZE;
+    }
+
+    return HT_SUCCESS;
+}
@@ -5,166 +5,60 @@
 #include <assert.h>
 
 #include "hashTable.h"
+#include "hashTablePolicy.h"
 
 #include <immintrin.h>
 #include <sys/cdefs.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/mman.h>
 
 #define FREE(ptr) do {free(ptr); ptr = NULL;} while(0)
 #define CALLOC(type, nmemb) (type *) calloc(nmemb, sizeof(type))
 
+#ifdef HASH_TABLE_STATS
+    #define HT_STAT(...) __VA_ARGS__
+#else
+    #define HT_STAT(...)
+#endif
+
+#ifdef PACKED_KEYS
+    /// Key that can be packed is replaced by packed copy in buffer of the current scope (see packLongKey)
+    #define PACK_LONG_KEY(key, keyLen) \
+        alignas(KEY_ALIGNMENT) char packedKey[SMALL_STR_LEN]; key = packLongKey(key, &(keyLen), packedKey)
+#else
+    #define PACK_LONG_KEY(key, keyLen) (void) 0
+#endif
+
+#if defined(SEEDED_HASH) && defined(ALIGNED_KEYS)
+    #define KEY_HASH(table, key) aesHash16(key, &(table)->seed)
+#elif defined(SEEDED_HASH)
+    #define KEY_HASH(table, key) aesHash(key, strlen((const char *) (key)), &(table)->seed)
+#else
+    #define KEY_HASH(table, key) _HASH_FUNC(key)
+#endif
+
+// Probe arguments are only materialized in registers, tracer reads them when attached (see scripts/bucketHeatMap.sh)
+#if !defined(HASH_TABLE_NO_PROBES) && __has_include(<sys/sdt.h>)
+    #include <sys/sdt.h>
+    #define HT_PROBE3(name, arg1, arg2, arg3)       DTRACE_PROBE3(hashTable, name, arg1, arg2, arg3)
+    #define HT_PROBE4(name, arg1, arg2, arg3, arg4) DTRACE_PROBE4(hashTable, name, arg1, arg2, arg3, arg4)
+#else
+    #define HT_PROBE3(name, arg1, arg2, arg3)
+    #define HT_PROBE4(name, arg1, arg2, arg3, arg4)
+#endif
+
 /* ================================================= */
-/* There are two versions of this file               */
+/* There are three versions of this file             */
 /* They use different structure of hashTable         */
-/* One of them is deactivated with define            */
+/* Two of them are deactivated with define           */
+/* Policy builds compile all of them (see Makefile)  */
 /* ================================================= */
 
 #if HASH_TABLE_ARCH == 2
 
-/* ============ Hash functions ======================================= */
-hash_t checksum(const void *ptr)
-{
-    const char *cptr = (const char *) ptr;
-    hash_t hash = 0;
-    while (*cptr) {
-        hash += (hash_t)*cptr;
-        cptr++;
-    }
-    return hash;
-}
-
-hash_t djb2(const void *ptr)
-{
-    const char *cptr = (const char *) ptr;
-
-    hash_t hash = 5381;
-    while (*cptr) {
-        hash = ((hash << 5) + hash) + (hash_t)*cptr;
-        cptr++;
-        //hash = 33*hash + c
-    }
-    return hash;
-}
-
-/* Source: https://github.com/halloweeks/CRC-32/blob/main/crc32.h */
-static const hash_t crc32_table[256] =
-{
-	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA,
-	0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-	0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 
-	0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 
-	0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 
-	0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7, 
-	0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 
-	0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5, 
-	0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 
-	0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 
-	0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 
-	0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59, 
-	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 
-	0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F, 
-	0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 
-	0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D, 
-	0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 
-	0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433, 
-	0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 
-	0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01, 
-	0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 
-	0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 
-	0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 
-	0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65, 
-	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 
-	0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-	0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 
-	0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 
-	0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 
-	0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F, 
-	0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 
-	0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD, 
-	0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 
-	0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 
-	0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 
-	0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1, 
-	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 
-	0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7, 
-	0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 
-	0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 
-	0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 
-	0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B, 
-	0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 
-	0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79, 
-	0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 
-	0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 
-	0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 
-	0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D, 
-	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 
-	0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713, 
-	0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 
-	0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21, 
-	0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 
-	0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777, 
-	0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 
-	0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45, 
-	0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 
-	0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 
-	0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 
-	0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9, 
-	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 
-	0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF, 
-	0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 
-	0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D 
-};
-
-hash_t crc32(const void *data) 
-{
-	hash_t crc = 0xFFFFFFFF;
-	
-    const uint8_t *ptr = (const uint8_t *)data;
-
-	for (; *ptr; ptr++) {
-		crc = (crc >> 8) ^ crc32_table[(crc ^ *ptr) & 0xFF];
-	}
-	
-	return crc ^ 0xFFFFFFFF;
-}
-
-// Calculate crc32 hash of 16 bytes of data
-hash_t fastCrc32_16(const void *data) 
-{
-    hash_t crc = 0xFFFFFFFF;
-    asm("crc32q  (%[ptr]), %[crc]\n\t"
-        "crc32q 8(%[ptr]), %[crc]\n" 
-      : [crc] "+r" (crc)
-      : [ptr] "r" (data));
-    return crc;
-}
-
-hash_t fastCrc32_32(const void *data) 
-{
-    hash_t crc = 0xFFFFFFFF;
-    asm("crc32q   (%[ptr]), %[crc]\n\t"
-        "crc32q  8(%[ptr]), %[crc]\n\t" 
-        "crc32q 16(%[ptr]), %[crc]\n\t" 
-        "crc32q 24(%[ptr]), %[crc]\n" 
-      : [crc] "+r" (crc)
-      : [ptr] "r" (data));
-    return crc;
-}
-
-hash_t fastCrc32_64(const void *data) 
-{
-    hash_t crc = 0xFFFFFFFF;
-    asm("crc32q   (%[ptr]), %[crc]\n\t"
-        "crc32q  8(%[ptr]), %[crc]\n\t" 
-        "crc32q 16(%[ptr]), %[crc]\n\t" 
-        "crc32q 24(%[ptr]), %[crc]\n\t" 
-        "crc32q 32(%[ptr]), %[crc]\n\t" 
-        "crc32q 40(%[ptr]), %[crc]\n\t" 
-        "crc32q 48(%[ptr]), %[crc]\n\t" 
-        "crc32q 56(%[ptr]), %[crc]\n" 
-      : [crc] "+r" (crc)
-      : [ptr] "r" (data));
-    return crc;
-}
+HT_NAMESPACE_BEGIN
 
 /* ==================================================================================== */
 void *getValueFromNode(const hashTable_t *table, hashTableNode_t *node) {
@@ -183,24 +77,137 @@ void *getValueFromNode(const hashTable_t *table, hashTableNode_t *node) {
 /* ================== Allocators ==================================================== */
 static hashTableStatus_t deallocateNode(hashTable_t *table, hashTableNode_t *node, bool longKey);
 
+/// @brief Memory was placed in arena by hashTableCompact and must not be passed to free or realloc
+static bool inArena(const hashTable_t *table, const void *ptr) {
+    const uintptr_t address = (uintptr_t) ptr, arena = (uintptr_t) table->arena;
+    return address >= arena && address < arena + table->arenaSize;
+}
+
+/// @brief free() for memory that may be in arena
+#define TABLE_FREE(table, ptr) do {if (!inArena(table, ptr)) free(ptr); ptr = NULL;} while(0)
+
+/// glibc keeps size of the chunk before every allocated block
+static const size_t MALLOC_CHUNK_HEADER = sizeof(size_t);
+
+static size_t alignUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+/* Big blocks of the table (array of buckets, arena) are allocated by blockAlloc and freed by blockFree
+   with the same size. With HUGE_PAGES blocks of at least HUGE_PAGE_SIZE are mapped with 2 MB pages   */
+#ifdef HUGE_PAGES
+static const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+static void *hugePagesAlloc(size_t bytes) {
+    const size_t mapped = alignUp(bytes, HUGE_PAGE_SIZE);
+    void *ptr = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED)
+        return ptr;
+
+    // No reserved huge pages (vm.nr_hugepages): region aligned to 2 MB is mapped and THP are requested for it.
+    // Unaligned head and tail of the bigger mapping are returned
+    char *raw = (char *) mmap(NULL, mapped + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return NULL;
+
+    char *aligned = (char *) alignUp((uintptr_t) raw, HUGE_PAGE_SIZE);
+    if (aligned != raw)
+        munmap(raw, (size_t) (aligned - raw));
+    munmap(aligned + mapped, (size_t) (raw + HUGE_PAGE_SIZE - aligned));
+
+    if (madvise(aligned, mapped, MADV_HUGEPAGE) != 0)
+        hprintf("Transparent huge pages are not available\n");
+
+    return aligned;
+}
+#endif
+
+/// @param bytes Must be multiple of alignment
+static void *blockAlloc(size_t bytes, size_t alignment) {
+    assert(bytes % alignment == 0);
+
+    #ifdef HUGE_PAGES
+    if (bytes >= HUGE_PAGE_SIZE)
+        return hugePagesAlloc(bytes);
+    #endif
+
+    return aligned_alloc(alignment, bytes);
+}
+
+static void blockFree(void *ptr, size_t bytes) {
+    if (!ptr)
+        return;
+
+    #ifdef HUGE_PAGES
+    if (bytes >= HUGE_PAGE_SIZE) {
+        munmap(ptr, alignUp(bytes, HUGE_PAGE_SIZE));
+        return;
+    }
+    #else
+    (void) bytes;
+    #endif
+
+    free(ptr);
+}
+
+/// @brief Bytes of block from blockAlloc that are not available to the table
+static size_t blockOverhead(void *ptr, size_t bytes) {
+    #ifdef HUGE_PAGES
+    if (bytes >= HUGE_PAGE_SIZE)
+        return alignUp(bytes, HUGE_PAGE_SIZE) - bytes;
+    #endif
+
+    return malloc_usable_size(ptr) - bytes + MALLOC_CHUNK_HEADER;
+}
+
+#ifdef HASH_TABLE_STATS
+/// @brief Move bucket from one bin of the size histogram to another
+static void statsBucketResized(hashTable_t *table, const hashTableBucket_t *bucket, size_t oldSize) {
+    if (bucket == &table->longKeys)
+        return;
+
+    const size_t lastBin = HT_STATS_HISTOGRAM_SIZE - 1;
+    table->stats.bucketSizes[(oldSize < lastBin) ? oldSize : lastBin]--;
+    table->stats.bucketSizes[(bucket->size < lastBin) ? bucket->size : lastBin]++;
+}
+
+/// @brief Start histogram of bucket sizes for freshly allocated empty buckets
+static void statsResetHistogram(hashTable_t *table) {
+    memset(table->stats.bucketSizes, 0, sizeof(table->stats.bucketSizes));
+    table->stats.bucketSizes[0] = table->bucketsCount;
+}
+#endif
 
-// expects bucketsCount and valueSize to be set already
-static hashTableStatus_t allocateBuckets(hashTable_t *table)
+
+/// @brief Allocate array of bucketsCount empty buckets. *bucketsPtr is not changed on failure
+static hashTableStatus_t allocateBuckets(size_t bucketsCount, hashTableBucket_t **bucketsPtr)
 {
-    assert(table);
-    assert(table->bucketsCount > 0);
+    assert(bucketsPtr);
+    assert(bucketsCount > 0);
 
-    hashTableBucket_t *buckets = CALLOC(hashTableBucket_t, table->bucketsCount);
+    // Buckets with inlined nodes must start on the cache line boundary
+    const size_t bucketsBytes = bucketsCount * sizeof(hashTableBucket_t);
+    hashTableBucket_t *buckets = (hashTableBucket_t *) blockAlloc(bucketsBytes, alignof(hashTableBucket_t));
     if (!buckets) {
         hprintf("Failed to allocate buckets array\n");
         _ERR_RET(HT_MEMORY_ERROR);
     }
+    memset(buckets, 0, bucketsBytes);
 
-    table->buckets = buckets;
+    *bucketsPtr = buckets;
 
     return HT_SUCCESS;
 }
 
+/// @brief Free array of buckets and their overflow arrays, but not values and long keys of the nodes
+static void freeBucketsArray(hashTable_t *table, hashTableBucket_t *buckets, size_t bucketsCount)
+{
+    for (size_t idx = 0; idx < bucketsCount; idx++)
+        TABLE_FREE(table, buckets[idx].elements);
+
+    blockFree(buckets, bucketsCount * sizeof(hashTableBucket_t));
+}
+
 static hashTableStatus_t deallocateBuckets(hashTable_t *table)
 {
     assert(table);
@@ -209,13 +216,14 @@ static hashTableStatus_t deallocateBuckets(hashTable_t *table)
         hashTableBucket_t *bucket = table->buckets + idx;
 
         for (size_t elemIdx = 0; elemIdx <  bucket->size; elemIdx++) {
-            hashTableNode_t *node = bucket->elements + elemIdx;
+            hashTableNode_t *node = bucketGetNode(bucket, elemIdx);
             deallocateNode(table, node, false);
         }
-        FREE(bucket->elements);
+        TABLE_FREE(table, bucket->elements);
     }
 
-    FREE(table->buckets);
+    blockFree(table->buckets, table->bucketsCount * sizeof(hashTableBucket_t));
+    table->buckets = NULL;
 
     return HT_SUCCESS;
 }
@@ -225,34 +233,206 @@ static hashTableStatus_t deallocateLongKeys(hashTable_t *table)
     hashTableBucket_t *bucket = &table->longKeys;
 
     for (size_t elemIdx = 0; elemIdx <  bucket->size; elemIdx++) {
-        hashTableNode_t *node = bucket->elements + elemIdx;
+        hashTableNode_t *node = bucketGetNode(bucket, elemIdx);
         deallocateNode(table, node, true);
     }
-    FREE(bucket->elements);
+    TABLE_FREE(table, bucket->elements);
+
+    return HT_SUCCESS;
+}
+
+/* ===================================== Sorted overflow arrays ===================================== */
+
+/// @brief Overflow array of the bucket is kept sorted by key (see BUCKET_SORT_THRESHOLD)
+static inline bool bucketIsSorted(const hashTableBucket_t *bucket) {
+    #if BUCKET_SORT_THRESHOLD > 0
+    return bucket->size >= BUCKET_INLINE_NODES + BUCKET_SORT_THRESHOLD;
+    #else
+    (void) bucket;
+    return false;
+    #endif
+}
+
+static inline bool nodeInOverflow(hashTableBucket_t *bucket, const hashTableNode_t *node) {
+    #if BUCKET_INLINE_NODES > 0
+    return !(node >= bucket->inlined && node < bucket->inlined + BUCKET_INLINE_NODES);
+    #else
+    (void) bucket;
+    (void) node;
+    return true;
+    #endif
+}
+
+#if BUCKET_SORT_THRESHOLD > 0
+/// @brief Order of short keys: zero-padded blocks compared word by word. Bisection needs any total order,
+/// so words are compared as numbers without byte swaps
+static int shortKeyCmp(const MMi_t *lhs, const MMi_t *rhs) {
+    const uint64_t *lhsWords = (const uint64_t *) lhs;
+    const uint64_t *rhsWords = (const uint64_t *) rhs;
+    for (size_t idx = 0; idx < SMALL_STR_LEN / sizeof(uint64_t); idx++)
+        if (lhsWords[idx] != rhsWords[idx])
+            return (lhsWords[idx] < rhsWords[idx]) ? -1 : 1;
+
+    return 0;
+}
+
+/// @brief strcmp order of stored long key and searched one, which may be not null-terminated
+static int longKeyCmp(const char *stored, const char *key, const size_t keyLen) {
+    const int cmp = strncmp(stored, key, keyLen);
+    if (cmp != 0)
+        return cmp;
+
+    return stored[keyLen] != '\0';
+}
+
+static int shortNodeCmp(const void *lhs, const void *rhs) {
+    return shortKeyCmp(&((const hashTableNode_t *) lhs)->key.MM, &((const hashTableNode_t *) rhs)->key.MM);
+}
+
+static int longNodeCmp(const void *lhs, const void *rhs) {
+    return strcmp(((const hashTableNode_t *) lhs)->key.Ptr, ((const hashTableNode_t *) rhs)->key.Ptr);
+}
+
+/// @brief Compare node with key. Short key must be zero-padded aligned block
+static int sortedNodeCmp(const hashTableNode_t *node, const char *key, const size_t keyLen, bool longKeys) {
+    return longKeys ? longKeyCmp(node->key.Ptr, key, keyLen) : shortKeyCmp(&node->key.MM, (const MMi_t *) key);
+}
+
+/// @brief Index of the first node of sorted array that is not less than key
+static size_t sortedLowerBound(const hashTableNode_t *nodes, size_t count, const char *key, const size_t keyLen,
+                               bool longKeys) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (sortedNodeCmp(nodes + mid, key, keyLen, longKeys) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/// @brief Search bucket with sorted overflow array: inlined nodes one by one, then bisection of the array
+static hashTableNode_t *sortedBucketSearch(hashTableBucket_t *bucket, const char *key, const size_t keyLen,
+                                           bool longKeys) {
+    alignas(KEY_ALIGNMENT) char keyCopy[SMALL_STR_LEN] = "";
+    if (!longKeys) {
+        memcpy(keyCopy, key, keyLen);
+        key = keyCopy;
+    }
+
+    #if BUCKET_INLINE_NODES > 0
+    for (size_t idx = 0; idx < BUCKET_INLINE_NODES; idx++)
+        if (sortedNodeCmp(bucket->inlined + idx, key, keyLen, longKeys) == 0)
+            return bucket->inlined + idx;
+    #endif
+
+    const size_t count = bucket->size - BUCKET_INLINE_NODES;
+    const size_t pos = sortedLowerBound(bucket->elements, count, key, keyLen, longKeys);
+    if (pos < count && sortedNodeCmp(bucket->elements + pos, key, keyLen, longKeys) == 0)
+        return bucket->elements + pos;
+
+    return NULL;
+}
+
+/// @brief Sort overflow array of bucket that has just become big enough (or was filled unordered by rehash)
+static void bucketSortOverflow(hashTable_t *table, hashTableBucket_t *bucket, size_t count) {
+    qsort(bucket->elements, count, sizeof(hashTableNode_t), (bucket == &table->longKeys) ? longNodeCmp : shortNodeCmp);
+}
+
+/*!
+    @brief Move node appended to the end of sorted overflow array to its place.
+    Array that has just reached BUCKET_SORT_THRESHOLD nodes is sorted first
+    @return New position of the node
+*/
+static hashTableNode_t *bucketPlaceLastNode(hashTable_t *table, hashTableBucket_t *bucket) {
+    const bool longKeys = (bucket == &table->longKeys);
+    hashTableNode_t *nodes = bucket->elements;
+    const size_t count = bucket->size - BUCKET_INLINE_NODES - 1;
+    const hashTableNode_t newNode = nodes[count];
+
+    if (count + 1 == BUCKET_SORT_THRESHOLD)
+        bucketSortOverflow(table, bucket, count);
+
+    const char *key = longKeys ? newNode.key.Ptr : (const char *) &newNode.key.MM;
+    const size_t pos = sortedLowerBound(nodes, count, key, longKeys ? strlen(key) : 0, longKeys);
+    memmove(nodes + pos + 1, nodes + pos, (count - pos) * sizeof(hashTableNode_t));
+    nodes[pos] = newNode;
+
+    #ifdef HOT_KEY_CACHE
+    table->hotKeysEpoch++;
+    #endif
+
+    return nodes + pos;
+}
+#endif
+
+/// @brief Add zeroed node to the end of the bucket
+static hashTableStatus_t bucketAppendNode(hashTable_t *table, hashTableBucket_t *bucket, hashTableNode_t **nodePtr)
+{
+    assert(table);
+    assert(bucket);
+    assert(nodePtr);
+
+    // Allocating new node in array (first BUCKET_INLINE_NODES nodes are stored in the bucket itself).
+    // Bucket is left as it was if allocation fails
+    const size_t newSize = bucket->size + 1;
+    if (newSize > BUCKET_INLINE_NODES) {
+        const size_t overflowSize = newSize - BUCKET_INLINE_NODES;
+        hashTableNode_t *elements = NULL;
+        if (bucket->elements && inArena(table, bucket->elements)) {
+            // Compacted array has no spare capacity and can't be reallocated: it's copied to the heap
+            elements = CALLOC(hashTableNode_t, overflowSize);
+            if (elements)
+                memcpy(elements, bucket->elements, (overflowSize - 1) * sizeof(hashTableNode_t));
+        } else {
+            elements = (hashTableNode_t *) realloc(bucket->elements, overflowSize * sizeof(hashTableNode_t) );
+        }
+        if (!elements) {
+            hprintf("Failed to reallocate bucket\n");
+            _ERR_RET(HT_MEMORY_ERROR);
+        }
+        bucket->elements = elements;
+    }
+    bucket->size = newSize;
+
+    hashTableNode_t *newNode = bucketGetNode(bucket, newSize - 1);
+    memset(newNode, 0, sizeof(hashTableNode_t));
+
+    *nodePtr = newNode;
 
     return HT_SUCCESS;
 }
 
-static hashTableStatus_t allocateNode(hashTable_t *table, const char *key, hashTableBucket_t *bucket, hashTableNode_t **nodePtr)
+/// @brief Append node with copy of key to the bucket, long key is referenced as is if table->borrowedLongKeys
+/// @param zeroValue Value stored outside the node is zeroed, otherwise caller must write all of it
+static hashTableStatus_t allocateNode(hashTable_t *table, const char *key, const size_t keyLen,
+                                      hashTableBucket_t *bucket, hashTableNode_t **nodePtr, bool zeroValue)
 {
     assert(table);
     assert(table->buckets);
     assert(key);
     assert(bucket);
 
-    size_t keyLen = strlen(key);
-
-    // Allocating new node in array
-    const size_t newSize = ++bucket->size;
-    bucket->elements = (hashTableNode_t *) realloc(bucket->elements, newSize * sizeof(hashTableNode_t) );
-    if (!bucket->elements) {
-        hprintf("Failed to reallocate bucket\n");
-        _ERR_RET(HT_MEMORY_ERROR);
-    }
-
     // Prepairing new node
-    hashTableNode_t *newNode = bucket->elements + newSize - 1;
-    memset(newNode, 0, sizeof(hashTableNode_t));
+    hashTableNode_t *newNode = NULL;
+    #ifdef HOT_KEY_CACHE
+    const hashTableNode_t *oldOverflow = bucket->elements;
+    #endif
+    _ERR_RET(bucketAppendNode(table, bucket, &newNode));
+    #ifdef HOT_KEY_CACHE
+    // Overflow array was moved by realloc: cached pointers to its nodes are dangling
+    if (bucket->elements != oldOverflow)
+        table->hotKeysEpoch++;
+    #endif
+    HT_STAT(
+    table->stats.reallocs += (bucket->size > BUCKET_INLINE_NODES);
+    statsBucketResized(table, bucket, bucket->size - 1);
+    )
+    // Bucket index is -1 for array of long keys, last argument is 1 if overflow array was reallocated
+    HT_PROBE4(allocate, (bucket == &table->longKeys) ? -1 : bucket - table->buckets, bucket->size, keyLen,
+              bucket->size > BUCKET_INLINE_NODES);
 
     // Allocating place for value
     // If element is smaller than 16 bytes, then were store it in the node
@@ -263,11 +443,12 @@ static hashTableStatus_t allocateNode(hashTable_t *table, const char *key, hashT
     #endif
 
     if (needCalloc) {
-        void *newValue = calloc(1, table->valSize);
+        void *newValue = zeroValue ? calloc(1, table->valSize) : malloc(table->valSize);
         if (!newValue) {
             hprintf("Failed to allocate memory for value\n");
             _ERR_RET(HT_MEMORY_ERROR);
         }
+        HT_STAT(table->stats.allocations++;)
         #ifdef SHORT_VALUES_IN_NODE
         newNode->value.Ptr = newValue;
         #else
@@ -278,18 +459,28 @@ static hashTableStatus_t allocateNode(hashTable_t *table, const char *key, hashT
     // Copying key 
     if (keyLen < SMALL_STR_LEN) {
         memcpy(&newNode->key.MM, key, keyLen);
+    } else if (table->borrowedLongKeys) {
+        // Never written through: the pointer is kept in the same field as owned keys
+        assert(key[keyLen] == '\0');
+        newNode->key.Ptr = const_cast<char *>(key);
     } else {
         char *newKey = CALLOC(char, keyLen+1);
-        memcpy(newKey, key, keyLen);
         if (!newKey) {
             hprintf("Failed to allocate memory for key\n");
             _ERR_RET(HT_MEMORY_ERROR);
         }
+        HT_STAT(table->stats.allocations++;)
+        memcpy(newKey, key, keyLen);
         newNode->key.Ptr = newKey;
     }
 
     CMP_LEN_OPT(newNode->len = keyLen);
 
+    #if BUCKET_SORT_THRESHOLD > 0
+    if (bucketIsSorted(bucket))
+        newNode = bucketPlaceLastNode(table, bucket);
+    #endif
+
     *nodePtr = newNode;
 
     return HT_SUCCESS;
@@ -300,15 +491,15 @@ static hashTableStatus_t deallocateNode(hashTable_t *table, hashTableNode_t *nod
     assert(table);
     assert(node);
 
-    if (longKey)
-        FREE(node->key.Ptr);
+    if (longKey && !table->borrowedLongKeys)
+        TABLE_FREE(table, node->key.Ptr);
 
     #ifdef SHORT_VALUES_IN_NODE
         if (table->valSize > SMALL_STR_LEN) {
-            FREE(node->value.Ptr);
+            TABLE_FREE(table, node->value.Ptr);
         }   
     #else
-        FREE(node->value);
+        TABLE_FREE(table, node->value);
     #endif
 
     return HT_SUCCESS;
@@ -324,9 +515,34 @@ hashTableStatus_t hashTableCtor(hashTable_t *table, size_t valueSize, size_t buc
     table->bucketsCount = bucketsCount;
     table->valSize = valueSize;
 
-    _ERR_RET(allocateBuckets(table));
+    _ERR_RET(allocateBuckets(table->bucketsCount, &table->buckets));
 
     table->size = 0;
+    table->verifyBucket = table->verifyNode = 0;
+    table->arena = NULL;
+    table->arenaSize = 0;
+    table->borrowedLongKeys = false;
+
+    HT_STAT(
+    memset(&table->stats, 0, sizeof(table->stats));
+    statsResetHistogram(table);
+    )
+
+    #ifdef SEEDED_HASH
+    hashSeedInit(&table->seed);
+    #endif
+
+    #ifdef HOT_KEY_CACHE
+    table->hotKeys = CALLOC(hotKeyEntry_t, HOT_KEY_CACHE_SIZE);
+    if (!table->hotKeys) {
+        hprintf("Failed to allocate hot key cache\n");
+        blockFree(table->buckets, table->bucketsCount * sizeof(hashTableBucket_t));
+        table->buckets = NULL;
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+    // Entries are zeroed, so none of them matches the first epoch
+    table->hotKeysEpoch = 1;
+    #endif
 
     _VERIFY(table, HT_ERROR);
 
@@ -341,10 +557,92 @@ hashTableStatus_t hashTableDtor(hashTable_t *table)
 
     _ERR_RET(deallocateBuckets(table));
     _ERR_RET(deallocateLongKeys(table));
+    blockFree(table->arena, table->arenaSize);
+    table->arena = NULL;
+    table->arenaSize = 0;
+
+    #ifdef HOT_KEY_CACHE
+    FREE(table->hotKeys);
+    #endif
+
+    return HT_SUCCESS;
+}
+
+
+/// @brief Move all nodes with short keys to the new array of buckets.
+/// Nodes are copied and the table switches to the new array only when all of them are placed,
+/// so on failure the table is left as it was
+static hashTableStatus_t rehash(hashTable_t *table, size_t newBucketsCount)
+{
+    assert(table);
+    assert(newBucketsCount > 0);
+
+    hashTableBucket_t *newBuckets = NULL;
+    _ERR_RET(allocateBuckets(newBucketsCount, &newBuckets));
+
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        hashTableBucket_t *bucket = table->buckets + bucketIdx;
+
+        for (size_t idx = 0; idx < bucket->size; idx++) {
+            hashTableNode_t *node = bucketGetNode(bucket, idx);
+            // Keys in nodes are aligned and padded with zeros
+            hash_t keyHash = KEY_HASH(table, &node->key.MM);
+
+            hashTableNode_t *newNode = NULL;
+            hashTableBucket_t *newBucket = newBuckets + keyHash % newBucketsCount;
+            if (bucketAppendNode(table, newBucket, &newNode) != HT_SUCCESS) {
+                freeBucketsArray(table, newBuckets, newBucketsCount);
+                _ERR_RET(HT_MEMORY_ERROR);
+            }
+            HT_STAT(table->stats.reallocs += (newBucket->size > BUCKET_INLINE_NODES);)
+            // Values stored in node are moved with it, pointers to bigger values stay the same
+            memcpy(newNode, node, sizeof(hashTableNode_t));
+        }
+    }
+
+    freeBucketsArray(table, table->buckets, table->bucketsCount);
+    table->buckets      = newBuckets;
+    table->bucketsCount = newBucketsCount;
+
+    HT_STAT(
+    statsResetHistogram(table);
+    for (size_t bucketIdx = 0; bucketIdx < newBucketsCount; bucketIdx++)
+        statsBucketResized(table, newBuckets + bucketIdx, 0);
+    )
+
+    #if BUCKET_SORT_THRESHOLD > 0
+    // Nodes were appended in order of old buckets
+    for (size_t bucketIdx = 0; bucketIdx < newBucketsCount; bucketIdx++) {
+        hashTableBucket_t *bucket = table->buckets + bucketIdx;
+        if (bucketIsSorted(bucket))
+            bucketSortOverflow(table, bucket, bucket->size - BUCKET_INLINE_NODES);
+    }
+    #endif
+
+    #ifdef HOT_KEY_CACHE
+    table->hotKeysEpoch++;
+    #endif
 
     return HT_SUCCESS;
 }
 
+hashTableStatus_t hashTableReserve(hashTable_t *table, size_t expectedKeys)
+{
+    assert(table);
+    assert(table->buckets);
+
+    _VERIFY(table, HT_ERROR);
+
+    const size_t neededBuckets = expectedKeys / RESERVE_LOAD_FACTOR + 1;
+    if (neededBuckets <= table->bucketsCount)
+        return HT_SUCCESS;
+
+    _ERR_RET(rehash(table, neededBuckets));
+
+    _VERIFY(table, HT_ERROR);
+
+    return HT_SUCCESS;
+}
 
 /* ===================================== Hash table functions ================================ */
 
@@ -367,24 +665,47 @@ static int fastStrcmp(MMi_t a, MMi_t b) {
     return (int) (cmpMask ^ _MM_MASK_CONSTANT);
 }
 
-static hashTableNode_t *hashTableLongKeySearch(hashTableBucket_t *longKeys, const char *key) {
+/// @brief Search long key in separate array. Key doesn't have to be null-terminated
+static hashTableNode_t *hashTableLongKeySearch(hashTableBucket_t *longKeys, const char *key, const size_t keyLen) {
 
-    hashTableNode_t *node = longKeys->elements;
     size_t bucketSize = longKeys->size;
 
-    const size_t keyLen = strlen(key);  // TODO: length of key is known before this function is called
+    #if BUCKET_SORT_THRESHOLD > 0
+    if (bucketIsSorted(longKeys)) {
+        hashTableNode_t *node = sortedBucketSearch(longKeys, key, keyLen, true);
+        HT_PROBE3(long_key_search, bucketSize, keyLen, node != NULL);
+        return node;
+    }
+    #endif
 
     for (size_t idx = 0; idx < bucketSize; idx++) {
-        if (CMP_LEN_OPT(node->len == keyLen &&) strncmp(key, node->key.Ptr, keyLen) == 0)
+        hashTableNode_t *node = bucketGetNode(longKeys, idx);
+        // Stored key must end exactly where searched key ends
+        if (CMP_LEN_OPT(node->len == keyLen &&) strncmp(node->key.Ptr, key, keyLen) == 0 && node->key.Ptr[keyLen] == '\0') {
+            HT_PROBE3(long_key_search, bucketSize, keyLen, 1);
             return node;
-        
+        }
+    }
+    HT_PROBE3(long_key_search, bucketSize, keyLen, 0);
+    return NULL;
+}
+
+/// @brief Search short key in contiguous array of nodes
+static hashTableNode_t *nodesSearch(hashTableNode_t *node, const size_t count, MMi_t searchKey, const size_t keyLen) {
+    (void) keyLen; // used only with CMP_LEN_FIRST
+
+    for (size_t idx = 0; idx < count; idx++) {
+        if (CMP_LEN_OPT(node->len == keyLen &&) fastStrcmp(searchKey, node->key.MM) == 0)
+            return node;
+
         node++;
     }
+
     return NULL;
 }
 
 /// @brief Search element with short key in given bucket
-static hashTableNode_t *bucketSearch(const hashTableBucket_t *bucket, const char *key, const size_t keyLen) {
+static hashTableNode_t *bucketSearch(hashTableBucket_t *bucket, const char *key, const size_t keyLen) {
     assert(keyLen < SMALL_STR_LEN);
     assert(bucket);
     assert(key);
@@ -413,36 +734,121 @@ static hashTableNode_t *bucketSearch(const hashTableBucket_t *bucket, const char
         MMi_t searchKey = _MM_LOAD((const MMi_t *) key);
     #endif
 
-    hashTableNode_t *node = bucket->elements;
-    size_t bucketSize = bucket->size;
+    const size_t bucketSize = bucket->size;
 
-    for (size_t idx = 0; idx < bucketSize; idx++) {
-        if (CMP_LEN_OPT(node->len == keyLen &&) fastStrcmp(searchKey, node->key.MM) == 0)
-            return node;
-        
-        node++;
-    }
+    // Inlined nodes lay in the same cache line as bucket header, so most searches end here
+    #if BUCKET_INLINE_NODES > 0
+    const size_t inlinedCount = (bucketSize < BUCKET_INLINE_NODES) ? bucketSize : BUCKET_INLINE_NODES;
+    hashTableNode_t *node = nodesSearch(bucket->inlined, inlinedCount, searchKey, keyLen);
+    if (node || bucketSize <= BUCKET_INLINE_NODES)
+        return node;
+    #endif
 
-    return NULL;
+    return nodesSearch(bucket->elements, bucketSize - BUCKET_INLINE_NODES, searchKey, keyLen);
 }
 
-static hashTableNode_t *bucketSearch_NOINTRIN(const hashTableBucket_t *bucket, const char *key, const size_t keyLen) {
-    hashTableNode_t *node = bucket->elements;
+static hashTableNode_t *bucketSearch_NOINTRIN(hashTableBucket_t *bucket, const char *key, const size_t keyLen) {
     const size_t bucketSize = bucket->size;
 
     for (size_t idx = 0; idx < bucketSize; idx++) {
+        hashTableNode_t *node = bucketGetNode(bucket, idx);
         if (CMP_LEN_OPT(node->len == keyLen &&) strncmp(key, (const char *) &node->key.MM, keyLen + 1) == 0)
             return node;
-        
-        node++;
     }
     return NULL;
 }
 
+/// @brief Search element with short key in given bucket
+static hashTableNode_t *bucketFind(hashTableBucket_t *bucket, const char *key, const size_t keyLen) {
+    #if BUCKET_SORT_THRESHOLD > 0
+    if (bucketIsSorted(bucket))
+        return sortedBucketSearch(bucket, key, keyLen, false);
+    #endif
+
+    #ifndef FAST_STRCMP
+    return bucketSearch_NOINTRIN(bucket, key, keyLen);
+    #else
+    return bucketSearch(bucket, key, keyLen);
+    #endif
+}
+
+/// @brief Index of the node in the bucket (inverse of bucketGetNode)
+static size_t bucketNodeIndex(hashTableBucket_t *bucket, hashTableNode_t *node) {
+    #if BUCKET_INLINE_NODES > 0
+    if (node >= bucket->inlined && node < bucket->inlined + BUCKET_INLINE_NODES)
+        return (size_t) (node - bucket->inlined);
+    #endif
+    return BUCKET_INLINE_NODES + (size_t) (node - bucket->elements);
+}
+
+
+#ifdef SELF_ORGANIZING_BUCKETS
+/// @brief Swap sampled hit with its predecessor, so frequently found nodes drift to the head of the bucket
+/// Transposition instead of move-to-front: one hit of a rare key can't push the hottest key deep into the bucket
+static hashTableNode_t *promoteNode(hashTable_t *table, hashTableBucket_t *bucket, hashTableNode_t *node) {
+    if (!node || node == bucketGetNode(bucket, 0))
+        return node;
+
+    // Order of sorted overflow array is kept: its nodes are found by bisection anyway
+    if (bucketIsSorted(bucket) && nodeInOverflow(bucket, node))
+        return node;
+
+    // Hits in the head are not counted, so the most common case stays read-only
+    if (++table->promoteTick % PROMOTE_SAMPLE_PERIOD != 0)
+        return node;
+
+    hashTableNode_t *prev = bucketGetNode(bucket, bucketNodeIndex(bucket, node) - 1);
+    hashTableNode_t tmp = *prev;
+    *prev = *node;
+    *node = tmp;
+
+    return prev;
+}
+#endif
+
+#ifdef HOT_KEY_CACHE
+/// @brief Compare short key prepared as for bucketFind with key of the node
+static bool nodeHasShortKey(const hashTableNode_t *node, const char *key, const size_t keyLen) {
+    (void) keyLen; // used only without ALIGNED_KEYS or with CMP_LEN_FIRST
+    CMP_LEN_OPT(if (node->len != keyLen) return false;)
+
+    #if defined(FAST_STRCMP) && defined(ALIGNED_KEYS)
+    return fastStrcmp(_MM_LOAD((const MMi_t *) key), node->key.MM) == 0;
+    #else
+    return strncmp(key, (const char *) &node->key.MM, keyLen + 1) == 0;
+    #endif
+}
+#endif
+
+
+#ifdef HASH_TABLE_STATS
+/// @brief Count lookup that was finished by linear search of the bucket (before any promotion)
+static void statsCountLookup(hashTable_t *table, hashTableBucket_t *bucket, hashTableNode_t *node) {
+    table->stats.lookups++;
+    if (bucketIsSorted(bucket)) {
+        // Inlined nodes and steps of bisection (as if search always went through all of them)
+        const uint64_t overflowSize = bucket->size - BUCKET_INLINE_NODES;
+        table->stats.nodesCompared += BUCKET_INLINE_NODES + 64 - (uint64_t) __builtin_clzll(overflowSize);
+        table->stats.hits   += (node != NULL);
+        table->stats.misses += (node == NULL);
+        return;
+    }
+
+    if (node) {
+        table->stats.hits++;
+        table->stats.nodesCompared += bucketNodeIndex(bucket, node) + 1;
+    } else {
+        table->stats.misses++;
+        table->stats.nodesCompared += bucket->size;
+    }
+}
+#endif
 
 /// @brief Core function of hashTable
 /// Search element in table, return pointer to it (or NULL) and write pointer of corresponding bucket   
-static hashTableNode_t *hashTableGetBucketAndElement(hashTable_t *table, const char *key, hashTableBucket_t **bucketPtr) {
+/// Short keys must satisfy ALIGNED_KEYS requirements, long keys may be not null-terminated
+static hashTableNode_t *hashTableGetBucketAndElement(hashTable_t *table, const char *key, const size_t keyLen,
+                                                     hashTableBucket_t **bucketPtr) {
     assert(table);
     assert(key);
     assert(table->buckets);
@@ -450,16 +856,22 @@ static hashTableNode_t *hashTableGetBucketAndElement(hashTable_t *table, const c
 
     _VERIFY(table, NULL);
 
-    const size_t keyLen = strlen(key);
-
     // long key -> search in separate array
     if (keyLen >= SMALL_STR_LEN) {
         if (bucketPtr)
             *bucketPtr = &table->longKeys;
-        return hashTableLongKeySearch(&table->longKeys, key);
+        hashTableNode_t *node = hashTableLongKeySearch(&table->longKeys, key, keyLen);
+        HT_STAT(
+        table->stats.longKeyScans++;
+        statsCountLookup(table, &table->longKeys, node);
+        )
+        #ifdef SELF_ORGANIZING_BUCKETS
+        node = promoteNode(table, &table->longKeys, node);
+        #endif
+        return node;
     }
 
-    hash_t keyHash = _HASH_FUNC(key); 
+    hash_t keyHash = KEY_HASH(table, key);
     // Determining index of the corresponding bucket
     size_t bucketIdx = keyHash % table->bucketsCount;
 
@@ -468,64 +880,211 @@ static hashTableNode_t *hashTableGetBucketAndElement(hashTable_t *table, const c
     if (bucketPtr)
         *bucketPtr = bucket;
 
-    #ifndef FAST_STRCMP
-    return bucketSearch_NOINTRIN(bucket, key, keyLen);
+    #ifdef HOT_KEY_CACHE
+    hotKeyEntry_t *hotEntry = table->hotKeys + (keyHash & (HOT_KEY_CACHE_SIZE - 1));
+    if (hotEntry->epoch == table->hotKeysEpoch && nodeHasShortKey(hotEntry->node, key, keyLen)) {
+        HT_STAT(
+        table->stats.lookups++;
+        table->stats.hits++;
+        table->stats.nodesCompared++;
+        )
+        HT_PROBE4(lookup, bucketIdx, bucket->size, keyLen, 1);
+        return hotEntry->node;
+    }
     #endif
-    return bucketSearch(bucket, key, keyLen);
-}
 
+    hashTableNode_t *node = bucketFind(bucket, key, keyLen);
+    HT_STAT(statsCountLookup(table, bucket, node);)
+    HT_PROBE4(lookup, bucketIdx, bucket->size, keyLen, node != NULL);
 
+    #ifdef SELF_ORGANIZING_BUCKETS
+    node = promoteNode(table, bucket, node);
+    #endif
 
+    #ifdef HOT_KEY_CACHE
+    // Head of the bucket is found with one comparison anyway, caching it would only add writes
+    if (node && node != bucketGetNode(bucket, 0)) {
+        hotEntry->node  = node;
+        hotEntry->epoch = table->hotKeysEpoch;
+    }
+    #endif
 
-/// @brief Insert element in hashTable
-hashTableStatus_t hashTableInsert(hashTable_t *table, const char *key, const void *value)
-{
-    assert(table);
-    assert(key);
-    assert(table->valSize==0 || value);
+    return node;
+}
 
-    assert(table->buckets);
-    assert(table->bucketsCount > 0);
+/// @brief Load short key of known length into aligned block with trailing zeros
+/// Key itself may be unaligned and not null-terminated
+__attribute__((no_sanitize_address))
+static void loadShortKey(char *keyCopy, const char *key, const size_t keyLen) {
+    assert(keyLen < SMALL_STR_LEN);
+    assert((size_t)keyCopy % KEY_ALIGNMENT == 0);
+
+    #if defined(SSE)
+    // Reading whole register is safe if it doesn't cross page boundary
+    // Bytes after the end of the key are masked out
+    const size_t PAGE_SIZE = 4096;
+    if ((size_t)key % PAGE_SIZE <= PAGE_SIZE - SMALL_STR_LEN) {
+        static const uint8_t mask[2 * SMALL_STR_LEN] =
+            {255, 255, 255, 255, 255, 255, 255, 255,
+             255, 255, 255, 255, 255, 255, 255, 255};
 
-    _VERIFY(table, HT_ERROR);
+        MMi_t keyReg  = _mm_loadu_si128((const __m128i_u *) key);
+        MMi_t maskReg = _mm_loadu_si128((const __m128i_u *) (mask + (SMALL_STR_LEN - keyLen)) );
+        _mm_store_si128((MMi_t *) keyCopy, _mm_and_si128(keyReg, maskReg));
+        return;
+    }
+    #endif
 
-    hashTableBucket_t *bucket = NULL;
-    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, &bucket);
+    memset(keyCopy, 0, SMALL_STR_LEN);
+    memcpy(keyCopy, key, keyLen);
+}
 
-    if (!node) {
-        table->size++;
-        _ERR_RET(allocateNode(table, key, bucket, &node) );
-    }
+#ifdef PACKED_KEYS
+/// @brief Replace key that can be packed by its packed copy with length SMALL_STR_LEN - 1,
+/// so it is stored and searched as short key. Other keys are returned as they are
+static inline const char *packLongKey(const char *key, size_t *keyLen, char *packed) {
+    // Short keys are the common case: they must fall through to the hash without taken branches
+    if (__builtin_expect(*keyLen < SMALL_STR_LEN, 1) || !packKeyLetters(key, *keyLen, packed))
+        return key;
 
-    void *dest = getValueFromNode(table, node);
-    memcpy(dest, value, table->valSize);
+    *keyLen = SMALL_STR_LEN - 1;
+    return packed;
+}
+#endif
 
-    return HT_SUCCESS;
+/// @brief Length of zero-padded short key as it is passed to bucketFind
+static inline size_t shortKeyLen(const char *key) {
+    #ifdef PACKED_KEYS
+    if (isPackedKey(key))
+        return SMALL_STR_LEN - 1;
+    #endif
+    return strlen(key);
 }
 
-/// @brief Access element in hash table or insert it with default value
-/// @return Ptr to element or NULL in case of error
-void *hashTableAccess(hashTable_t *table, const char *key)
+hashTableNode_t *hashTableFindNode(hashTable_t *table, const char *key, size_t keyLen)
 {
     assert(table);
     assert(key);
 
-    assert(table->buckets);
-    assert(table->bucketsCount > 0);
+    PACK_LONG_KEY(key, keyLen);
+    if (keyLen >= SMALL_STR_LEN)
+        return hashTableGetBucketAndElement(table, key, keyLen, NULL);
 
-    _VERIFY(table, NULL);
+    alignas(KEY_ALIGNMENT) char keyCopy[SMALL_STR_LEN];
+    loadShortKey(keyCopy, key, keyLen);
 
+    return hashTableGetBucketAndElement(table, keyCopy, keyLen, NULL);
+}
+
+hashTableNode_t *hashTableAccessNode(hashTable_t *table, const char *key, size_t keyLen, bool *inserted)
+{
+    assert(table);
+    assert(key);
+    assert(inserted);
+
+    PACK_LONG_KEY(key, keyLen);
+    alignas(KEY_ALIGNMENT) char keyCopy[SMALL_STR_LEN];
+    if (keyLen < SMALL_STR_LEN) {
+        loadShortKey(keyCopy, key, keyLen);
+        key = keyCopy;
+    }
+
+    hashTableBucket_t *bucket = NULL;
+    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, keyLen, &bucket);
+
+    *inserted = (node == NULL);
+    if (!node) {
+        table->size++;
+        _ERR_RET_PTR(allocateNode(table, key, keyLen, bucket, &node, true));
+    }
+
+    return node;
+}
+
+
+
+
+/// @brief Insert element in hashTable
+hashTableStatus_t hashTableInsert(hashTable_t *table, const char *key, const void *value)
+{
+    assert(table);
+    assert(key);
+    assert(table->valSize==0 || value);
+
+    assert(table->buckets);
+    assert(table->bucketsCount > 0);
+
+    _VERIFY(table, HT_ERROR);
+
+    size_t keyLen = strlen(key);
+    PACK_LONG_KEY(key, keyLen);
+    hashTableBucket_t *bucket = NULL;
+    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, keyLen, &bucket);
+
+    if (!node) {
+        table->size++;
+        _ERR_RET(allocateNode(table, key, keyLen, bucket, &node, false));
+    }
+
+    void *dest = getValueFromNode(table, node);
+    memcpy(dest, value, table->valSize);
+
+    return HT_SUCCESS;
+}
+
+/// @brief Access element in hash table or insert it with default value
+/// @return Ptr to element or NULL in case of error
+void *hashTableAccess(hashTable_t *table, const char *key)
+{
+    assert(table);
+    assert(key);
+
+    assert(table->buckets);
+    assert(table->bucketsCount > 0);
+
+    _VERIFY(table, NULL);
+
+    size_t keyLen = strlen(key);
+    PACK_LONG_KEY(key, keyLen);
     hashTableBucket_t *bucket = NULL;
-    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, &bucket);
+    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, keyLen, &bucket);
 
     if (!node) {
         table->size++;
-        _ERR_RET_PTR(allocateNode(table, key, bucket, &node));
+        _ERR_RET_PTR(allocateNode(table, key, keyLen, bucket, &node, true));
     }
 
     return getValueFromNode(table, node);
 }
 
+void *hashTableEmplace(hashTable_t *table, const char *key, hashTableValueInit_t init, void *ctx)
+{
+    assert(table);
+    assert(key);
+    assert(init);
+
+    assert(table->buckets);
+    assert(table->bucketsCount > 0);
+
+    _VERIFY(table, NULL);
+
+    size_t keyLen = strlen(key);
+    PACK_LONG_KEY(key, keyLen);
+    hashTableBucket_t *bucket = NULL;
+    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, keyLen, &bucket);
+    if (node)
+        return getValueFromNode(table, node);
+
+    // Value outside the node is left uninitialized: init writes it once
+    table->size++;
+    _ERR_RET_PTR(allocateNode(table, key, keyLen, bucket, &node, false));
+
+    void *value = getValueFromNode(table, node);
+    init(value, ctx);
+
+    return value;
+}
+
 
 void *hashTableFind(hashTable_t *table, const char *key)
 {
@@ -536,94 +1095,938 @@ void *hashTableFind(hashTable_t *table, const char *key)
 
     _VERIFY(table, NULL);
 
-    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, NULL);
-    
+    size_t keyLen = strlen(key);
+    PACK_LONG_KEY(key, keyLen);
+    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, keyLen, NULL);
+
     return (node) ? getValueFromNode(table, node) : NULL;
 }
 
-hashTableStatus_t hashTableVerify(hashTable_t *table)
+hashTableStatus_t hashTableErase(hashTable_t *table, const char *key)
 {
-    if (!table)
-        return HT_ERROR;
+    assert(table);
+    assert(key);
+    assert(table->buckets);
+    assert(table->bucketsCount);
 
-    if (table->bucketsCount == 0) {
-        errprintf("Table is probably not initialized: bucketsCount = 0\n");
-        return HT_NO_INIT;
+    _VERIFY(table, HT_ERROR);
+
+    size_t keyLen = strlen(key);
+    PACK_LONG_KEY(key, keyLen);
+    hashTableBucket_t *bucket = NULL;
+    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, keyLen, &bucket);
+    if (!node)
+        return HT_NO_KEY;
+
+    _ERR_RET(deallocateNode(table, node, keyLen >= SMALL_STR_LEN));
+
+    // Last node of the bucket takes place of erased one, so nodes stay contiguous.
+    // Sorted overflow array is shifted instead, so it stays sorted
+    hashTableNode_t *lastNode = bucketGetNode(bucket, bucket->size - 1);
+    if (bucketIsSorted(bucket) && nodeInOverflow(bucket, node))
+        memmove(node, node + 1, (size_t) (lastNode - node) * sizeof(hashTableNode_t));
+    else if (lastNode != node)
+        memcpy(node, lastNode, sizeof(hashTableNode_t));
+
+    bucket->size--;
+    if (bucket->size <= BUCKET_INLINE_NODES)
+        TABLE_FREE(table, bucket->elements);
+    HT_STAT(statsBucketResized(table, bucket, bucket->size + 1);)
+
+    table->size--;
+
+    #ifdef HOT_KEY_CACHE
+    table->hotKeysEpoch++;
+    #endif
+
+    _VERIFY(table, HT_ERROR);
+
+    return HT_SUCCESS;
+}
+
+/* ================================ Bulk insertion ================================ */
+
+/// Buckets in one partition of hashTableBulkAccess: together with their nodes they should fit in L2
+static const size_t BULK_PARTITION_BUCKETS = 2048;
+/// Fanout of the radix pass: each partition needs its own write stream, too many of them thrash L1 and TLB
+static const size_t BULK_MAX_PARTITIONS = 1024;
+/// How many keys ahead buckets are prefetched
+static const size_t BULK_PREFETCH_DISTANCE = 8;
+
+typedef struct {
+    MMi_t  key;         ///< Copy of short key, so insertion doesn't touch keys array in random order
+    size_t bucketIdx;
+    size_t keyIdx;
+} bulkRecord_t;
+
+hashTableStatus_t hashTableBulkAccess(hashTable_t *table, const char *const *keys, size_t count, void **values)
+{
+    assert(table);
+    assert(table->buckets);
+    assert(keys);
+    assert(values);
+
+    _VERIFY(table, HT_ERROR);
+
+    if (count == 0)
+        return HT_SUCCESS;
+
+    // Partitions are ranges of consecutive buckets: bucketIdx >> partitionShift
+    size_t partitionShift = 0;
+    while (((size_t) 1 << partitionShift) < BULK_PARTITION_BUCKETS) partitionShift++;
+    while (((table->bucketsCount - 1) >> partitionShift) >= BULK_MAX_PARTITIONS) partitionShift++;
+    const size_t partitionsCount = ((table->bucketsCount - 1) >> partitionShift) + 1;
+
+    // positions[] holds bucket index of each key until it is inserted, then index of its node in the bucket
+    size_t       *positions   = CALLOC(size_t, count);
+    bulkRecord_t *records     = CALLOC(bulkRecord_t, count);
+    size_t       *longKeyIdxs = CALLOC(size_t, count);
+    size_t       *offsets     = CALLOC(size_t, partitionsCount + 1);
+    if (!positions || !records || !longKeyIdxs || !offsets) {
+        free(positions); free(records); free(longKeyIdxs); free(offsets);
+        hprintf("Failed to allocate buffers for bulk insertion\n");
+        _ERR_RET(HT_MEMORY_ERROR);
     }
 
-    if (!table->buckets) {
-        errprintf("Buckets ptr is null");
-        return HT_MEMORY_ERROR;
+    /* ---------- Hashing all keys and building histogram of partitions ---------- */
+    size_t longKeysCount = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        const char *key = keys[idx];
+        size_t keyLen = strlen(key);
+        PACK_LONG_KEY(key, keyLen);
+        if (keyLen >= SMALL_STR_LEN) {
+            longKeyIdxs[longKeysCount++] = idx;
+            continue;
+        }
+
+        const size_t bucketIdx = KEY_HASH(table, key) % table->bucketsCount;
+        positions[idx] = bucketIdx;
+        offsets[(bucketIdx >> partitionShift) + 1]++;
     }
 
-    size_t size = 0;
-    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
-        hashTableBucket_t *bucket = &table->buckets[bucketIdx];
-        size += bucket->size;
+    for (size_t part = 0; part < partitionsCount; part++)
+        offsets[part + 1] += offsets[part];
 
-        hashTableNode_t *node = bucket->elements;
+    /* ---------- Radix scatter: records of one partition become contiguous ---------- */
+    // offsets[part] is moved to the end of partition while scattering, offsets[part - 1] is its beginning
+    for (size_t idx = 0, longIdx = 0; idx < count; idx++) {
+        if (longIdx < longKeysCount && longKeyIdxs[longIdx] == idx) {
+            longIdx++;
+            continue;
+        }
+        const char *key = keys[idx];
+        size_t keyLen = strlen(key);
+        PACK_LONG_KEY(key, keyLen);
+
+        const size_t bucketIdx = positions[idx];
+        bulkRecord_t *record = records + offsets[bucketIdx >> partitionShift]++;
+        loadShortKey((char *) &record->key, key, keyLen);
+        record->bucketIdx = bucketIdx;
+        record->keyIdx    = idx;
+    }
 
-        for (size_t idx = 0; idx < bucket->size; idx++) {
-            const size_t keyLen = strlen((const char *)&node->key.MM);
-            if (keyLen >= SMALL_STR_LEN) {
-                errprintf("Long key found in buckets with short keys\n");
-                return HT_NO_KEY;
+    /* ---------- Inserting partition by partition while its buckets are in cache ---------- */
+    hashTableStatus_t insertStatus = HT_SUCCESS;
+    size_t partBegin = 0;
+    for (size_t part = 0; part < partitionsCount && insertStatus == HT_SUCCESS; part++) {
+        const size_t partEnd = offsets[part];
+
+        for (size_t rec = partBegin; rec < partEnd; rec++) {
+            if (rec + BULK_PREFETCH_DISTANCE < partEnd)
+                _mm_prefetch((const char *) (table->buckets + records[rec + BULK_PREFETCH_DISTANCE].bucketIdx), _MM_HINT_T0);
+
+            const char *key = (const char *) &records[rec].key;
+            const size_t keyLen = shortKeyLen(key);
+            hashTableBucket_t *bucket = table->buckets + records[rec].bucketIdx;
+
+            hashTableNode_t *node = bucketFind(bucket, key, keyLen);
+            HT_STAT(statsCountLookup(table, bucket, node);)
+            HT_PROBE4(lookup, records[rec].bucketIdx, bucket->size, keyLen, node != NULL);
+            if (!node) {
+                table->size++;
+                insertStatus = allocateNode(table, key, keyLen, bucket, &node, true);
+                if (insertStatus != HT_SUCCESS)
+                    break;
             }
+            positions[records[rec].keyIdx] = bucketNodeIndex(bucket, node);
+        }
 
-            hash_t hash = _HASH_FUNC(&node->key.MM);
+        // Buckets of this partition won't change anymore, so pointers to values are stable
+        // Inserts into sorted overflow arrays shift nodes, so nodes of such buckets are found again
+        for (size_t rec = partBegin; rec < partEnd && insertStatus == HT_SUCCESS; rec++) {
+            hashTableBucket_t *bucket = table->buckets + records[rec].bucketIdx;
+            const char *key = (const char *) &records[rec].key;
+            hashTableNode_t *node = bucketIsSorted(bucket) ? bucketFind(bucket, key, shortKeyLen(key))
+                                                           : bucketGetNode(bucket, positions[records[rec].keyIdx]);
+            values[records[rec].keyIdx] = getValueFromNode(table, node);
+        }
 
-            if (hash % table->bucketsCount != bucketIdx) {
-                errprintf("Key %s with hash %ju must be in bucket %ju, but lays in bucket %zu\n",
-                             (const char *)&node->key.MM,    hash,     hash % table->bucketsCount,     bucketIdx);
-                return HT_WRONG_HASH;
-            }
+        partBegin = partEnd;
+    }
 
-            #if defined(CMP_LEN_FIRST)
-                if (keyLen != node->len) {
-                    errprintf("Wrong len of key %s\n", (const char *)&node->key.MM);
-                    return HT_NO_KEY;
-                }
-            #endif
+    /* ---------- Long keys are stored in one array ---------- */
+    for (size_t longIdx = 0; longIdx < longKeysCount && insertStatus == HT_SUCCESS; longIdx++) {
+        const char *key = keys[longKeyIdxs[longIdx]];
+        const size_t keyLen = strlen(key);
+
+        hashTableNode_t *node = hashTableLongKeySearch(&table->longKeys, key, keyLen);
+        HT_STAT(
+        table->stats.longKeyScans++;
+        statsCountLookup(table, &table->longKeys, node);
+        )
+        if (!node) {
+            table->size++;
+            insertStatus = allocateNode(table, key, keyLen, &table->longKeys, &node, true);
+        }
+        if (insertStatus == HT_SUCCESS)
+            positions[longKeyIdxs[longIdx]] = bucketNodeIndex(&table->longKeys, node);
+    }
+
+    for (size_t longIdx = 0; longIdx < longKeysCount && insertStatus == HT_SUCCESS; longIdx++) {
+        const size_t keyIdx = longKeyIdxs[longIdx];
+        hashTableNode_t *node = bucketIsSorted(&table->longKeys)
+                              ? hashTableLongKeySearch(&table->longKeys, keys[keyIdx], strlen(keys[keyIdx]))
+                              : bucketGetNode(&table->longKeys, positions[keyIdx]);
+        values[keyIdx] = getValueFromNode(table, node);
+    }
+
+    free(positions);
+    free(records);
+    free(longKeyIdxs);
+    free(offsets);
+
+    _ERR_RET(insertStatus);
+
+    _VERIFY(table, HT_ERROR);
 
-            if (!getValueFromNode(table, node)) {
-                errprintf("Found node without value in bucket %zu (valSize > 0)\n", bucketIdx);
-                return HT_NO_VALUE;
+    return HT_SUCCESS;
+}
+
+/* ================================ Counters ================================ */
+
+/// Keys merged and applied at once by hashTableIncrementBatch
+static const size_t INCREMENT_BATCH = 1024;
+/// Slots of the merge table of one batch, power of two
+static const size_t INCREMENT_MERGE_SLOTS = 2 * INCREMENT_BATCH;
+
+typedef struct {
+    MMi_t    key;               ///< Copy of short key, so applying doesn't touch keys array
+    uint32_t keyLen;
+    uint32_t owner;             ///< Record of the first occurrence of key in the batch
+    size_t   bucketIdx;
+    hashTableCounter_t delta;   ///< Sum of deltas of all occurrences of key in the batch
+} incrementRecord_t;
+
+static hashTableStatus_t checkCounters(const hashTable_t *table) {
+    if (table->valSize != sizeof(hashTableCounter_t)) {
+        hprintf("Counters need value size %zu, table has %zu\n", sizeof(hashTableCounter_t), table->valSize);
+        return HT_WRONG_SIZE;
+    }
+    return HT_SUCCESS;
+}
+
+static inline hashTableCounter_t *nodeCounter(hashTableNode_t *node) {
+    #ifdef SHORT_VALUES_IN_NODE
+    return (hashTableCounter_t *) &node->value.MM;
+    #else
+    return (hashTableCounter_t *) node->value;
+    #endif
+}
+
+hashTableStatus_t hashTableIncrement(hashTable_t *table, const char *key, hashTableCounter_t delta)
+{
+    assert(table);
+    assert(key);
+    assert(table->buckets);
+
+    _VERIFY(table, HT_ERROR);
+    _ERR_RET(checkCounters(table));
+
+    size_t keyLen = strlen(key);
+    PACK_LONG_KEY(key, keyLen);
+    hashTableBucket_t *bucket = NULL;
+    hashTableNode_t *node = hashTableGetBucketAndElement(table, key, keyLen, &bucket);
+
+    if (!node) {
+        table->size++;
+        _ERR_RET(allocateNode(table, key, keyLen, bucket, &node, true));
+    }
+
+    *nodeCounter(node) += delta;
+
+    _VERIFY(table, HT_ERROR);
+
+    return HT_SUCCESS;
+}
+
+/*!
+    @brief Merge repeated short keys of the batch, long keys are incremented at once
+    Key number idx of the batch gets records[idx + 1], records[0] is a sentinel that matches no short key.
+    Merge table is direct-mapped and merging is branchless: in natural text the next key is repeated or new
+    at random, so a branch on it would be mispredicted every other key. Every store of the first pass goes
+    to the place known before the comparison: store to the owner's record would make the next loads wait for
+    its address, deltas are summed by the second pass. Colliding keys are not merged, their records are applied
+    one after another
+    @param unique Receives indices of records of new keys
+    @return Number of new keys
+*/
+static size_t mergeIncrementBatch(hashTable_t *table, const char *const *keys, size_t count, hashTableCounter_t delta,
+                                  incrementRecord_t *records, uint16_t *unique, hashTableStatus_t *result) {
+    // Index of the record that holds the last key mapped to the slot
+    uint16_t slots[INCREMENT_MERGE_SLOTS];
+    memset(slots, 0, sizeof(slots));
+
+    size_t uniqueCount = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        incrementRecord_t *record = records + idx + 1;
+        record->owner = 0;
+        record->delta = 0;
+
+        const char *key = keys[idx];
+        size_t keyLen = strlen(key);
+        PACK_LONG_KEY(key, keyLen);
+        if (keyLen >= SMALL_STR_LEN) {
+            *result = hashTableIncrement(table, keys[idx], delta);
+            if (*result != HT_SUCCESS)
+                return uniqueCount;
+            continue;
+        }
+
+        loadShortKey((char *) &record->key, key, keyLen);
+        const hash_t keyHash = KEY_HASH(table, &record->key);
+        record->keyLen    = (uint32_t) keyLen;
+        record->bucketIdx = keyHash % table->bucketsCount;
+
+        const size_t slot    = keyHash & (INCREMENT_MERGE_SLOTS - 1);
+        const size_t prevIdx = slots[slot];
+        const bool repeated  = fastStrcmp(records[prevIdx].key, record->key) == 0;
+        const size_t target  = repeated ? prevIdx : idx + 1;
+
+        record->owner = (uint32_t) target;
+        slots[slot] = (uint16_t) target;
+        unique[uniqueCount] = (uint16_t) (idx + 1);
+        uniqueCount += !repeated;
+    }
+
+    // Long keys are owned by the sentinel
+    for (size_t idx = 1; idx <= count; idx++)
+        records[records[idx].owner].delta += delta;
+
+    return uniqueCount;
+}
+
+hashTableStatus_t hashTableIncrementBatch(hashTable_t *table, const char *const *keys, size_t count,
+                                          hashTableCounter_t delta)
+{
+    assert(table);
+    assert(table->buckets);
+    assert(keys || count == 0);
+
+    _VERIFY(table, HT_ERROR);
+    _ERR_RET(checkCounters(table));
+
+    incrementRecord_t *records = CALLOC(incrementRecord_t, INCREMENT_BATCH + 1);
+    uint16_t          *unique  = CALLOC(uint16_t, INCREMENT_BATCH);
+    if (!records || !unique) {
+        free(records); free(unique);
+        hprintf("Failed to allocate buffers for batch increment\n");
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+    // Short keys are padded with zeros, so sentinel never matches them
+    memset((void *) &records[0].key, 0xFF, sizeof(records[0].key));
+
+    hashTableStatus_t result = HT_SUCCESS;
+    for (size_t batchBegin = 0; batchBegin < count && result == HT_SUCCESS; batchBegin += INCREMENT_BATCH) {
+        const size_t batchSize = (count - batchBegin < INCREMENT_BATCH) ? count - batchBegin : INCREMENT_BATCH;
+        const size_t uniqueCount = mergeIncrementBatch(table, keys + batchBegin, batchSize, delta, records, unique,
+                                                       &result);
+
+        for (size_t pos = 0; pos < uniqueCount && result == HT_SUCCESS; pos++) {
+            // Bucket is prefetched twice as far ahead as its overflow array: pointer to the array is in the bucket
+            if (pos + 2 * BULK_PREFETCH_DISTANCE < uniqueCount) {
+                const size_t aheadIdx = records[unique[pos + 2 * BULK_PREFETCH_DISTANCE]].bucketIdx;
+                _mm_prefetch((const char *) (table->buckets + aheadIdx), _MM_HINT_T0);
+            }
+            if (pos + BULK_PREFETCH_DISTANCE < uniqueCount) {
+                const hashTableBucket_t *ahead = table->buckets + records[unique[pos + BULK_PREFETCH_DISTANCE]].bucketIdx;
+                if (ahead->size > BUCKET_INLINE_NODES)
+                    _mm_prefetch((const char *) ahead->elements, _MM_HINT_T0);
             }
 
-            node++;
+            const incrementRecord_t *record = records + unique[pos];
+            const char *key = (const char *) &record->key;
+            hashTableBucket_t *bucket = table->buckets + record->bucketIdx;
+
+            hashTableNode_t *node = bucketFind(bucket, key, record->keyLen);
+            HT_STAT(statsCountLookup(table, bucket, node);)
+            HT_PROBE4(lookup, record->bucketIdx, bucket->size, record->keyLen, node != NULL);
+            if (!node) {
+                table->size++;
+                result = allocateNode(table, key, record->keyLen, bucket, &node, true);
+                if (result != HT_SUCCESS)
+                    break;
+            }
+            *nodeCounter(node) += record->delta;
         }
+    }
 
+    free(records);
+    free(unique);
+
+    _ERR_RET(result);
+
+    _VERIFY(table, HT_ERROR);
+
+    return HT_SUCCESS;
+}
+
+/// @brief Count work of comparing key with node as bucketFind and hashTableLongKeySearch do it
+static bool probeNode(hashTableProbe_t *probe, hashTableNode_t *node, const char *key, const size_t keyLen,
+                      bool longKeys) {
+    probeTouch(probe, node, sizeof(hashTableNode_t));
+    probe->keysCompared++;
+    (void) keyLen; // key is compared as zero-padded block
+    if (!longKeys)
+        return memcmp(key, &node->key.MM, SMALL_STR_LEN) == 0;
+
+    probeTouch(probe, node->key.Ptr, strlen(node->key.Ptr) + 1);
+    return strcmp(node->key.Ptr, key) == 0;
+}
+
+/// @brief Count work of search in bucket. Short key must be zero-padded aligned block
+static hashTableNode_t *probeBucket(hashTableProbe_t *probe, hashTable_t *table, hashTableBucket_t *bucket,
+                                    const char *key, const size_t keyLen) {
+    const bool longKeys = (bucket == &table->longKeys);
+    probeTouch(probe, bucket, sizeof(hashTableBucket_t));
+
+    size_t inlinedCount = 0;
+    #if BUCKET_INLINE_NODES > 0
+    inlinedCount = (bucket->size < BUCKET_INLINE_NODES) ? bucket->size : BUCKET_INLINE_NODES;
+    for (size_t idx = 0; idx < inlinedCount; idx++)
+        if (probeNode(probe, bucket->inlined + idx, key, keyLen, longKeys))
+            return bucket->inlined + idx;
+    #endif
+    const size_t count = bucket->size - inlinedCount;
+
+    #if BUCKET_SORT_THRESHOLD > 0
+    if (bucketIsSorted(bucket)) {
+        size_t low = 0, high = count;
+        while (low < high) {
+            const size_t mid = low + (high - low) / 2;
+            hashTableNode_t *node = bucket->elements + mid;
+            probeTouch(probe, node, sizeof(hashTableNode_t));
+            if (longKeys)
+                probeTouch(probe, node->key.Ptr, strlen(node->key.Ptr) + 1);
+            probe->keysCompared++;
+            if (sortedNodeCmp(node, key, keyLen, longKeys) < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        // Final comparison with the lower bound
+        return (low < count && probeNode(probe, bucket->elements + low, key, keyLen, longKeys)) ? bucket->elements + low : NULL;
     }
+    #endif
 
+    for (size_t idx = 0; idx < count; idx++)
+        if (probeNode(probe, bucket->elements + idx, key, keyLen, longKeys))
+            return bucket->elements + idx;
 
-    hashTableNode_t *node = table->longKeys.elements;
-    for (size_t idx = 0; idx < table->longKeys.size; idx++) {
-        const size_t keyLen = strlen(node->key.Ptr);
-        if (keyLen < SMALL_STR_LEN) {
-            errprintf("Short key found in buckets with long keys: %zu, %s\n", keyLen, node->key.Ptr);
-            return HT_NO_KEY;
+    return NULL;
+}
+
+hashTableStatus_t hashTableProbeCost(hashTable_t *table, const char *key, hashTableProbe_t *probe)
+{
+    assert(table);
+    assert(key);
+    assert(probe);
+
+    memset(probe, 0, sizeof(*probe));
+
+    size_t keyLen = strlen(key);
+    PACK_LONG_KEY(key, keyLen);
+    hashTableNode_t *found = NULL;
+
+    if (keyLen >= SMALL_STR_LEN) {
+        // Nodes of long keys are in one array, every compared node brings its string
+        found = probeBucket(probe, table, &table->longKeys, key, keyLen);
+    } else {
+        alignas(KEY_ALIGNMENT) char keyCopy[SMALL_STR_LEN] = "";
+        loadShortKey(keyCopy, key, keyLen);
+
+        hashTableBucket_t *bucket = table->buckets + KEY_HASH(table, keyCopy) % table->bucketsCount;
+        found = probeBucket(probe, table, bucket, keyCopy, keyLen);
+    }
+
+    if (found) {
+        probe->found = true;
+        probeTouch(probe, getValueFromNode(table, found), table->valSize);
+    }
+
+    return HT_SUCCESS;
+}
+
+/* ===================================== Memory ================================================= */
+
+/// Values in arena are aligned as calloc aligns them
+static const size_t ARENA_VALUE_ALIGNMENT = alignof(max_align_t);
+
+/// @brief Values are allocated separately instead of being stored in node
+static bool valuesOutsideNodes(const hashTable_t *table) {
+    #ifdef SHORT_VALUES_IN_NODE
+        return table->valSize > SMALL_STR_LEN;
+    #else
+        (void) table;
+        return true;
+    #endif
+}
+
+static void **nodeValuePtr(hashTableNode_t *node) {
+    #ifdef SHORT_VALUES_IN_NODE
+        return &node->value.Ptr;
+    #else
+        return &node->value;
+    #endif
+}
+
+static void *const *nodeValuePtr(const hashTableNode_t *node) {
+    #ifdef SHORT_VALUES_IN_NODE
+        return &node->value.Ptr;
+    #else
+        return &node->value;
+    #endif
+}
+
+static size_t bucketOverflowSize(const hashTableBucket_t *bucket) {
+    return (bucket->size > BUCKET_INLINE_NODES) ? bucket->size - BUCKET_INLINE_NODES : 0;
+}
+
+/// @brief Add used bytes of block to category. Blocks on the heap add their slack and malloc header to overhead,
+/// blocks in arena add to arenaUsed
+static void accountBlock(const hashTable_t *table, void *ptr, size_t used, size_t *category,
+                         hashTableMemory_t *usage, size_t *arenaUsed) {
+    *category += used;
+    if (inArena(table, ptr))
+        *arenaUsed += used;
+    else
+        usage->allocatorOverhead += malloc_usable_size(ptr) - used + MALLOC_CHUNK_HEADER;
+}
+
+static void accountBucket(const hashTable_t *table, const hashTableBucket_t *bucket, bool longKeys,
+                          hashTableMemory_t *usage, size_t *arenaUsed) {
+    if (bucket->elements)
+        accountBlock(table, bucket->elements, bucketOverflowSize(bucket) * sizeof(hashTableNode_t),
+                     &usage->overflowNodes, usage, arenaUsed);
+
+    for (size_t idx = 0; idx < bucket->size; idx++) {
+        const hashTableNode_t *node = bucketGetNode(bucket, idx);
+        if (longKeys && !table->borrowedLongKeys)
+            accountBlock(table, node->key.Ptr, strlen(node->key.Ptr) + 1, &usage->longKeys, usage, arenaUsed);
+        if (valuesOutsideNodes(table))
+            accountBlock(table, *nodeValuePtr(node), table->valSize, &usage->values, usage, arenaUsed);
+    }
+}
+
+hashTableStatus_t hashTableMemoryUsage(const hashTable_t *table, hashTableMemory_t *usage)
+{
+    assert(table);
+    assert(usage);
+
+    memset(usage, 0, sizeof(hashTableMemory_t));
+    size_t arenaUsed = 0;
+
+    usage->buckets = table->bucketsCount * sizeof(hashTableBucket_t);
+    usage->allocatorOverhead += blockOverhead(table->buckets, usage->buckets);
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++)
+        accountBucket(table, table->buckets + bucketIdx, false, usage, &arenaUsed);
+    accountBucket(table, &table->longKeys, true, usage, &arenaUsed);
+
+    #ifdef HOT_KEY_CACHE
+    accountBlock(table, table->hotKeys, HOT_KEY_CACHE_SIZE * sizeof(hotKeyEntry_t), &usage->other, usage, &arenaUsed);
+    #endif
+
+    // Arena is one block: its padding and parts freed by erase and reallocation are overhead
+    if (table->arena)
+        usage->allocatorOverhead += table->arenaSize - arenaUsed + blockOverhead(table->arena, table->arenaSize);
+
+    usage->total = usage->buckets + usage->overflowNodes + usage->longKeys + usage->values +
+                   usage->other   + usage->allocatorOverhead;
+
+    return HT_SUCCESS;
+}
+
+/// @brief Bump allocator over the new arena
+typedef struct {
+    char  *begin;
+    size_t used;
+} arenaCursor_t;
+
+static void *arenaTake(arenaCursor_t *cursor, size_t size, size_t alignment) {
+    cursor->used = alignUp(cursor->used, alignment);
+    void *ptr = cursor->begin + cursor->used;
+    cursor->used += size;
+    return ptr;
+}
+
+/// Parts of arena in order of placement: overflow arrays need the strongest alignment, strings don't need any
+typedef enum {
+    COMPACT_OVERFLOW,
+    COMPACT_VALUES,
+    COMPACT_LONG_KEYS,
+} compactPhase_t;
+
+/// @brief Move overflow array, values or long keys of bucket into arena, freeing old memory.
+/// Without freeOld old memory belongs to another table and is only copied (see hashTableClone)
+static void compactBucket(hashTable_t *table, hashTableBucket_t *bucket, compactPhase_t phase, arenaCursor_t *cursor,
+                          bool freeOld) {
+    if (phase == COMPACT_OVERFLOW) {
+        if (!bucket->elements)
+            return;
+        const size_t overflowBytes = bucketOverflowSize(bucket) * sizeof(hashTableNode_t);
+        hashTableNode_t *elements = (hashTableNode_t *) arenaTake(cursor, overflowBytes, alignof(hashTableNode_t));
+        memcpy(elements, bucket->elements, overflowBytes);
+        if (freeOld)
+            TABLE_FREE(table, bucket->elements);
+        bucket->elements = elements;
+        return;
+    }
+
+    for (size_t idx = 0; idx < bucket->size; idx++) {
+        hashTableNode_t *node = bucketGetNode(bucket, idx);
+
+        if (phase == COMPACT_LONG_KEYS) {
+            const size_t keyBytes = strlen(node->key.Ptr) + 1;
+            char *key = (char *) arenaTake(cursor, keyBytes, 1);
+            memcpy(key, node->key.Ptr, keyBytes);
+            if (freeOld)
+                TABLE_FREE(table, node->key.Ptr);
+            node->key.Ptr = key;
+        } else {
+            void **valuePtr = nodeValuePtr(node);
+            void *value = arenaTake(cursor, table->valSize, ARENA_VALUE_ALIGNMENT);
+            memcpy(value, *valuePtr, table->valSize);
+            if (freeOld)
+                TABLE_FREE(table, *valuePtr);
+            *valuePtr = value;
         }
+    }
+}
 
-        #if defined(CMP_LEN_FIRST)
-            if (keyLen != node->len) {
-                errprintf("Wrong len of key %s\n", (const char *)&node->key.MM);
-                return HT_NO_KEY;
-            }
+/// @brief Bytes of arena that fits all overflow arrays, values and owned long keys of the table
+static size_t arenaSizeFor(const hashTable_t *table) {
+    size_t arenaSize = 0;
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++)
+        arenaSize += bucketOverflowSize(table->buckets + bucketIdx) * sizeof(hashTableNode_t);
+    arenaSize += bucketOverflowSize(&table->longKeys) * sizeof(hashTableNode_t);
+    // Padding before the first value and between values
+    if (valuesOutsideNodes(table))
+        arenaSize += ARENA_VALUE_ALIGNMENT + table->size * alignUp(table->valSize, ARENA_VALUE_ALIGNMENT);
+    for (size_t idx = 0; idx < table->longKeys.size && !table->borrowedLongKeys; idx++)
+        arenaSize += strlen(bucketGetNode(&table->longKeys, idx)->key.Ptr) + 1;
+
+    return alignUp(arenaSize, alignof(hashTableBucket_t));
+}
+
+/// @brief Place everything pointed to by buckets of table into arena of arenaSize bytes, see hashTableCompact
+static hashTableStatus_t fillArena(hashTable_t *table, size_t arenaSize, bool freeOld, arenaCursor_t *cursor)
+{
+    if (arenaSize) {
+        cursor->begin = (char *) blockAlloc(arenaSize, alignof(hashTableBucket_t));
+        if (!cursor->begin) {
+            hprintf("Failed to allocate arena for compaction\n");
+            _ERR_RET(HT_MEMORY_ERROR);
+        }
+    }
+
+    // Overflow arrays are placed in order of buckets, so traversal of the table reads memory sequentially.
+    // Old arena stays valid until everything is copied out of it
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++)
+        compactBucket(table, table->buckets + bucketIdx, COMPACT_OVERFLOW, cursor, freeOld);
+    compactBucket(table, &table->longKeys, COMPACT_OVERFLOW, cursor, freeOld);
+
+    if (valuesOutsideNodes(table)) {
+        for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++)
+            compactBucket(table, table->buckets + bucketIdx, COMPACT_VALUES, cursor, freeOld);
+        compactBucket(table, &table->longKeys, COMPACT_VALUES, cursor, freeOld);
+    }
+
+    if (!table->borrowedLongKeys)
+        compactBucket(table, &table->longKeys, COMPACT_LONG_KEYS, cursor, freeOld);
+    assert(cursor->used <= arenaSize);
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableCompact(hashTable_t *table)
+{
+    assert(table);
+    assert(table->buckets);
+
+    _VERIFY(table, HT_ERROR);
+
+    const size_t arenaSize = arenaSizeFor(table);
+    arenaCursor_t cursor = {};
+    _ERR_RET(fillArena(table, arenaSize, true, &cursor));
+
+    blockFree(table->arena, table->arenaSize);
+    table->arena     = cursor.begin;
+    table->arenaSize = arenaSize;
+
+    #ifdef HOT_KEY_CACHE
+    table->hotKeysEpoch++;
+    #endif
+
+    _VERIFY(table, HT_ERROR);
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableClone(hashTable_t *copy, const hashTable_t *table)
+{
+    assert(copy);
+    assert(table);
+    assert(table->buckets);
+    assert(copy != table);
+
+    // Original is not verified here: incremental verification writes its cursor, and replicas of one table
+    // are cloned concurrently (see hashTableNuma.c)
+    // Buckets are copied as is: inlined nodes are complete, pointers still lead to memory of the original
+    // and are redirected into the arena of the copy by fillArena
+    *copy = *table;
+    copy->arena = NULL;
+    copy->arenaSize = 0;
+    copy->verifyBucket = copy->verifyNode = 0;
+    // Borrowed keys live as long as the original only, so the copy takes its own ones into the arena
+    copy->borrowedLongKeys = false;
+    _ERR_RET(allocateBuckets(copy->bucketsCount, &copy->buckets));
+    memcpy(copy->buckets, table->buckets, table->bucketsCount * sizeof(hashTableBucket_t));
+
+    #ifdef HOT_KEY_CACHE
+    copy->hotKeys = CALLOC(hotKeyEntry_t, HOT_KEY_CACHE_SIZE);
+    if (!copy->hotKeys) {
+        hprintf("Failed to allocate hot key cache\n");
+        blockFree(copy->buckets, copy->bucketsCount * sizeof(hashTableBucket_t));
+        copy->buckets = NULL;
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+    copy->hotKeysEpoch = 1;
+    #endif
+
+    // Counters start from zero, histogram of bucket sizes describes the same buckets
+    HT_STAT(
+    memset(&copy->stats, 0, sizeof(copy->stats));
+    memcpy(copy->stats.bucketSizes, table->stats.bucketSizes, sizeof(copy->stats.bucketSizes));
+    )
+
+    const size_t arenaSize = arenaSizeFor(copy);
+    arenaCursor_t cursor = {};
+    const hashTableStatus_t arenaStatus = fillArena(copy, arenaSize, false, &cursor);
+    if (arenaStatus != HT_SUCCESS) {
+        // Nothing was copied yet: buckets still point to memory of the original
+        blockFree(copy->buckets, copy->bucketsCount * sizeof(hashTableBucket_t));
+        copy->buckets = NULL;
+        #ifdef HOT_KEY_CACHE
+        FREE(copy->hotKeys);
         #endif
+        _ERR_RET(arenaStatus);
+    }
+    copy->arena     = cursor.begin;
+    copy->arenaSize = arenaSize;
+
+    _VERIFY(copy, HT_ERROR);
+
+    return HT_SUCCESS;
+}
+
+#ifdef HASH_TABLE_STATS
+hashTableStatus_t hashTableGetStats(const hashTable_t *table, hashTableStats_t *stats)
+{
+    assert(table);
+    assert(stats);
+
+    memcpy(stats, &table->stats, sizeof(hashTableStats_t));
+    stats->size          = table->size;
+    stats->bucketsCount  = table->bucketsCount;
+    stats->longKeysCount = table->longKeys.size;
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableResetStats(hashTable_t *table)
+{
+    assert(table);
+
+    hashTableStats_t *stats = &table->stats;
+    stats->lookups = stats->hits = stats->misses = stats->nodesCompared = 0;
+    stats->longKeyScans = stats->allocations = stats->reallocs = 0;
+
+    return HT_SUCCESS;
+}
+#endif
+
+/// @brief Key of node with short key as C string: packed key is unpacked into letters
+static const char *shortKeyString(const hashTableNode_t *node, char *letters) {
+    const char *key = (const char *) &node->key.MM;
+    #ifdef PACKED_KEYS
+    if (isPackedKey(key)) {
+        unpackKeyLetters(key, letters);
+        return letters;
+    }
+    #else
+    (void) letters;
+    #endif
+    return key;
+}
+
+/// @brief Check node of bucket with short keys
+static hashTableStatus_t verifyShortKeyNode(hashTable_t *table, size_t bucketIdx, hashTableNode_t *node) {
+    const size_t keyLen = strlen((const char *)&node->key.MM);
+    if (keyLen >= SMALL_STR_LEN) {
+        errprintf("Long key found in buckets with short keys\n");
+        return HT_NO_KEY;
+    }
 
-        if (!getValueFromNode(table, node)) {
-            errprintf("Found node without value in bucket with long keys\n");
-            return HT_NO_VALUE;
+    char letters[SMALL_STR_LEN * 2] = "";
+    const char *key = shortKeyString(node, letters);
+
+    #ifdef PACKED_KEYS
+    if (key == letters) {
+        // Packing the letters again must give the same block: codes are in range and nothing follows them
+        alignas(KEY_ALIGNMENT) char packed[SMALL_STR_LEN];
+        if (!packKeyLetters(letters, strlen(letters), packed) || memcmp(packed, &node->key.MM, SMALL_STR_LEN) != 0) {
+            errprintf("Broken packed key %s in bucket %zu\n", letters, bucketIdx);
+            return HT_NO_KEY;
         }
+    }
+    #endif
+
+    hash_t hash = KEY_HASH(table, &node->key.MM);
+
+    if (hash % table->bucketsCount != bucketIdx) {
+        errprintf("Key %s with hash %ju must be in bucket %ju, but lays in bucket %zu\n",
+                     key,    hash,     hash % table->bucketsCount,     bucketIdx);
+        return HT_WRONG_HASH;
+    }
 
-        if (!node->key.Ptr) {
-            errprintf("Node without key in longKeys array\n");
+    #if defined(CMP_LEN_FIRST)
+        if (shortKeyLen((const char *)&node->key.MM) != node->len) {
+            errprintf("Wrong len of key %s\n", key);
             return HT_NO_KEY;
         }
+    #endif
 
-        node++;
+    if (!getValueFromNode(table, node)) {
+        errprintf("Found node without value in bucket %zu (valSize > 0)\n", bucketIdx);
+        return HT_NO_VALUE;
+    }
+
+    return HT_SUCCESS;
+}
+
+/// @brief Check node of array with long keys
+static hashTableStatus_t verifyLongKeyNode(hashTable_t *table, hashTableNode_t *node) {
+    if (!node->key.Ptr) {
+        errprintf("Node without key in longKeys array\n");
+        return HT_NO_KEY;
+    }
+
+    const size_t keyLen = strlen(node->key.Ptr);
+    if (keyLen < SMALL_STR_LEN) {
+        errprintf("Short key found in buckets with long keys: %zu, %s\n", keyLen, node->key.Ptr);
+        return HT_NO_KEY;
+    }
+
+    #if defined(CMP_LEN_FIRST)
+        if (keyLen != node->len) {
+            errprintf("Wrong len of key %s\n", node->key.Ptr);
+            return HT_NO_KEY;
+        }
+    #endif
+
+    if (!getValueFromNode(table, node)) {
+        errprintf("Found node without value in bucket with long keys\n");
+        return HT_NO_VALUE;
+    }
+
+    return HT_SUCCESS;
+}
+
+/// @brief Check that overflow array of big bucket is sorted
+static hashTableStatus_t verifyBucketOrder(hashTable_t *table, hashTableBucket_t *bucket) {
+    #if BUCKET_SORT_THRESHOLD > 0
+    if (!bucketIsSorted(bucket))
+        return HT_SUCCESS;
+
+    int (*cmp)(const void *, const void *) = (bucket == &table->longKeys) ? longNodeCmp : shortNodeCmp;
+    for (size_t idx = 1; idx < bucket->size - BUCKET_INLINE_NODES; idx++) {
+        if (cmp(bucket->elements + idx - 1, bucket->elements + idx) >= 0) {
+            errprintf("Overflow array of %zu nodes is not sorted at node %zu\n", bucket->size - BUCKET_INLINE_NODES, idx);
+            return HT_ERROR;
+        }
+    }
+    #else
+    (void) table;
+    (void) bucket;
+    #endif
+
+    return HT_SUCCESS;
+}
+
+/// @brief Checks that don't depend on number of elements
+static hashTableStatus_t verifyHeader(hashTable_t *table) {
+    if (!table)
+        return HT_ERROR;
+
+    if (table->bucketsCount == 0) {
+        errprintf("Table is probably not initialized: bucketsCount = 0\n");
+        return HT_NO_INIT;
+    }
+
+    if (!table->buckets) {
+        errprintf("Buckets ptr is null");
+        return HT_MEMORY_ERROR;
     }
 
+    if (table->longKeys.size > table->size) {
+        errprintf("Table of size %zu has %zu long keys\n", table->size, table->longKeys.size);
+        return HT_WRONG_SIZE;
+    }
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableVerify(hashTable_t *table)
+{
+    hashTableStatus_t headerStatus = verifyHeader(table);
+    if (headerStatus != HT_SUCCESS)
+        return headerStatus;
+
+    size_t size = 0;
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        hashTableBucket_t *bucket = &table->buckets[bucketIdx];
+        size += bucket->size;
+
+        for (size_t idx = 0; idx < bucket->size; idx++) {
+            hashTableStatus_t nodeStatus = verifyShortKeyNode(table, bucketIdx, bucketGetNode(bucket, idx));
+            if (nodeStatus != HT_SUCCESS)
+                return nodeStatus;
+        }
+
+        hashTableStatus_t orderStatus = verifyBucketOrder(table, bucket);
+        if (orderStatus != HT_SUCCESS)
+            return orderStatus;
+    }
+
+    for (size_t idx = 0; idx < table->longKeys.size; idx++) {
+        hashTableStatus_t nodeStatus = verifyLongKeyNode(table, bucketGetNode(&table->longKeys, idx));
+        if (nodeStatus != HT_SUCCESS)
+            return nodeStatus;
+    }
+
+    hashTableStatus_t orderStatus = verifyBucketOrder(table, &table->longKeys);
+    if (orderStatus != HT_SUCCESS)
+        return orderStatus;
+
     size += table->longKeys.size;
 
     if (size != table->size) {
@@ -631,9 +2034,95 @@ hashTableStatus_t hashTableVerify(hashTable_t *table)
         return HT_WRONG_SIZE;
     }
 
+    #ifdef HASH_TABLE_STATS
+    uint64_t bucketSizes[HT_STATS_HISTOGRAM_SIZE] = {};
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        const size_t bucketSize = table->buckets[bucketIdx].size;
+        bucketSizes[(bucketSize < HT_STATS_HISTOGRAM_SIZE - 1) ? bucketSize : HT_STATS_HISTOGRAM_SIZE - 1]++;
+    }
+    if (memcmp(bucketSizes, table->stats.bucketSizes, sizeof(bucketSizes)) != 0) {
+        errprintf("Histogram of bucket sizes doesn't match buckets\n");
+        return HT_ERROR;
+    }
+    #endif
+
     return HT_SUCCESS;
 }
 
+hashTableStatus_t hashTableVerifyIncremental(hashTable_t *table, size_t budget)
+{
+    hashTableStatus_t headerStatus = verifyHeader(table);
+    if (headerStatus != HT_SUCCESS)
+        return headerStatus;
+
+    // Cursor is only a hint: table may be rehashed or shrunk between calls
+    size_t bucketIdx = table->verifyBucket, nodeIdx = table->verifyNode;
+    if (bucketIdx > table->bucketsCount)
+        bucketIdx = nodeIdx = 0;
+
+    // Every visited bucket costs at least one unit, so empty buckets don't make the call unbounded
+    while (budget > 0) {
+        const bool longKeys = (bucketIdx == table->bucketsCount);
+        hashTableBucket_t *bucket = longKeys ? &table->longKeys : &table->buckets[bucketIdx];
+
+        if (nodeIdx >= bucket->size) {
+            bucketIdx = longKeys ? 0 : bucketIdx + 1;
+            nodeIdx = 0;
+            budget--;
+            continue;
+        }
+
+        hashTableNode_t *node = bucketGetNode(bucket, nodeIdx);
+        hashTableStatus_t nodeStatus = longKeys ? verifyLongKeyNode(table, node)
+                                                : verifyShortKeyNode(table, bucketIdx, node);
+        if (nodeStatus != HT_SUCCESS) {
+            errprintf("Incremental verification failed at node %zu of bucket %zu\n", nodeIdx, bucketIdx);
+            return nodeStatus;
+        }
+
+        nodeIdx++;
+        budget--;
+    }
+
+    table->verifyBucket = bucketIdx;
+    table->verifyNode   = nodeIdx;
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableVerifySnapshot(hashTable_t *table, pid_t *child)
+{
+    assert(table);
+    assert(child);
+
+    fflush(stderr);
+    const pid_t pid = fork();
+    if (pid < 0) {
+        errprintf("Failed to fork for snapshot verification\n");
+        return HT_ERROR;
+    }
+
+    if (pid == 0) {
+        // Child owns copy-on-write snapshot of the whole address space, so it may use table as its own
+        hashTableStatus_t verifyStatus = hashTableVerify(table);
+        _exit((int) verifyStatus);
+    }
+
+    *child = pid;
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableVerifySnapshotWait(pid_t child)
+{
+    int childStatus = 0;
+    if (waitpid(child, &childStatus, 0) != child || !WIFEXITED(childStatus)) {
+        errprintf("Snapshot verification %d didn't finish\n", child);
+        return HT_ERROR;
+    }
+
+    return (hashTableStatus_t) WEXITSTATUS(childStatus);
+}
+
 hashTableStatus_t hashTableDump(hashTable_t *table)
 {
     if (!table) {
@@ -651,26 +2140,27 @@ hashTableStatus_t hashTableDump(hashTable_t *table)
     errprintf("Buckets[%p]:\n", table->buckets);
     for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
 
-        hashTableNode_t *node = table->buckets[bucketIdx].elements;
-        if (node) errprintf("\t#%zu \n", bucketIdx);
+        hashTableBucket_t *bucket = table->buckets + bucketIdx;
+        if (bucket->size) errprintf("\t#%zu \n", bucketIdx);
 
-        for (size_t elemIdx = 0; elemIdx < table->buckets[bucketIdx].size; elemIdx++) {
+        for (size_t elemIdx = 0; elemIdx < bucket->size; elemIdx++) {
+            hashTableNode_t *node = bucketGetNode(bucket, elemIdx);
             void *value = getValueFromNode(table, node);
-            errprintf("\t\t\"%s\" -> [%p]", (const char *) &node->key.MM, value);
+            char letters[SMALL_STR_LEN * 2] = "";
+            errprintf("\t\t\"%s\" -> [%p]", shortKeyString(node, letters), value);
             HDBG(
                 if (table->printElem ) {
                     table->printElem(value);
                 }
             )
             errprintf("\n");
-            node++;
         }
 
     }
 
     errprintf("LongKeys array[%p]: \n", &table->longKeys);
     for (size_t idx = 0; idx < table->longKeys.size; idx++) {
-        hashTableNode_t *elem = table->longKeys.elements + idx;
+        hashTableNode_t *elem = bucketGetNode(&table->longKeys, idx);
         void *value = getValueFromNode(table, elem);
 
         errprintf("\t\t\"%s\" -> [%p]", elem->key.Ptr, value);
@@ -748,5 +2238,10 @@ hashTableStatus_t hashTableDumpDistribution(hashTable_t *table, const char *file
     return HT_SUCCESS;
 }
 
+#ifdef HT_POLICY
+HT_DEFINE_POLICY()
+#endif
+
+HT_NAMESPACE_END
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,847 @@
+#include <stdlib.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "hashTable.h"
+#include "hashTablePolicy.h"
+
+#include <immintrin.h>
+
+#define FREE(ptr) do {free(ptr); ptr = NULL;} while(0)
+#define CALLOC(type, nmemb) (type *) calloc(nmemb, sizeof(type))
+
+/* ================================================= */
+/* There are three versions of this file             */
+/* They use different structure of hashTable         */
+/* Two of them are deactivated with define           */
+/* Policy builds compile all of them (see Makefile)  */
+/* ================================================= */
+
+#if HASH_TABLE_ARCH == 3
+
+HT_NAMESPACE_BEGIN
+
+/* Bucketized cuckoo hashing: every key has two candidate buckets of CUCKOO_SLOTS slots, chosen by crc32
+   and by keyed AES hash. Lookup reads at most these two buckets (one cache line of keys each, both
+   requested at once) and the stash if it's not empty. Insert evicts keys to their other bucket until
+   a free slot is found, gives up after CUCKOO_MAX_KICKS evictions and puts homeless key to the stash  */
+
+/* ================== Hashing ==================================================== */
+
+static const uint32_t CUCKOO_SEED_1 = 0x9E3779B9;
+
+static inline uint32_t crcBlock(const MMi_t *block, uint32_t seed) {
+    // Words are copied out: reading vector through uint64_t pointer breaks strict aliasing, and -O2 reorders it
+    // with the store of the key into the slot
+    uint64_t crc = seed;
+    for (size_t idx = 0; idx < SMALL_STR_LEN / sizeof(uint64_t); idx++) {
+        uint64_t word = 0;
+        memcpy(&word, (const char *) block + idx * sizeof(uint64_t), sizeof(word));
+        crc = _mm_crc32_u64(crc, word);
+    }
+
+    return (uint32_t) crc;
+}
+
+static uint32_t crcString(const char *str, size_t len, uint32_t seed) {
+    uint64_t crc = seed;
+    size_t pos = 0;
+    for (; pos + sizeof(uint64_t) <= len; pos += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        memcpy(&word, str + pos, sizeof(word));
+        crc = _mm_crc32_u64(crc, word);
+    }
+    for (; pos < len; pos++)
+        crc = _mm_crc32_u8((uint32_t) crc, (uint8_t) str[pos]);
+
+    return (uint32_t) crc;
+}
+
+/*!
+    Second hash is keyed AES, not crc32 with another seed: crc32 is linear, so keys of one length that collide
+    in the first hash would collide in the second one too, and no number of buckets would separate them
+*/
+static inline uint32_t secondHashBlock(const hashTable_t *table, const MMi_t *block) {
+    #ifdef SSE
+    return (uint32_t) aesHash16(block, &table->seed);
+    #else
+    return (uint32_t) aesHash(block, sizeof(MMi_t), &table->seed);
+    #endif
+}
+
+static inline uint32_t secondHashString(const hashTable_t *table, const char *str, size_t len) {
+    return (uint32_t) aesHash(str, len, &table->seed);
+}
+
+/// @brief Searched key, prepared once for both buckets and the stash
+typedef struct {
+    cuckooSlot_t slot;      ///< Key as it's stored in slot (long key without pointer)
+    const char  *str;
+    size_t       len;
+    uint32_t     hash1;
+    uint32_t     hash2;
+} cuckooKey_t;
+
+#ifdef SSE
+    #define _MM_LOAD(ptr) _mm_load_si128(ptr)
+    #define _MM_CMP_MOVEMASK(a, b) _mm_movemask_epi8(_mm_cmpeq_epi8(a,b))
+    static const uint32_t _MM_MASK_CONSTANT = 0xFFFF;
+#elif defined(AVX2)
+    #define _MM_LOAD(ptr) _mm256_load_si256(ptr)
+    #define _MM_CMP_MOVEMASK(a, b) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a,b))
+    static const uint32_t _MM_MASK_CONSTANT = 0xFFFFFFFF;
+#elif defined(AVX512)
+    #define _MM_LOAD(ptr) _mm512_load_si512(ptr)
+    #define _MM_CMP_MOVEMASK(a, b) _mm512_cmpeq_epi16_mask(a,b)
+    static const uint32_t _MM_MASK_CONSTANT = 0xFFFFFFFF;
+#endif
+
+static inline bool slotEquals(MMi_t a, MMi_t b) {
+    return (uint32_t) _MM_CMP_MOVEMASK(a, b) == _MM_MASK_CONSTANT;
+}
+
+static inline bool slotIsEmpty(const cuckooSlot_t *slot) {
+    const cuckooSlot_t empty = {};
+    return slotEquals(slot->MM, empty.MM);
+}
+
+static inline void slotMarkLong(cuckooSlot_t *slot) {
+    ((uint8_t *) slot)[SMALL_STR_LEN - 1] = CUCKOO_LONG_MARK;
+}
+
+static void prepareKey(const hashTable_t *table, const char *key, size_t keyLen, cuckooKey_t *prepared) {
+    memset(&prepared->slot, 0, sizeof(prepared->slot));
+    prepared->str = key;
+    prepared->len = keyLen;
+
+    if (keyLen < SMALL_STR_LEN) {
+        #ifdef ALIGNED_KEYS
+        prepared->slot.MM = _MM_LOAD((const MMi_t *) key);
+        #else
+        memcpy(&prepared->slot.MM, key, keyLen);
+        #endif
+        prepared->hash1 = crcBlock(&prepared->slot.MM, CUCKOO_SEED_1);
+        prepared->hash2 = secondHashBlock(table, &prepared->slot.MM);
+    } else {
+        prepared->hash1 = crcString(key, keyLen, CUCKOO_SEED_1);
+        prepared->hash2 = secondHashString(table, key, keyLen);
+        prepared->slot.longKey.hash = prepared->hash2;
+        slotMarkLong(&prepared->slot);
+    }
+}
+
+/// @brief Hashes of key stored in slot (for evicted keys)
+static void slotHashes(const hashTable_t *table, const cuckooSlot_t *slot, uint32_t *hash1, uint32_t *hash2) {
+    if (cuckooSlotIsLong(slot)) {
+        *hash1 = crcString(slot->longKey.ptr, strlen(slot->longKey.ptr), CUCKOO_SEED_1);
+        *hash2 = slot->longKey.hash;
+    } else {
+        *hash1 = crcBlock(&slot->MM, CUCKOO_SEED_1);
+        *hash2 = secondHashBlock(table, &slot->MM);
+    }
+}
+
+/* ================== Buckets ==================================================== */
+
+static size_t bucketIndex(const hashTable_t *table, uint32_t hash) {
+    // Multiply-shift maps hash onto [0, bucketsCount) without division
+    return ((uint64_t) hash * table->bucketsCount) >> 32;
+}
+
+static inline cuckooBucket_t *bucketAt(const hashTable_t *table, size_t bucketIdx) {
+    return (cuckooBucket_t *) ((char *) table->buckets + bucketIdx * table->bucketStride);
+}
+
+static inline char *bucketValue(const hashTable_t *table, cuckooBucket_t *bucket, size_t slotIdx) {
+    return (char *) bucket + sizeof(cuckooBucket_t) + slotIdx * table->valSize;
+}
+
+/// @brief Slot and its value, both NULL if key is not found
+typedef struct {
+    cuckooSlot_t *slot;
+    char         *value;
+} cuckooEntry_t;
+
+static bool slotMatches(const cuckooSlot_t *slot, const cuckooKey_t *key) {
+    if (key->len < SMALL_STR_LEN)
+        return slotEquals(slot->MM, key->slot.MM);
+
+    return cuckooSlotIsLong(slot) && slot->longKey.hash == key->hash2 && strcmp(slot->longKey.ptr, key->str) == 0;
+}
+
+/// @return Index of slot with key or -1
+static int bucketMatch(const cuckooBucket_t *bucket, const cuckooKey_t *key) {
+    for (int idx = 0; idx < CUCKOO_SLOTS; idx++)
+        if (slotMatches(bucket->slots + idx, key))
+            return idx;
+
+    return -1;
+}
+
+/// @return Index of empty slot or -1
+static int bucketFreeSlot(const cuckooBucket_t *bucket) {
+    for (int idx = 0; idx < CUCKOO_SLOTS; idx++)
+        if (slotIsEmpty(bucket->slots + idx))
+            return idx;
+
+    return -1;
+}
+
+/// @brief Core function of hashTable
+static cuckooEntry_t cuckooSearch(hashTable_t *table, const cuckooKey_t *key) {
+    cuckooEntry_t entry = {NULL, NULL};
+
+    // Empty key would match every empty slot, it's kept in the stash
+    if (key->len > 0) {
+        cuckooBucket_t *first  = bucketAt(table, bucketIndex(table, key->hash1));
+        cuckooBucket_t *second = bucketAt(table, bucketIndex(table, key->hash2));
+        // Both lines are requested at once: second one arrives while the first is searched
+        _mm_prefetch((const char *) second, _MM_HINT_T0);
+
+        int slotIdx = bucketMatch(first, key);
+        if (slotIdx >= 0)
+            return {first->slots + slotIdx, bucketValue(table, first, (size_t) slotIdx)};
+
+        slotIdx = bucketMatch(second, key);
+        if (slotIdx >= 0)
+            return {second->slots + slotIdx, bucketValue(table, second, (size_t) slotIdx)};
+    }
+
+    for (size_t idx = 0; idx < table->stashSize; idx++)
+        if (slotMatches(table->stash + idx, key))
+            return {table->stash + idx, table->stashValues + idx * table->valSize};
+
+    return entry;
+}
+
+/* ================== Allocators ==================================================== */
+
+static uint64_t kickRandom(hashTable_t *table) {
+    // xorshift64*
+    table->kickState ^= table->kickState >> 12;
+    table->kickState ^= table->kickState << 25;
+    table->kickState ^= table->kickState >> 27;
+    return table->kickState * 0x2545F4914F6CDD1Dull;
+}
+
+static void swapBytes(char *lhs, char *rhs, size_t size) {
+    for (size_t idx = 0; idx < size; idx++) {
+        const char tmp = lhs[idx];
+        lhs[idx] = rhs[idx];
+        rhs[idx] = tmp;
+    }
+}
+
+// expects bucketsCount and bucketStride to be set already
+static hashTableStatus_t allocateBuckets(hashTable_t *table)
+{
+    assert(table);
+    assert(table->bucketsCount > 0);
+
+    const size_t bucketsBytes = table->bucketsCount * table->bucketStride;
+    cuckooBucket_t *buckets = (cuckooBucket_t *) aligned_alloc(CACHE_LINE_SIZE, bucketsBytes);
+    char *stashValues = CALLOC(char, CUCKOO_STASH_SIZE * table->valSize + 1);
+    if (!buckets || !stashValues) {
+        free(buckets);
+        free(stashValues);
+        hprintf("Failed to allocate buckets array\n");
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+    memset((void *) buckets, 0, bucketsBytes);
+
+    table->buckets     = buckets;
+    table->stashValues = stashValues;
+    table->stashSize   = 0;
+
+    return HT_SUCCESS;
+}
+
+static void deallocateBuckets(hashTable_t *table) {
+    FREE(table->buckets);
+    FREE(table->stashValues);
+}
+
+static void deallocateLongKeys(hashTable_t *table) {
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        cuckooBucket_t *bucket = bucketAt(table, bucketIdx);
+        for (size_t slotIdx = 0; slotIdx < CUCKOO_SLOTS; slotIdx++)
+            if (cuckooSlotIsLong(bucket->slots + slotIdx))
+                FREE(bucket->slots[slotIdx].longKey.ptr);
+    }
+
+    for (size_t idx = 0; idx < table->stashSize; idx++)
+        if (cuckooSlotIsLong(table->stash + idx))
+            FREE(table->stash[idx].longKey.ptr);
+}
+
+/*!
+    @brief Put carried key with its value into one of its buckets, evicting keys to their other buckets
+    @return false if neither evictions nor the stash helped: evictions are undone, so the table and carry
+    are as they were, caller grows the table and places the key there
+*/
+static bool cuckooPlace(hashTable_t *table, cuckooSlot_t *carry, char *carryValue) {
+    // Slots that took the carried key, in order of evictions
+    cuckooEntry_t evictions[CUCKOO_MAX_KICKS];
+    size_t evictionsCount = 0;
+
+    if (!slotIsEmpty(carry)) {
+        uint32_t hash1 = 0, hash2 = 0;
+        slotHashes(table, carry, &hash1, &hash2);
+        const size_t candidates[2] = {bucketIndex(table, hash1), bucketIndex(table, hash2)};
+
+        size_t bucketIdx = candidates[0];
+        for (size_t kick = 0; kick <= CUCKOO_MAX_KICKS; kick++) {
+            if (kick == 0 && bucketFreeSlot(bucketAt(table, bucketIdx)) < 0)
+                bucketIdx = candidates[1];
+
+            cuckooBucket_t *bucket = bucketAt(table, bucketIdx);
+            const int freeSlot = bucketFreeSlot(bucket);
+            if (freeSlot >= 0) {
+                bucket->slots[freeSlot] = *carry;
+                memcpy(bucketValue(table, bucket, (size_t) freeSlot), carryValue, table->valSize);
+                return true;
+            }
+            if (kick == CUCKOO_MAX_KICKS)
+                break;
+
+            // Random victim: walks of different inserts don't run into the same cycle
+            const size_t victim = kickRandom(table) % CUCKOO_SLOTS;
+            const cuckooSlot_t evicted = bucket->slots[victim];
+            bucket->slots[victim] = *carry;
+            *carry = evicted;
+            swapBytes(bucketValue(table, bucket, victim), carryValue, table->valSize);
+            evictions[evictionsCount++] = {bucket->slots + victim, bucketValue(table, bucket, victim)};
+
+            // Evicted key moves to its other bucket
+            slotHashes(table, carry, &hash1, &hash2);
+            const size_t first = bucketIndex(table, hash1);
+            bucketIdx = (bucketIdx == first) ? bucketIndex(table, hash2) : first;
+        }
+    }
+
+    if (table->stashSize == CUCKOO_STASH_SIZE) {
+        // Every eviction is a swap with carry: swapping back in reverse order returns the key carried first
+        while (evictionsCount > 0) {
+            const cuckooEntry_t *eviction = evictions + --evictionsCount;
+            const cuckooSlot_t evicted = *eviction->slot;
+            *eviction->slot = *carry;
+            *carry = evicted;
+            swapBytes(eviction->value, carryValue, table->valSize);
+        }
+        return false;
+    }
+
+    table->stash[table->stashSize] = *carry;
+    memcpy(table->stashValues + table->stashSize * table->valSize, carryValue, table->valSize);
+    table->stashSize++;
+
+    return true;
+}
+
+/*!
+    @brief Place all keys of table into newBucketsCount buckets (or up to CUCKOO_MAX_REHASH_GROWTH times
+    twice more, if they don't fit). Table is not changed on failure
+    @param newKey Key to place along with keys of the table (may be NULL), it belongs to the table on success
+*/
+static hashTableStatus_t rehash(hashTable_t *table, size_t newBucketsCount, const cuckooSlot_t *newKey,
+                                const char *newValue)
+{
+    assert(table);
+    assert(newBucketsCount > 0);
+
+    char *carryValue = CALLOC(char, table->valSize + 1);
+    if (!carryValue) {
+        hprintf("Failed to allocate buffer for rehash\n");
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+
+    // Keys are copied, so the old table stays intact until the new one is complete
+    hashTable_t grown = *table;
+    for (size_t growth = 0; ; growth++) {
+        grown.bucketsCount = newBucketsCount;
+        const hashTableStatus_t allocStatus = allocateBuckets(&grown);
+        if (allocStatus != HT_SUCCESS) {
+            free(carryValue);
+            _ERR_RET(allocStatus);
+        }
+
+        bool placed = true;
+        for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount && placed; bucketIdx++) {
+            cuckooBucket_t *bucket = bucketAt(table, bucketIdx);
+            for (size_t slotIdx = 0; slotIdx < CUCKOO_SLOTS && placed; slotIdx++) {
+                if (slotIsEmpty(bucket->slots + slotIdx))
+                    continue;
+                cuckooSlot_t carry = bucket->slots[slotIdx];
+                memcpy(carryValue, bucketValue(table, bucket, slotIdx), table->valSize);
+                placed = cuckooPlace(&grown, &carry, carryValue);
+            }
+        }
+        for (size_t idx = 0; idx < table->stashSize && placed; idx++) {
+            cuckooSlot_t carry = table->stash[idx];
+            memcpy(carryValue, table->stashValues + idx * table->valSize, table->valSize);
+            placed = cuckooPlace(&grown, &carry, carryValue);
+        }
+        if (newKey && placed) {
+            cuckooSlot_t carry = *newKey;
+            memcpy(carryValue, newValue, table->valSize);
+            placed = cuckooPlace(&grown, &carry, carryValue);
+        }
+
+        if (placed)
+            break;
+
+        deallocateBuckets(&grown);
+        if (growth == CUCKOO_MAX_REHASH_GROWTH) {
+            free(carryValue);
+            hprintf("Keys don't fit into %zu buckets\n", newBucketsCount);
+            _ERR_RET(HT_WRONG_HASH);
+        }
+        newBucketsCount *= 2;
+    }
+
+    free(carryValue);
+    deallocateBuckets(table);
+    *table = grown;
+
+    return HT_SUCCESS;
+}
+
+/// @brief Insert key that is not in the table with zeroed value
+static hashTableStatus_t cuckooInsert(hashTable_t *table, const cuckooKey_t *key, cuckooEntry_t *entry)
+{
+    if ((table->size + 1) * 100 > table->bucketsCount * CUCKOO_SLOTS * CUCKOO_MAX_LOAD_PERCENT)
+        _ERR_RET(rehash(table, table->bucketsCount * 2, NULL, NULL));
+
+    cuckooSlot_t carry = key->slot;
+    if (key->len >= SMALL_STR_LEN) {
+        carry.longKey.ptr = CALLOC(char, key->len + 1);
+        if (!carry.longKey.ptr) {
+            hprintf("Failed to allocate memory for key\n");
+            _ERR_RET(HT_MEMORY_ERROR);
+        }
+        memcpy(carry.longKey.ptr, key->str, key->len);
+    }
+    memset(table->carryValue, 0, table->valSize);
+
+    // Failed walk is undone: the new key is still in carry and the table holds the keys it held before
+    if (!cuckooPlace(table, &carry, table->carryValue)) {
+        const hashTableStatus_t rehashStatus = rehash(table, table->bucketsCount * 2, &carry, table->carryValue);
+        if (rehashStatus != HT_SUCCESS) {
+            if (cuckooSlotIsLong(&carry))
+                free(carry.longKey.ptr);
+            _ERR_RET(rehashStatus);
+        }
+    }
+    table->size++;
+
+    // Evictions may have moved the new key from the slot it was put in first
+    *entry = cuckooSearch(table, key);
+    assert(entry->slot);
+
+    return HT_SUCCESS;
+}
+
+/* ===================================== Constructor and destructor ========================================== */
+
+hashTableStatus_t hashTableCtor(hashTable_t *table, size_t valueSize, size_t bucketsCount)
+{
+    assert(table);
+    assert(bucketsCount > 0);
+
+    table->bucketsCount = bucketsCount;
+    table->valSize = valueSize;
+    // Values follow keys of their bucket: found key and its value are in adjacent lines
+    table->bucketStride = (sizeof(cuckooBucket_t) + CUCKOO_SLOTS * valueSize + CACHE_LINE_SIZE - 1)
+                          / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+    _ERR_RET(allocateBuckets(table));
+
+    table->carryValue = CALLOC(char, valueSize + 1);
+    if (!table->carryValue) {
+        hprintf("Failed to allocate buffer for insert\n");
+        deallocateBuckets(table);
+        _ERR_RET(HT_MEMORY_ERROR);
+    }
+
+    table->size = 0;
+    table->kickState = 0x2545F4914F6CDD1Dull;
+    hashSeedInit(&table->seed);
+
+    _VERIFY(table, HT_ERROR);
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableDtor(hashTable_t *table)
+{
+    assert(table);
+
+    _VERIFY(table, HT_ERROR);
+
+    deallocateLongKeys(table);
+    deallocateBuckets(table);
+    FREE(table->carryValue);
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableReserve(hashTable_t *table, size_t expectedKeys)
+{
+    assert(table);
+    assert(table->buckets);
+
+    _VERIFY(table, HT_ERROR);
+
+    const size_t neededBuckets = expectedKeys * 100 / (CUCKOO_MAX_LOAD_PERCENT * CUCKOO_SLOTS) + 1;
+    if (neededBuckets <= table->bucketsCount)
+        return HT_SUCCESS;
+
+    _ERR_RET(rehash(table, neededBuckets, NULL, NULL));
+
+    _VERIFY(table, HT_ERROR);
+
+    return HT_SUCCESS;
+}
+
+/* ===================================== Hash table functions ================================ */
+
+hashTableStatus_t hashTableInsert(hashTable_t *table, const char *key, const void *value)
+{
+    assert(table);
+    assert(key);
+    assert(table->valSize==0 || value);
+
+    _VERIFY(table, HT_ERROR);
+
+    cuckooKey_t prepared = {};
+    prepareKey(table, key, strlen(key), &prepared);
+
+    cuckooEntry_t entry = cuckooSearch(table, &prepared);
+    if (!entry.slot)
+        _ERR_RET(cuckooInsert(table, &prepared, &entry));
+
+    memcpy(entry.value, value, table->valSize);
+
+    return HT_SUCCESS;
+}
+
+void *hashTableAccess(hashTable_t *table, const char *key)
+{
+    assert(table);
+    assert(key);
+
+    _VERIFY(table, NULL);
+
+    cuckooKey_t prepared = {};
+    prepareKey(table, key, strlen(key), &prepared);
+
+    cuckooEntry_t entry = cuckooSearch(table, &prepared);
+    if (!entry.slot)
+        _ERR_RET_PTR(cuckooInsert(table, &prepared, &entry));
+
+    return entry.value;
+}
+
+void *hashTableFind(hashTable_t *table, const char *key)
+{
+    assert(table);
+    assert(key);
+    assert(table->buckets);
+
+    _VERIFY(table, NULL);
+
+    cuckooKey_t prepared = {};
+    prepareKey(table, key, strlen(key), &prepared);
+
+    return cuckooSearch(table, &prepared).value;
+}
+
+hashTableStatus_t hashTableErase(hashTable_t *table, const char *key)
+{
+    assert(table);
+    assert(key);
+    assert(table->buckets);
+
+    _VERIFY(table, HT_ERROR);
+
+    cuckooKey_t prepared = {};
+    prepareKey(table, key, strlen(key), &prepared);
+
+    cuckooEntry_t entry = cuckooSearch(table, &prepared);
+    if (!entry.slot)
+        return HT_NO_KEY;
+
+    if (cuckooSlotIsLong(entry.slot))
+        free(entry.slot->longKey.ptr);
+
+    const bool inStash = entry.slot >= table->stash && entry.slot < table->stash + CUCKOO_STASH_SIZE;
+    if (inStash) {
+        // Last entry of the stash takes place of erased one
+        const size_t last = --table->stashSize;
+        *entry.slot = table->stash[last];
+        memcpy(entry.value, table->stashValues + last * table->valSize, table->valSize);
+        memset(&table->stash[last], 0, sizeof(cuckooSlot_t));
+    } else {
+        memset(entry.slot, 0, sizeof(cuckooSlot_t));
+        memset(entry.value, 0, table->valSize);
+    }
+    table->size--;
+
+    _VERIFY(table, HT_ERROR);
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableBulkAccess(hashTable_t *table, const char *const *keys, size_t count, void **values)
+{
+    assert(table);
+    assert(keys);
+    assert(values);
+
+    // Every key touches at most two lines known from its hash, there's no order better than given one
+    for (size_t idx = 0; idx < count; idx++) {
+        values[idx] = hashTableAccess(table, keys[idx]);
+        if (!values[idx])
+            _ERR_RET(HT_MEMORY_ERROR);
+    }
+
+    return HT_SUCCESS;
+}
+
+/// @brief Count work of search in one slot as cuckooSearch does it
+static bool probeSlot(hashTableProbe_t *probe, const cuckooSlot_t *slot, const cuckooKey_t *key) {
+    probeTouch(probe, slot, sizeof(cuckooSlot_t));
+    probe->keysCompared++;
+
+    if (key->len >= SMALL_STR_LEN && cuckooSlotIsLong(slot) && slot->longKey.hash == key->hash2)
+        probeTouch(probe, slot->longKey.ptr, strlen(slot->longKey.ptr) + 1);
+
+    return slotMatches(slot, key);
+}
+
+hashTableStatus_t hashTableProbeCost(hashTable_t *table, const char *key, hashTableProbe_t *probe)
+{
+    assert(table);
+    assert(key);
+    assert(probe);
+
+    memset(probe, 0, sizeof(*probe));
+
+    cuckooKey_t prepared = {};
+    prepareKey(table, key, strlen(key), &prepared);
+
+    if (prepared.len > 0) {
+        const size_t candidates[2] = {bucketIndex(table, prepared.hash1), bucketIndex(table, prepared.hash2)};
+        for (size_t candidate = 0; candidate < 2; candidate++) {
+            cuckooBucket_t *bucket = bucketAt(table, candidates[candidate]);
+            for (size_t slotIdx = 0; slotIdx < CUCKOO_SLOTS; slotIdx++) {
+                if (probeSlot(probe, bucket->slots + slotIdx, &prepared)) {
+                    probe->found = true;
+                    probeTouch(probe, bucketValue(table, bucket, slotIdx), table->valSize);
+                    return HT_SUCCESS;
+                }
+            }
+        }
+    }
+
+    for (size_t idx = 0; idx < table->stashSize; idx++) {
+        if (probeSlot(probe, table->stash + idx, &prepared)) {
+            probe->found = true;
+            probeTouch(probe, table->stashValues + idx * table->valSize, table->valSize);
+            return HT_SUCCESS;
+        }
+    }
+
+    return HT_SUCCESS;
+}
+
+/// @brief Check key in slot. bucketIdx is SIZE_MAX for the stash
+static hashTableStatus_t verifySlot(hashTable_t *table, const cuckooSlot_t *slot, size_t bucketIdx) {
+    if (cuckooSlotIsLong(slot)) {
+        if (!slot->longKey.ptr || strlen(slot->longKey.ptr) < SMALL_STR_LEN) {
+            errprintf("Long key in bucket %zu is missing or too short\n", bucketIdx);
+            return HT_NO_KEY;
+        }
+    } else if (((const char *) &slot->MM)[SMALL_STR_LEN - 1] != '\0') {
+        errprintf("Short key in bucket %zu is not terminated\n", bucketIdx);
+        return HT_NO_KEY;
+    }
+
+    uint32_t hash1 = 0, hash2 = 0;
+    slotHashes(table, slot, &hash1, &hash2);
+    if (cuckooSlotIsLong(slot) && hash2 != secondHashString(table, slot->longKey.ptr, strlen(slot->longKey.ptr))) {
+        errprintf("Stored hash of long key %s is wrong\n", slot->longKey.ptr);
+        return HT_WRONG_HASH;
+    }
+
+    if (bucketIdx != SIZE_MAX && bucketIdx != bucketIndex(table, hash1) && bucketIdx != bucketIndex(table, hash2)) {
+        errprintf("Key with hashes %u, %u must be in bucket %zu or %zu, but lays in bucket %zu\n", hash1, hash2,
+                  bucketIndex(table, hash1), bucketIndex(table, hash2), bucketIdx);
+        return HT_WRONG_HASH;
+    }
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableVerify(hashTable_t *table)
+{
+    if (!table)
+        return HT_ERROR;
+
+    if (table->bucketsCount == 0) {
+        errprintf("Table is probably not initialized: bucketsCount = 0\n");
+        return HT_NO_INIT;
+    }
+
+    if (!table->buckets || !table->stashValues || !table->carryValue) {
+        errprintf("Buckets ptr is null");
+        return HT_MEMORY_ERROR;
+    }
+
+    if (table->stashSize > CUCKOO_STASH_SIZE) {
+        errprintf("Stash size %zu exceeds its capacity %d\n", table->stashSize, CUCKOO_STASH_SIZE);
+        return HT_WRONG_SIZE;
+    }
+
+    size_t size = table->stashSize;
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        cuckooBucket_t *bucket = bucketAt(table, bucketIdx);
+        for (size_t slotIdx = 0; slotIdx < CUCKOO_SLOTS; slotIdx++) {
+            if (slotIsEmpty(bucket->slots + slotIdx))
+                continue;
+            size++;
+            const hashTableStatus_t slotStatus = verifySlot(table, bucket->slots + slotIdx, bucketIdx);
+            if (slotStatus != HT_SUCCESS)
+                return slotStatus;
+        }
+    }
+
+    for (size_t idx = 0; idx < table->stashSize; idx++) {
+        const hashTableStatus_t slotStatus = verifySlot(table, table->stash + idx, SIZE_MAX);
+        if (slotStatus != HT_SUCCESS)
+            return slotStatus;
+    }
+
+    if (size != table->size) {
+        errprintf("Expected size to be %zu, but found only %zu elements\n", table->size, size);
+        return HT_WRONG_SIZE;
+    }
+
+    return HT_SUCCESS;
+}
+
+static void dumpSlot(hashTable_t *table, const cuckooSlot_t *slot, const char *value) {
+    errprintf("\t\t\"%s\" -> [%p]", cuckooSlotIsLong(slot) ? slot->longKey.ptr : (const char *) &slot->MM, value);
+    HDBG(
+        if (table->printElem)
+            table->printElem(value);
+    )
+    (void) table;
+    errprintf("\n");
+}
+
+hashTableStatus_t hashTableDump(hashTable_t *table)
+{
+    if (!table) {
+        errprintf("Null pointer passed");
+        return HT_ERROR;
+    }
+
+    errprintf("hashTable_t[%p] dump:\n"
+              "\tbucketsCount %zu\n"
+              "\tbucketStride %zu\n"
+              "\tvalSize      %zu\n"
+              "\tsize         %zu\n"
+              "\tstashSize    %zu\n",
+              table, table->bucketsCount, table->bucketStride, table->valSize, table->size, table->stashSize);
+
+    errprintf("Buckets[%p]:\n", table->buckets);
+    for (size_t bucketIdx = 0; bucketIdx < table->bucketsCount; bucketIdx++) {
+        cuckooBucket_t *bucket = bucketAt(table, bucketIdx);
+        if (bucketFreeSlot(bucket) == 0 && slotIsEmpty(bucket->slots + CUCKOO_SLOTS - 1))
+            continue;
+
+        errprintf("\t#%zu \n", bucketIdx);
+        for (size_t slotIdx = 0; slotIdx < CUCKOO_SLOTS; slotIdx++)
+            if (!slotIsEmpty(bucket->slots + slotIdx))
+                dumpSlot(table, bucket->slots + slotIdx, bucketValue(table, bucket, slotIdx));
+    }
+
+    errprintf("Stash:\n");
+    for (size_t idx = 0; idx < table->stashSize; idx++)
+        dumpSlot(table, table->stash + idx, table->stashValues + idx * table->valSize);
+
+    return HT_SUCCESS;
+}
+
+static size_t bucketUsedSlots(const cuckooBucket_t *bucket) {
+    size_t used = 0;
+    for (size_t slotIdx = 0; slotIdx < CUCKOO_SLOTS; slotIdx++)
+        used += !slotIsEmpty(bucket->slots + slotIdx);
+
+    return used;
+}
+
+hashTableStatus_t hashTableCalcDistribution(hashTable_t *table)
+{
+    assert(table);
+    assert(table->bucketsCount > 0);
+    assert(table->buckets);
+
+    // Buckets can't overflow, so histogram of fill is more telling than the chart of v1 and v2
+    int64_t filled[CUCKOO_SLOTS + 1] = {0};
+    int64_t sumOfSquares = 0, sum = 0;
+    for (size_t idx = 0; idx < table->bucketsCount; idx++) {
+        const int64_t used = (int64_t) bucketUsedSlots(bucketAt(table, idx));
+        filled[used]++;
+        sumOfSquares += used * used;
+        sum          += used;
+    }
+
+    const double mean = (double) sum / (double) table->bucketsCount;
+    const double disp = sqrt((double) sumOfSquares / (double) table->bucketsCount - mean * mean);
+
+    fprintf(stderr, "Average elements in bucket: %.2f of %d (%.1f%% of slots)\n"
+                    "Dispersion: %.2f\n"
+                    "In stash: %zu\n", mean, CUCKOO_SLOTS, mean * 100 / CUCKOO_SLOTS, disp, table->stashSize);
+
+    const int BAR_LENGTH = 40;
+    fprintf(stderr, "=========== Buckets by used slots ==========\n");
+    for (size_t used = 0; used <= CUCKOO_SLOTS; used++) {
+        int64_t filledChars = BAR_LENGTH * filled[used] / (int64_t) table->bucketsCount;
+        fprintf(stderr, "%zu |", used);
+        while((filledChars--) > 0) fputc('#', stderr);
+        fputc('\n', stderr);
+    }
+    fprintf(stderr, "============================================\n");
+
+    return HT_SUCCESS;
+}
+
+hashTableStatus_t hashTableDumpDistribution(hashTable_t *table, const char *fileName) {
+    assert(table);
+    assert(fileName);
+
+    FILE *out = fopen(fileName, "w");
+    if (!out) {
+        errprintf("Failed to open file %s\n", fileName);
+        _ERR_RET(HT_ERROR);
+    }
+
+    for (size_t idx = 0; idx < table->bucketsCount; idx++)
+        fprintf(out, "%zu\n", bucketUsedSlots(bucketAt(table, idx)));
+
+    fclose(out);
+
+    return HT_SUCCESS;
+}
+
+#ifdef HT_POLICY
+HT_DEFINE_POLICY()
+#endif
+
+HT_NAMESPACE_END
+
+#endif
@@ -0,0 +1,82 @@
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <immintrin.h>
+
+#include "hyperLogLog.h"
+
+void hllInit(hyperLogLog_t *hll) {
+    assert(hll);
+    memset(hll->registers, 0, sizeof(hll->registers));
+}
+
+void hllAddHash(hyperLogLog_t *hll, uint64_t hash) {
+    const uint64_t regIdx = hash >> (64 - HLL_PRECISION);
+    // Low bits are set so that rank is bounded even for zero remainder
+    const uint64_t remainder = (hash << HLL_PRECISION) | ((1ull << HLL_PRECISION) - 1);
+    const uint8_t rank = (uint8_t) (__builtin_clzll(remainder) + 1);
+
+    if (rank > hll->registers[regIdx])
+        hll->registers[regIdx] = rank;
+}
+
+// Finalizer of murmur3: spreads 32 bits of crc32 over whole 64-bit word
+static uint64_t mix64(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint64_t hllHashString(const char *str) {
+    assert(str);
+
+    size_t len = strlen(str);
+    uint64_t crc = 0xFFFFFFFF;
+
+    while (len >= sizeof(uint64_t)) {
+        uint64_t chunk = 0;
+        memcpy(&chunk, str, sizeof(chunk));
+        crc = _mm_crc32_u64(crc, chunk);
+        str += sizeof(uint64_t);
+        len -= sizeof(uint64_t);
+    }
+    while (len--)
+        crc = _mm_crc32_u8((uint32_t) crc, (uint8_t) *str++);
+
+    return mix64(crc);
+}
+
+double hllEstimate(const hyperLogLog_t *hll) {
+    assert(hll);
+
+    const double registers = (double) HLL_REGISTERS;
+    const double alpha = 0.7213 / (1 + 1.079 / registers);
+
+    double sum = 0;
+    int zeroRegisters = 0;
+    for (int idx = 0; idx < HLL_REGISTERS; idx++) {
+        sum += ldexp(1.0, -hll->registers[idx]);
+        zeroRegisters += (hll->registers[idx] == 0);
+    }
+
+    double estimate = alpha * registers * registers / sum;
+
+    // Small cardinalities: linear counting is more precise
+    if (estimate <= 2.5 * registers && zeroRegisters > 0)
+        estimate = registers * log(registers / zeroRegisters);
+
+    return estimate;
+}
+
+int64_t textEstimateUniqueWords(text_t text) {
+    hyperLogLog_t hll;
+    hllInit(&hll);
+
+    for (int64_t idx = 0; idx < text.wordsCount; idx++)
+        hllAddHash(&hll, hllHashString(text.words[idx]));
+
+    return (int64_t) llround(hllEstimate(&hll));
+}
@@ -11,8 +11,76 @@
 
 int main(int argc, const char *argv[]) {
     bool printLess = (argc > 1) && (strcmp(argv[1], "-s") == 0);
+    bool loadFactors = (argc > 1) && (strcmp(argv[1], "-l") == 0);
+    bool typedApi    = (argc > 1) && (strcmp(argv[1], "-t") == 0);
+    bool policies    = (argc > 1) && (strcmp(argv[1], "-p") == 0);
+    bool reserve     = (argc > 1) && (strcmp(argv[1], "-r") == 0);
+    bool bulkInsert  = (argc > 1) && (strcmp(argv[1], "-b") == 0);
+    bool skewed      = (argc > 1) && (strcmp(argv[1], "-z") == 0);
+    bool workload    = (argc > 1) && (strcmp(argv[1], "-w") == 0);
+    bool harness     = (argc > 1) && (strcmp(argv[1], "-H") == 0);
+    bool latency     = (argc > 1) && (strcmp(argv[1], "-L") == 0);
+    bool verify      = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+    bool memory      = (argc > 1) && (strcmp(argv[1], "-m") == 0);
+    bool hugePages   = (argc > 1) && (strcmp(argv[1], "-g") == 0);
+    bool numa        = (argc > 1) && (strcmp(argv[1], "-n") == 0);
+    bool probeCost   = (argc > 1) && (strcmp(argv[1], "-c") == 0);
+    bool collisions  = (argc > 1) && (strcmp(argv[1], "-k") == 0);
+    bool interning   = (argc > 1) && (strcmp(argv[1], "-i") == 0);
+    bool intKeys     = (argc > 1) && (strcmp(argv[1], "-u") == 0);
+    bool increment   = (argc > 1) && (strcmp(argv[1], "-e") == 0);
+    bool emplace     = (argc > 1) && (strcmp(argv[1], "-a") == 0);
+    bool keySet      = (argc > 1) && (strcmp(argv[1], "-o") == 0);
+    bool packedKeys  = (argc > 1) && (strcmp(argv[1], "-q") == 0);
+    bool seededHash  = (argc > 1) && (strcmp(argv[1], "-d") == 0);
 
-    testPerformance("testStrings.txt", "testRequests.txt", printLess);
+    if (harness)
+        return testHarness(argc - 2, argv + 2);
+
+    if (loadFactors)
+        testLoadFactors("testStrings.txt", "testRequests.txt");
+    else if (typedApi)
+        testTypedFrontend("testStrings.txt", "testRequests.txt");
+    else if (policies)
+        testPolicies("testStrings.txt", "testRequests.txt");
+    else if (reserve)
+        testReserve("testStrings.txt");
+    else if (bulkInsert)
+        testBulkInsert(BULK_TEST_WORDS);
+    else if (skewed)
+        testSkewedTraffic();
+    else if (workload)
+        testWorkload("testStrings.txt", "testWorkload.txt");
+    else if (latency)
+        testLatency("testStrings.txt", "testRequests.txt");
+    else if (verify)
+        testVerifyBudgets("testStrings.txt", "testRequests.txt");
+    else if (memory)
+        testMemoryUsage();
+    else if (hugePages)
+        testHugePages();
+    else if (numa)
+        testNumaReplicas();
+    else if (probeCost)
+        testProbeCost();
+    else if (collisions)
+        testCollisions();
+    else if (interning)
+        testInterning("testStrings.txt");
+    else if (intKeys)
+        testIntKeys();
+    else if (increment)
+        testIncrement();
+    else if (emplace)
+        testEmplace();
+    else if (keySet)
+        testSet("testStrings.txt", "testRequests.txt");
+    else if (packedKeys)
+        testPackedKeys();
+    else if (seededHash)
+        testSeededHash();
+    else
+        testPerformance("testStrings.txt", "testRequests.txt", printLess);
 
     return 0;
 }
@@ -0,0 +1,161 @@
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfCounters.h"
+
+static const char *PERF_COUNTER_NAMES[PERF_COUNTERS_COUNT] = {
+    "cycles", "instructions", "L1d-misses", "LLC-misses", "branch-misses", "dTLB-misses"
+};
+
+/// Config of generic hardware cache event: read misses of cache
+static uint64_t cacheReadMisses(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static void perfCounterAttr(perfCounter_t counter, struct perf_event_attr *attr) {
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    attr->type = PERF_TYPE_HARDWARE;
+    switch (counter) {
+        case PERF_CYCLES:        attr->config = PERF_COUNT_HW_CPU_CYCLES;       break;
+        case PERF_INSTRUCTIONS:  attr->config = PERF_COUNT_HW_INSTRUCTIONS;     break;
+        case PERF_BRANCH_MISSES: attr->config = PERF_COUNT_HW_BRANCH_MISSES;    break;
+        case PERF_L1D_MISSES:
+            attr->type   = PERF_TYPE_HW_CACHE;
+            attr->config = cacheReadMisses(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case PERF_LLC_MISSES:
+            attr->type   = PERF_TYPE_HW_CACHE;
+            attr->config = cacheReadMisses(PERF_COUNT_HW_CACHE_LL);
+            break;
+        case PERF_DTLB_MISSES:
+            attr->type   = PERF_TYPE_HW_CACHE;
+            attr->config = cacheReadMisses(PERF_COUNT_HW_CACHE_DTLB);
+            break;
+        case PERF_COUNTERS_COUNT:
+        default:
+            assert(!"Unknown counter");
+            break;
+    }
+
+    attr->disabled       = 1;   // Group is enabled by perfCountersStart
+    attr->exclude_kernel = 1;
+    attr->exclude_hv     = 1;
+    attr->read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+}
+
+bool perfCountersOpen(perfCounters_t *counters) {
+    assert(counters);
+
+    memset(counters, 0, sizeof(*counters));
+    counters->groupFd = -1;
+
+    for (int counter = 0; counter < PERF_COUNTERS_COUNT; counter++) {
+        struct perf_event_attr attr;
+        perfCounterAttr((perfCounter_t) counter, &attr);
+
+        // Calling thread on any cpu, first opened counter leads the group
+        const int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, counters->groupFd, 0);
+        counters->fds[counter] = fd;
+        if (fd < 0) {
+            if (!counters->error)
+                counters->error = errno;
+            continue;
+        }
+        if (counters->groupFd < 0)
+            counters->groupFd = fd;
+    }
+
+    return counters->groupFd >= 0;
+}
+
+void perfCountersClose(perfCounters_t *counters) {
+    assert(counters);
+
+    for (int counter = 0; counter < PERF_COUNTERS_COUNT; counter++) {
+        if (counters->fds[counter] >= 0)
+            close(counters->fds[counter]);
+        counters->fds[counter] = -1;
+    }
+    counters->groupFd = -1;
+}
+
+void perfCountersStart(perfCounters_t *counters) {
+    assert(counters);
+
+    if (counters->groupFd < 0)
+        return;
+
+    ioctl(counters->groupFd, PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+    ioctl(counters->groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void perfCountersStop(perfCounters_t *counters) {
+    assert(counters);
+
+    memset(counters->counted, 0, sizeof(counters->counted));
+    if (counters->groupFd < 0)
+        return;
+
+    ioctl(counters->groupFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // Group read: number of counters, enabled and running time, values in order of opening
+    uint64_t data[3 + PERF_COUNTERS_COUNT] = {};
+    if (read(counters->groupFd, data, sizeof(data)) < (ssize_t) (3 * sizeof(uint64_t)))
+        return;
+
+    const uint64_t timeEnabled = data[1], timeRunning = data[2];
+    // Group was never scheduled: PMU has fewer free counters than the group needs
+    if (timeRunning == 0)
+        return;
+
+    // Group was multiplexed with other events: values are extrapolated to the whole interval
+    const double scale = (double) timeEnabled / (double) timeRunning;
+
+    uint64_t valueIdx = 0;
+    for (int counter = 0; counter < PERF_COUNTERS_COUNT && valueIdx < data[0]; counter++) {
+        if (counters->fds[counter] < 0)
+            continue;
+
+        counters->values[counter]  = (uint64_t) ((double) data[3 + valueIdx] * scale);
+        counters->counted[counter] = true;
+        valueIdx++;
+    }
+}
+
+void perfCountersPrint(FILE *file, const char *phase, const perfCounters_t *counters, int64_t ops) {
+    assert(phase);
+    assert(counters);
+
+    // Values are read by perfCountersStop, so they can be printed after perfCountersClose
+    bool anyCounted = false;
+    for (int counter = 0; counter < PERF_COUNTERS_COUNT; counter++)
+        anyCounted |= counters->counted[counter];
+
+    if (!anyCounted) {
+        fprintf(file, "%s: hardware counters unavailable (%s)\n", phase,
+                counters->error ? strerror(counters->error) : "group was not measured");
+        return;
+    }
+
+    const double perOp = 1.0 / (double) (ops ? ops : 1);
+    fprintf(file, "%s, per operation:", phase);
+    for (int counter = 0; counter < PERF_COUNTERS_COUNT; counter++) {
+        if (counters->counted[counter])
+            fprintf(file, " %s %.3f", PERF_COUNTER_NAMES[counter], (double) counters->values[counter] * perOp);
+        else
+            fprintf(file, " %s n/a", PERF_COUNTER_NAMES[counter]);
+    }
+
+    if (counters->counted[PERF_CYCLES] && counters->counted[PERF_INSTRUCTIONS] && counters->values[PERF_CYCLES])
+        fprintf(file, ", IPC %.2f", (double) counters->values[PERF_INSTRUCTIONS] / (double) counters->values[PERF_CYCLES]);
+    fprintf(file, "\n");
+
+    if (counters->error)
+        fprintf(file, "%s: some counters are not supported (%s)\n", phase, strerror(counters->error));
+}
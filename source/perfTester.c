@@ -1,9 +1,20 @@
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <x86intrin.h>
+#include <sched.h>
 
 #include "perfTester.h"
 #include "hashTable.h"
+#include "hashTable.hpp"
+#include "hashTablePolicy.h"
+#include "hyperLogLog.h"
+#include "benchHarness.h"
+#include "perfCounters.h"
+#include "hashTableNuma.h"
+#include "hashTableIntern.h"
+#include "hashTableInt.h"
+#include "hashTableSet.h"
 
 /* ========================== Clock functions ========================== */
 void codeClockStart(codeClock_t *clk) {
@@ -51,6 +62,2094 @@ int64_t __attribute__ ((noinline)) testRequests(hashTable_t *ht, text_t requests
     return totalFound;
 }
 
+/* Measures build and search time for different load factors (bucketsCount = uniqueWords / loadFactor) */
+void testLoadFactors(const char *stringsFile, const char *requestsFile) {
+    text_t words    = readFileSplitAligned(stringsFile);
+    text_t requests = readFileSplitAligned(requestsFile);
+
+    // Counting unique words with the table of default size
+    hashTable_t ht = {};
+    hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+    for (int idx = 0; idx < words.wordsCount; idx++)
+        hashTableAccess(&ht, words.words[idx]);
+    const size_t uniqueWords = ht.size;
+    hashTableDtor(&ht);
+
+    #if HASH_TABLE_ARCH == 2
+    fprintf(stderr, "Unique words: %zu, inlined nodes: %d, bucket size: %zu bytes\n",
+                     uniqueWords, BUCKET_INLINE_NODES, sizeof(hashTableBucket_t));
+    #endif
+    fprintf(stderr, "%11s %8s %10s %10s\n", "load factor", "buckets", "build, ms", "ticks/find");
+
+    for (size_t lfIdx = 0; lfIdx < sizeof(LOAD_FACTORS) / sizeof(LOAD_FACTORS[0]); lfIdx++) {
+        const size_t bucketsCount = uniqueWords / LOAD_FACTORS[lfIdx] + 1;
+
+        ht = {};
+        hashTableCtor(&ht, sizeof(int), bucketsCount);
+
+        codeClock_t clock;
+        MEASURE_TIME(clock,
+            for (int idx = 0; idx < words.wordsCount; idx++) {
+                hashTableAccess(&ht, words.words[idx]);
+            }
+        )
+        double buildTimeMs = codeClockGetTimeMs(&clock);
+
+        testRequests(&ht, requests, &clock);
+        double avgTicksPerFind = (double)(clock.clocksEnd - clock.clocksStart) / (double) (requests.wordsCount * TEST_LOOPS);
+
+        fprintf(stderr, "%11zu %8zu %10.2f %10.2f\n", LOAD_FACTORS[lfIdx], bucketsCount, buildTimeMs, avgTicksPerFind);
+
+        hashTableDtor(&ht);
+    }
+
+    textDtor(&words);
+    textDtor(&requests);
+}
+
+#if HASH_TABLE_ARCH == 2
+int64_t __attribute__ ((noinline)) testRequestsTyped(HashTable<int> *ht, const std::string_view *requests,
+                                                     int64_t requestsCount, codeClock_t *clock);
+
+/* Same as testRequests, but through typed front-end. Lengths of keys are known in advance */
+int64_t __attribute__ ((noinline)) testRequestsTyped(HashTable<int> *ht, const std::string_view *requests,
+                                                     int64_t requestsCount, codeClock_t *clock) {
+    int64_t totalFound = 0;
+
+    MEASURE_TIME(*clock,
+        for (int loop = 0; loop < TEST_LOOPS; loop++) {
+            for (int idx = 0; idx < requestsCount; idx++) {
+                int *value = ht->find(requests[idx]);
+                if (value) {
+                    (*value)++;
+                    totalFound++;
+                }
+            }
+        }
+    )
+
+    return totalFound;
+}
+
+/* Compares C API with typed front-end HashTable<int> on the same data */
+void testTypedFrontend(const char *stringsFile, const char *requestsFile) {
+    text_t words    = readFileSplitAligned(stringsFile);
+    text_t requests = readFileSplitAligned(requestsFile);
+
+    std::string_view *requestViews = (std::string_view *) calloc((size_t) requests.wordsCount, sizeof(std::string_view));
+    assert(requestViews);
+    for (int64_t idx = 0; idx < requests.wordsCount; idx++)
+        requestViews[idx] = std::string_view(requests.words[idx]);
+
+    codeClock_t clock;
+
+    /* ---------------- C API ---------------- */
+    hashTable_t ht = {};
+    hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+
+    MEASURE_TIME(clock,
+        for (int idx = 0; idx < words.wordsCount; idx++) {
+            hashTableAccess(&ht, words.words[idx]);
+        }
+    )
+    double buildC = codeClockGetTimeMs(&clock);
+
+    int64_t foundC = testRequests(&ht, requests, &clock);
+    double ticksC = (double)(clock.clocksEnd - clock.clocksStart) / (double) (requests.wordsCount * TEST_LOOPS);
+    hashTableDtor(&ht);
+
+    /* ---------------- HashTable<int> ---------------- */
+    HashTable<int> typed(HASH_TABLE_SIZE);
+    assert(typed.status() == HT_SUCCESS);
+
+    MEASURE_TIME(clock,
+        for (int idx = 0; idx < words.wordsCount; idx++) {
+            typed.access(words.words[idx]);
+        }
+    )
+    double buildTyped = codeClockGetTimeMs(&clock);
+
+    int64_t foundTyped = testRequestsTyped(&typed, requestViews, requests.wordsCount, &clock);
+    double ticksTyped = (double)(clock.clocksEnd - clock.clocksStart) / (double) (requests.wordsCount * TEST_LOOPS);
+
+    fprintf(stderr, "%-16s %10s %10s %10s\n", "API", "build, ms", "ticks/find", "found");
+    fprintf(stderr, "%-16s %10.2f %10.2f %10ji\n", "C",              buildC,     ticksC,     foundC);
+    fprintf(stderr, "%-16s %10.2f %10.2f %10ji\n", "HashTable<int>", buildTyped, ticksTyped, foundTyped);
+
+    free(requestViews);
+    textDtor(&words);
+    textDtor(&requests);
+}
+#else
+void testTypedFrontend(const char *stringsFile, const char *requestsFile) {
+    (void) stringsFile;
+    (void) requestsFile;
+    fprintf(stderr, "Typed front-end is implemented for HASH_TABLE_ARCH == 2 only\n");
+}
+#endif
+
+/* Benchmarks all policies linked into the binary on the same data.
+   Policies are run round-robin POLICY_ROUNDS times and the best round is reported,
+   so frequency changes and warm-up affect all of them equally */
+void testPolicies(const char *stringsFile, const char *requestsFile) {
+    text_t words    = readFileSplitAligned(stringsFile);
+    text_t requests = readFileSplitAligned(requestsFile);
+
+    size_t policiesCount = 0;
+    for (hashTablePolicy_t *policy = hashTablePolicies(); policy; policy = policy->next)
+        policiesCount++;
+
+    double *bestBuildMs = (double *) calloc(policiesCount, sizeof(double));
+    double *bestTicks   = (double *) calloc(policiesCount, sizeof(double));
+    assert(bestBuildMs && bestTicks);
+
+    for (int round = 0; round < POLICY_ROUNDS; round++) {
+        size_t policyIdx = 0;
+        for (hashTablePolicy_t *policy = hashTablePolicies(); policy; policy = policy->next, policyIdx++) {
+            void *table = policy->ctor(sizeof(int), HASH_TABLE_SIZE);
+            assert(table);
+
+            codeClock_t clock;
+            MEASURE_TIME(clock,
+                policy->accessAll(table, words.words, words.wordsCount);
+            )
+            double buildMs = codeClockGetTimeMs(&clock);
+
+            int64_t totalFound = 0;
+            MEASURE_TIME(clock,
+                for (int loop = 0; loop < TEST_LOOPS; loop++)
+                    totalFound += policy->findAll(table, requests.words, requests.wordsCount);
+            )
+            double ticks = (double)(clock.clocksEnd - clock.clocksStart) / (double) (requests.wordsCount * TEST_LOOPS);
+            (void) totalFound;
+
+            if (round == 0 || buildMs < bestBuildMs[policyIdx]) bestBuildMs[policyIdx] = buildMs;
+            if (round == 0 || ticks   < bestTicks[policyIdx])   bestTicks[policyIdx]   = ticks;
+
+            policy->dtor(table);
+        }
+    }
+
+    fprintf(stderr, "%-18s %10s %10s\n", "policy", "build, ms", "ticks/find");
+    size_t policyIdx = 0;
+    for (hashTablePolicy_t *policy = hashTablePolicies(); policy; policy = policy->next, policyIdx++)
+        fprintf(stderr, "%-18s %10.2f %10.2f\n", policy->name, bestBuildMs[policyIdx], bestTicks[policyIdx]);
+
+    free(bestBuildMs);
+    free(bestTicks);
+    textDtor(&words);
+    textDtor(&requests);
+}
+
+/* Compares build of the table with default size against table sized by HyperLogLog pre-pass */
+void testReserve(const char *stringsFile) {
+    text_t words = readFileSplitAligned(stringsFile);
+
+    codeClock_t clock;
+
+    /* ---------- Unsized: default number of buckets ---------- */
+    hashTable_t ht = {};
+    hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+    MEASURE_TIME(clock,
+        for (int idx = 0; idx < words.wordsCount; idx++)
+            hashTableAccess(&ht, words.words[idx]);
+    )
+    double unsizedMs = codeClockGetTimeMs(&clock);
+    const size_t uniqueWords = ht.size;
+    hashTableDtor(&ht);
+
+    /* ---------- Sized: estimate, reserve, insert ---------- */
+    int64_t estimate = 0;
+    MEASURE_TIME(clock,
+        estimate = textEstimateUniqueWords(words);
+    )
+    double estimateMs = codeClockGetTimeMs(&clock);
+
+    ht = {};
+    MEASURE_TIME(clock,
+        hashTableCtor(&ht, sizeof(int), 1);
+        hashTableReserve(&ht, (size_t) estimate);
+        for (int idx = 0; idx < words.wordsCount; idx++)
+            hashTableAccess(&ht, words.words[idx]);
+    )
+    double sizedMs = codeClockGetTimeMs(&clock);
+    const size_t sizedBuckets = ht.bucketsCount;
+    hashTableDtor(&ht);
+
+    /* ---------- Growing: reserve after insertion (rehash) ---------- */
+    ht = {};
+    hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+    for (int idx = 0; idx < words.wordsCount; idx++)
+        hashTableAccess(&ht, words.words[idx]);
+    MEASURE_TIME(clock,
+        hashTableReserve(&ht, uniqueWords);
+    )
+    double rehashMs = codeClockGetTimeMs(&clock);
+    hashTableDtor(&ht);
+
+    const double estimateError = 100.0 * ((double) estimate - (double) uniqueWords) / (double) uniqueWords;
+
+    fprintf(stderr, "Words: %ji, unique: %zu, estimated: %ji (error %+.2f%%)\n",
+                     words.wordsCount, uniqueWords, estimate, estimateError);
+    fprintf(stderr, "%-28s %10s\n", "build", "time, ms");
+    fprintf(stderr, "%-28s %10.2f\n", "unsized (default buckets)", unsizedMs);
+    fprintf(stderr, "%-28s %10.2f\n", "estimate pre-pass", estimateMs);
+    fprintf(stderr, "%-28s %10.2f (%zu buckets)\n", "sized (reserve + insert)", sizedMs, sizedBuckets);
+    fprintf(stderr, "%-28s %10.2f\n", "rehash of unsized table", rehashMs);
+
+    textDtor(&words);
+}
+
+/* Compares hashTableBulkAccess with per-key hashTableAccess loop on random corpus */
+void testBulkInsert(int64_t wordsCount) {
+    // Half of the words are unique, so table is as large as the corpus
+    const int64_t vocabulary = wordsCount / 2;
+    text_t words = generateRandomText(wordsCount, vocabulary, 0xB01C);
+    assert(words.words);
+
+    void **values = (void **) calloc((size_t) wordsCount, sizeof(void *));
+    assert(values);
+
+    codeClock_t clock;
+
+    hashTable_t ht = {};
+    hashTableCtor(&ht, sizeof(int), 1);
+    hashTableReserve(&ht, (size_t) vocabulary);
+    MEASURE_TIME(clock,
+        for (int64_t idx = 0; idx < wordsCount; idx++)
+            values[idx] = hashTableAccess(&ht, words.words[idx]);
+    )
+    double loopMs = codeClockGetTimeMs(&clock);
+    const size_t uniqueWords = ht.size;
+    hashTableDtor(&ht);
+
+    ht = {};
+    hashTableCtor(&ht, sizeof(int), 1);
+    hashTableReserve(&ht, (size_t) vocabulary);
+    MEASURE_TIME(clock,
+        hashTableBulkAccess(&ht, words.words, (size_t) wordsCount, values);
+    )
+    double bulkMs = codeClockGetTimeMs(&clock);
+
+    // Values of the same word must be the same object
+    for (int64_t idx = 0; idx < wordsCount; idx++)
+        (*(int *) values[idx])++;
+    int64_t totalCount = 0;
+    for (int64_t idx = 0; idx < wordsCount; idx++)
+        totalCount += (*(int *) hashTableFind(&ht, words.words[idx]) > 0);
+    assert(totalCount == wordsCount && ht.size == uniqueWords);
+
+    fprintf(stderr, "Words: %ji, unique: %zu, buckets: %zu\n", wordsCount, uniqueWords, ht.bucketsCount);
+    fprintf(stderr, "%-24s %10s %12s\n", "insertion", "time, ms", "ns per word");
+    fprintf(stderr, "%-24s %10.2f %12.2f\n", "hashTableAccess loop", loopMs, loopMs * 1e6 / (double) wordsCount);
+    fprintf(stderr, "%-24s %10.2f %12.2f\n", "hashTableBulkAccess",  bulkMs, bulkMs * 1e6 / (double) wordsCount);
+
+    hashTableDtor(&ht);
+    free(values);
+    textDtor(&words);
+}
+
+/* Finds from uniform and Zipf-distributed request streams over the same vocabulary, for every policy */
+void testSkewedTraffic() {
+    const double exponents[] = {0, SKEW_TEST_EXPONENT};
+    const size_t distributionsCount = sizeof(exponents) / sizeof(exponents[0]);
+
+    text_t requests[distributionsCount] = {};
+    for (size_t dist = 0; dist < distributionsCount; dist++) {
+        requests[dist] = generateZipfText(SKEW_TEST_REQUESTS, SKEW_TEST_VOCABULARY, exponents[dist], 0x21BF);
+        assert(requests[dist].words);
+    }
+
+    // Same seed gives same vocabulary: it is inserted in its order, ranks of words are shuffled
+    char **vocabulary = (char **) calloc((size_t) SKEW_TEST_VOCABULARY, sizeof(char *));
+    assert(vocabulary);
+    for (int64_t idx = 0; idx < SKEW_TEST_VOCABULARY; idx++)
+        vocabulary[idx] = requests[0].data + idx * (int64_t) SMALL_STR_LEN;
+
+    size_t policiesCount = 0;
+    for (hashTablePolicy_t *policy = hashTablePolicies(); policy; policy = policy->next)
+        policiesCount++;
+
+    double *bestTicks = (double *) calloc(policiesCount * distributionsCount, sizeof(double));
+    assert(bestTicks);
+
+    for (int round = 0; round < POLICY_ROUNDS; round++) {
+        size_t policyIdx = 0;
+        for (hashTablePolicy_t *policy = hashTablePolicies(); policy; policy = policy->next, policyIdx++) {
+            for (size_t dist = 0; dist < distributionsCount; dist++) {
+                void *table = policy->ctor(sizeof(int), (size_t) SKEW_TEST_VOCABULARY / SKEW_TEST_LOAD_FACTOR);
+                assert(table);
+                policy->accessAll(table, vocabulary, SKEW_TEST_VOCABULARY);
+
+                codeClock_t clock;
+                int64_t found = 0;
+                MEASURE_TIME(clock,
+                    found = policy->findAll(table, requests[dist].words, requests[dist].wordsCount);
+                )
+                assert(found == requests[dist].wordsCount);
+                double ticks = (double)(clock.clocksEnd - clock.clocksStart) / (double) requests[dist].wordsCount;
+
+                double *best = bestTicks + policyIdx * distributionsCount + dist;
+                if (round == 0 || ticks < *best) *best = ticks;
+
+                policy->dtor(table);
+            }
+        }
+    }
+
+    fprintf(stderr, "Vocabulary: %ji, load factor: %zu, requests: %ji, Zipf exponent: %.2f\n",
+            SKEW_TEST_VOCABULARY, SKEW_TEST_LOAD_FACTOR, SKEW_TEST_REQUESTS, SKEW_TEST_EXPONENT);
+    fprintf(stderr, "%-22s %14s %14s\n", "policy", "uniform, ticks", "Zipf, ticks");
+    size_t policyIdx = 0;
+    for (hashTablePolicy_t *policy = hashTablePolicies(); policy; policy = policy->next, policyIdx++)
+        fprintf(stderr, "%-22s %14.2f %14.2f\n", policy->name,
+                bestTicks[policyIdx * distributionsCount], bestTicks[policyIdx * distributionsCount + 1]);
+
+    free(bestTicks);
+    free(vocabulary);
+    for (size_t dist = 0; dist < distributionsCount; dist++)
+        textDtor(requests + dist);
+}
+
+/// @brief Transparent huge pages of the process in kB (AnonHugePages of /proc/self/smaps_rollup), -1 if unknown
+static int64_t anonHugePagesKb() {
+    FILE *smaps = fopen("/proc/self/smaps_rollup", "r");
+    if (!smaps)
+        return -1;
+
+    char line[256] = "";
+    int64_t hugeKb = -1;
+    while (fgets(line, sizeof(line), smaps))
+        if (sscanf(line, "AnonHugePages: %jd kB", &hugeKb) == 1)
+            break;
+
+    fclose(smaps);
+    return hugeKb;
+}
+
+static void hugePagesLookups(hashTablePolicy_t *policy, void *table, const char *stage, text_t requests) {
+    perfCounters_t counters;
+    perfCountersOpen(&counters);
+
+    codeClock_t clock;
+    int64_t found = 0;
+    MEASURE_COUNTERS(counters,
+    MEASURE_TIME(clock,
+        found = policy->findAll(table, requests.words, requests.wordsCount);
+    )
+    )
+    perfCountersClose(&counters);
+    assert(found == requests.wordsCount);
+
+    const double perLookup = 1.0 / (double) requests.wordsCount;
+    fprintf(stderr, "%-14s %-10s %10.2f %10.2f ", policy->name, stage,
+            (double) clock.elapsed * NSEC_PER_MCS * perLookup, (double) (clock.clocksEnd - clock.clocksStart) * perLookup);
+    if (counters.counted[PERF_DTLB_MISSES])
+        fprintf(stderr, "%12.3f", (double) counters.values[PERF_DTLB_MISSES] * perLookup);
+    else
+        fprintf(stderr, "%12s", "n/a");
+    fprintf(stderr, " %14jd\n", anonHugePagesKb());
+}
+
+void testHugePages() {
+    static const char *const POLICIES[] = {"v2_all", "v2_hugePages"};
+
+    // Vocabulary is the beginning of the text data (see generateRandomText), requests are uniform over it
+    text_t requests = generateRandomText(HUGE_PAGE_TEST_REQUESTS, HUGE_PAGE_TEST_VOCABULARY, 0x9A6E);
+    assert(requests.words);
+    char **vocabulary = (char **) calloc((size_t) HUGE_PAGE_TEST_VOCABULARY, sizeof(char *));
+    assert(vocabulary);
+    for (int64_t idx = 0; idx < HUGE_PAGE_TEST_VOCABULARY; idx++)
+        vocabulary[idx] = requests.data + idx * (int64_t) SMALL_STR_LEN;
+
+    fprintf(stderr, "Vocabulary: %jd, load factor: %zu, requests: %jd, reserved huge pages are used if there are any\n",
+            HUGE_PAGE_TEST_VOCABULARY, HUGE_PAGE_TEST_LOAD_FACTOR, HUGE_PAGE_TEST_REQUESTS);
+    fprintf(stderr, "%-14s %-10s %10s %10s %12s %14s\n", "policy", "stage", "ns/lookup", "ticks", "dTLB misses", "AnonHuge, kB");
+
+    for (size_t policyIdx = 0; policyIdx < sizeof(POLICIES) / sizeof(POLICIES[0]); policyIdx++) {
+        hashTablePolicy_t *policy = hashTablePolicies();
+        while (policy && strcmp(policy->name, POLICIES[policyIdx]) != 0)
+            policy = policy->next;
+        if (!policy) {
+            fprintf(stderr, "Policy %s is not linked\n", POLICIES[policyIdx]);
+            continue;
+        }
+
+        void *table = policy->ctor(sizeof(int), (size_t) HUGE_PAGE_TEST_VOCABULARY / HUGE_PAGE_TEST_LOAD_FACTOR);
+        assert(table);
+        policy->accessAll(table, vocabulary, HUGE_PAGE_TEST_VOCABULARY);
+        hugePagesLookups(policy, table, "built", requests);
+
+        // Overflow arrays scattered over the heap are moved into one arena
+        policy->compact(table);
+        hugePagesLookups(policy, table, "compacted", requests);
+
+        policy->dtor(table);
+    }
+
+    free(vocabulary);
+    textDtor(&requests);
+}
+
+#if HASH_TABLE_ARCH == 2 && defined(HASH_TABLE_STATS)
+static void printTableStats(const hashTable_t *table) {
+    hashTableStats_t stats = {};
+    hashTableGetStats(table, &stats);
+
+    fprintf(stderr, "Lookups: %ju (hits %ju, misses %ju), long key scans: %ju\n",
+            stats.lookups, stats.hits, stats.misses, stats.longKeyScans);
+    fprintf(stderr, "Nodes compared per lookup: %.3f, allocations: %ju, reallocs: %ju\n",
+            (double) stats.nodesCompared / (double) (stats.lookups ? stats.lookups : 1),
+            stats.allocations, stats.reallocs);
+    fprintf(stderr, "Size: %zu, buckets: %zu, long keys: %zu\nBucket sizes:", stats.size,
+            stats.bucketsCount, stats.longKeysCount);
+    for (size_t bin = 0; bin < HT_STATS_HISTOGRAM_SIZE; bin++)
+        fprintf(stderr, " %zu%s: %ju", bin, (bin + 1 == HT_STATS_HISTOGRAM_SIZE) ? "+" : "", stats.bucketSizes[bin]);
+    fprintf(stderr, "\n");
+}
+#endif
+
+/* Runs mixed stream of finds, inserts and erases on the table built from stringsFile */
+void testWorkload(const char *stringsFile, const char *workloadFile) {
+    text_t words = readFileSplitAligned(stringsFile);
+    workload_t workload = readWorkload(workloadFile);
+    assert(workload.ops);
+
+    hashTable_t ht = {};
+    hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+    for (int64_t idx = 0; idx < words.wordsCount; idx++)
+        hashTableAccess(&ht, words.words[idx]);
+    #if HASH_TABLE_ARCH == 2 && defined(HASH_TABLE_STATS)
+    hashTableResetStats(&ht);
+    #endif
+
+    int64_t finds = 0, found = 0, inserts = 0, erases = 0, erased = 0;
+    codeClock_t clock;
+    MEASURE_TIME(clock,
+        for (int64_t idx = 0; idx < workload.keys.wordsCount; idx++) {
+            const char *key = workload.keys.words[idx];
+            switch (workload.ops[idx]) {
+                case WORKLOAD_INSERT:
+                    (*(int *) hashTableAccess(&ht, key))++;
+                    inserts++;
+                    break;
+                case WORKLOAD_ERASE:
+                    erased += (hashTableErase(&ht, key) == HT_SUCCESS);
+                    erases++;
+                    break;
+                default: {
+                    int *value = (int *) hashTableFind(&ht, key);
+                    if (value) {
+                        (*value)++;
+                        found++;
+                    }
+                    finds++;
+                    break;
+                }
+            }
+        }
+    )
+
+    const int64_t ops = workload.keys.wordsCount;
+    fprintf(stderr, "Requests: %ji (find %ji, insert %ji, erase %ji)\n", ops, finds, inserts, erases);
+    fprintf(stderr, "Found: %ji of finds, erased: %ji of erases, table size: %zu\n", found, erased, ht.size);
+    fprintf(stderr, "Time: %.2f ms, %.2f ticks per request\n", codeClockGetTimeMs(&clock),
+            (double)(clock.clocksEnd - clock.clocksStart) / (double) ops);
+    #if HASH_TABLE_ARCH == 2 && defined(HASH_TABLE_STATS)
+    printTableStats(&ht);
+    #endif
+
+    hashTableDtor(&ht);
+    workloadDtor(&workload);
+    textDtor(&words);
+}
+
+/// Histograms of testLatency: operation (access, find) x hit/miss x short/long key
+enum latencyClass_t {
+    LATENCY_SHORT_KEY = 0,
+    LATENCY_LONG_KEY  = 1,
+    LATENCY_HIT       = 0,
+    LATENCY_MISS      = 2,
+    LATENCY_ACCESS    = 0,
+    LATENCY_FIND      = 4,
+    LATENCY_CLASSES   = 8,
+};
+
+static void recordLatency(latencyHistogram_t *hists, int latencyClass, uint64_t start, uint64_t end, uint64_t overhead) {
+    const uint64_t ticks = end - start;
+    latencyRecord(hists + latencyClass, (ticks > overhead) ? ticks - overhead : 0);
+}
+
+static int keyLatencyClass(const char *key) {
+    return (strlen(key) >= SMALL_STR_LEN) ? LATENCY_LONG_KEY : LATENCY_SHORT_KEY;
+}
+
+/* Times single calls on table of default size, overhead of timing itself is subtracted */
+void testLatency(const char *stringsFile, const char *requestsFile) {
+    text_t words    = readFileSplitAligned(stringsFile);
+    text_t requests = readFileSplitAligned(requestsFile);
+
+    latencyHistogram_t *hists = (latencyHistogram_t *) calloc(LATENCY_CLASSES, sizeof(latencyHistogram_t));
+    assert(hists);
+
+    const int cpu = benchPinThread(-1);
+    const uint64_t overhead = latencyCalibrate(LATENCY_CALIBRATION_SAMPLES);
+
+    hashTable_t ht = {};
+    hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+
+    for (int64_t idx = 0; idx < words.wordsCount; idx++) {
+        const char *key = words.words[idx];
+        if (idx % LATENCY_SAMPLE_PERIOD != 0) {
+            (*(int *) hashTableAccess(&ht, key))++;
+            continue;
+        }
+
+        const size_t sizeBefore = ht.size;
+        const uint64_t start = latencyStart();
+        int *value = (int *) hashTableAccess(&ht, key);
+        const uint64_t end = latencyStop();
+        (*value)++;
+
+        const int latencyClass = LATENCY_ACCESS | ((ht.size == sizeBefore) ? LATENCY_HIT : LATENCY_MISS) | keyLatencyClass(key);
+        recordLatency(hists, latencyClass, start, end, overhead);
+    }
+
+    for (int loop = 0; loop < TEST_LOOPS; loop++) {
+        for (int64_t idx = 0; idx < requests.wordsCount; idx++) {
+            const char *key = requests.words[idx];
+            if (idx % LATENCY_SAMPLE_PERIOD != 0) {
+                int *value = (int *) hashTableFind(&ht, key);
+                if (value)
+                    (*value)++;
+                continue;
+            }
+
+            const uint64_t start = latencyStart();
+            int *value = (int *) hashTableFind(&ht, key);
+            const uint64_t end = latencyStop();
+            if (value)
+                (*value)++;
+
+            const int latencyClass = LATENCY_FIND | (value ? LATENCY_HIT : LATENCY_MISS) | keyLatencyClass(key);
+            recordLatency(hists, latencyClass, start, end, overhead);
+        }
+    }
+
+    fprintf(stderr, "CPU: %d, every %ji-th call is timed, overhead of timing: %ju ticks (subtracted)\n",
+            cpu, LATENCY_SAMPLE_PERIOD, overhead);
+    latencyPrintHeader(stderr);
+
+    const char *classNames[LATENCY_CLASSES] = {
+        "access hit short", "access hit long", "access miss short", "access miss long",
+        "find hit short",   "find hit long",   "find miss short",   "find miss long",
+    };
+    for (int latencyClass = 0; latencyClass < LATENCY_CLASSES; latencyClass++)
+        latencyPrint(stderr, classNames[latencyClass], hists + latencyClass);
+
+    hashTableDtor(&ht);
+    free(hists);
+    textDtor(&words);
+    textDtor(&requests);
+}
+
+/* Finds of all requests, each followed by incremental verification with given budget (0 - no verification) */
+static double verifiedRequestsTicks(hashTable_t *ht, text_t requests, size_t budget) {
+    codeClock_t clock;
+    int64_t found = 0;
+
+    MEASURE_TIME(clock,
+        for (int loop = 0; loop < TEST_LOOPS; loop++) {
+            for (int64_t idx = 0; idx < requests.wordsCount; idx++) {
+                int *value = (int *) hashTableFind(ht, requests.words[idx]);
+                if (value) {
+                    (*value)++;
+                    found++;
+                }
+                #if HASH_TABLE_ARCH == 2
+                if (budget)
+                    hashTableVerifyIncremental(ht, budget);
+                #endif
+            }
+        }
+    )
+    (void) found;
+
+    return (double) (clock.clocksEnd - clock.clocksStart) / (double) (requests.wordsCount * TEST_LOOPS);
+}
+
+void testVerifyBudgets(const char *stringsFile, const char *requestsFile) {
+    #if HASH_TABLE_ARCH == 2
+    text_t words    = readFileSplitAligned(stringsFile);
+    text_t requests = readFileSplitAligned(requestsFile);
+
+    hashTable_t ht = {};
+    hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+    for (int64_t idx = 0; idx < words.wordsCount; idx++)
+        hashTableAccess(&ht, words.words[idx]);
+
+    const double baseTicks = verifiedRequestsTicks(&ht, requests, 0);
+    fprintf(stderr, "Table size: %zu, buckets: %zu\n", ht.size, ht.bucketsCount);
+    fprintf(stderr, "%14s %12s %9s %18s\n", "budget, nodes", "ticks/find", "overhead", "finds per full pass");
+    fprintf(stderr, "%14s %12.2f %8s%% %18s\n", "none", baseTicks, "0", "-");
+
+    for (size_t budgetIdx = 0; budgetIdx < sizeof(VERIFY_BUDGETS) / sizeof(VERIFY_BUDGETS[0]); budgetIdx++) {
+        const size_t budget = VERIFY_BUDGETS[budgetIdx];
+        const double ticks = verifiedRequestsTicks(&ht, requests, budget);
+        fprintf(stderr, "%14zu %12.2f %8.0f%% %18zu\n", budget, ticks, 100 * (ticks / baseTicks - 1),
+                (ht.size + ht.bucketsCount + budget) / budget);
+    }
+
+    codeClock_t clock;
+    hashTableStatus_t fullStatus = HT_SUCCESS;
+    MEASURE_TIME(clock,
+        fullStatus = hashTableVerify(&ht);
+    )
+    fprintf(stderr, "Full verification: %.0f ticks (%.2f ms), status %d\n",
+            (double) (clock.clocksEnd - clock.clocksStart), codeClockGetTimeMs(&clock), fullStatus);
+
+    // Snapshot is checked by child process while parent keeps serving requests
+    pid_t child = 0;
+    MEASURE_TIME(clock,
+        hashTableVerifySnapshot(&ht, &child);
+    )
+    const double forkMs = codeClockGetTimeMs(&clock);
+    const double snapshotTicks = verifiedRequestsTicks(&ht, requests, 0);
+    fprintf(stderr, "Snapshot verification: fork %.2f ms, finds meanwhile %.2f ticks, status %d\n",
+            forkMs, snapshotTicks, hashTableVerifySnapshotWait(child));
+
+    hashTableDtor(&ht);
+    textDtor(&words);
+    textDtor(&requests);
+    #else
+    (void) stringsFile;
+    (void) requestsFile;
+    fprintf(stderr, "Incremental verification is implemented for HASH_TABLE_ARCH == 2 only\n");
+    #endif
+}
+
+#if HASH_TABLE_ARCH == 2
+static void printMemoryUsage(const char *corpus, size_t valSize, const char *stage, const hashTable_t *table) {
+    hashTableMemory_t usage = {};
+    hashTableMemoryUsage(table, &usage);
+
+    fprintf(stderr, "%-12s %5zu %-14s %8zu %8.1f %9zu %9zu %9zu %9zu %9zu %9zu\n", corpus, valSize, stage, table->size,
+            (double) usage.total / (double) (table->size ? table->size : 1), usage.total, usage.buckets,
+            usage.overflowNodes, usage.longKeys, usage.values, usage.allocatorOverhead);
+}
+#endif
+
+void testMemoryUsage() {
+    #if HASH_TABLE_ARCH == 2
+    static const char *const CORPORA[][2] = {{"shakespeare", "shakespeare.txt"}, {"tolkien", "tolkien.txt"}};
+    const size_t valSizes[] = {sizeof(int), MEMORY_TEST_BIG_VALUE};
+
+    fprintf(stderr, "%-12s %5s %-14s %8s %8s %9s %9s %9s %9s %9s %9s\n", "corpus", "value", "stage", "keys",
+            "bytes/key", "total", "buckets", "overflow", "long keys", "values", "overhead");
+
+    for (size_t corpusIdx = 0; corpusIdx < sizeof(CORPORA) / sizeof(CORPORA[0]); corpusIdx++) {
+        text_t words = readCorpusAligned(CORPORA[corpusIdx][1]);
+        if (!words.wordsCount) {
+            fprintf(stderr, "Skipping corpus %s\n", CORPORA[corpusIdx][0]);
+            continue;
+        }
+
+        for (size_t valIdx = 0; valIdx < sizeof(valSizes) / sizeof(valSizes[0]); valIdx++) {
+            hashTable_t ht = {};
+            hashTableCtor(&ht, valSizes[valIdx], HASH_TABLE_SIZE);
+            for (int64_t idx = 0; idx < words.wordsCount; idx++)
+                hashTableAccess(&ht, words.words[idx]);
+
+            printMemoryUsage(CORPORA[corpusIdx][0], valSizes[valIdx], "build", &ht);
+            hashTableCompact(&ht);
+            printMemoryUsage(CORPORA[corpusIdx][0], valSizes[valIdx], "compact", &ht);
+
+            // Words at even positions are erased: mostly rare words that occur only at odd positions are left
+            for (int64_t idx = 0; idx < words.wordsCount; idx += 2)
+                hashTableErase(&ht, words.words[idx]);
+            printMemoryUsage(CORPORA[corpusIdx][0], valSizes[valIdx], "erase", &ht);
+            hashTableCompact(&ht);
+            printMemoryUsage(CORPORA[corpusIdx][0], valSizes[valIdx], "compact again", &ht);
+
+            hashTableDtor(&ht);
+        }
+
+        textDtor(&words);
+    }
+    #else
+    fprintf(stderr, "Memory accounting is implemented for HASH_TABLE_ARCH == 2 only\n");
+    #endif
+}
+
+#if HASH_TABLE_ARCH == 2
+typedef struct {
+    hashTable_t         *original;
+    hashTableReplicas_t *replicas;
+    text_t               requests;
+    int                  cpu;           ///< Cpu reader was running on
+    double               originalNs;    ///< Per lookup
+    double               replicaNs;
+} numaReaderTask_t;
+
+/// @brief Time per lookup of requests in table, or in local replica if table is NULL
+static double numaLookupNs(hashTable_t *table, hashTableReplicas_t *replicas, text_t requests) {
+    codeClock_t clock;
+    int64_t found = 0;
+    MEASURE_TIME(clock,
+        for (int64_t idx = 0; idx < requests.wordsCount; idx++)
+            found += (table ? hashTableFind(table, requests.words[idx])
+                            : hashTableReplicasFind(replicas, requests.words[idx])) != NULL;
+    )
+    assert(found == requests.wordsCount);
+
+    return (double) clock.elapsed * NSEC_PER_MCS / (double) requests.wordsCount;
+}
+
+/// Original and replica are measured in turns, best of NUMA_TEST_ROUNDS is kept as in testPolicies
+static void *numaReader(void *arg) {
+    numaReaderTask_t *task = (numaReaderTask_t *) arg;
+    task->cpu = sched_getcpu();
+
+    for (int round = 0; round < NUMA_TEST_ROUNDS; round++) {
+        const double originalNs = numaLookupNs(task->original, task->replicas, task->requests);
+        const double replicaNs  = numaLookupNs(NULL, task->replicas, task->requests);
+        if (round == 0 || originalNs < task->originalNs) task->originalNs = originalNs;
+        if (round == 0 || replicaNs  < task->replicaNs)  task->replicaNs  = replicaNs;
+    }
+
+    return NULL;
+}
+#endif
+
+void testNumaReplicas() {
+    #if HASH_TABLE_ARCH == 2
+    // Vocabulary is the beginning of the text data (see generateRandomText), requests are uniform over it
+    text_t requests = generateRandomText(NUMA_TEST_REQUESTS, NUMA_TEST_VOCABULARY, 0x4E0A);
+    assert(requests.words);
+
+    hashTable_t original = {};
+    hashTableCtor(&original, sizeof(int), (size_t) NUMA_TEST_VOCABULARY / NUMA_TEST_LOAD_FACTOR);
+    for (int64_t idx = 0; idx < NUMA_TEST_VOCABULARY; idx++)
+        hashTableAccess(&original, requests.data + idx * (int64_t) SMALL_STR_LEN);
+
+    codeClock_t clock;
+    hashTableReplicas_t replicas = {};
+    MEASURE_TIME(clock,
+        hashTableReplicasCtor(&replicas, &original);
+    )
+    const numaTopology_t *topology = &replicas.topology;
+
+    fprintf(stderr, "Vocabulary: %jd, load factor: %zu, requests: %jd, %s topology of %d nodes\n",
+            NUMA_TEST_VOCABULARY, NUMA_TEST_LOAD_FACTOR, NUMA_TEST_REQUESTS, topology->fake ? "fake" : "system",
+            topology->nodesCount);
+    fprintf(stderr, "Original table is on node %d, replicas are built in %.1f million ticks\n",
+            numaMemoryNode(original.buckets), (double) (clock.clocksEnd - clock.clocksStart) / 1e6);
+    fprintf(stderr, "%6s %6s %12s %14s %14s\n", "node", "cpu", "replica on", "original, ns", "replica, ns");
+
+    for (int node = 0; node < topology->nodesCount; node++) {
+        numaReaderTask_t task = {&original, &replicas, requests, -1, 0, 0};
+        pthread_t thread;
+        if (!numaStartOnNode(topology, node, numaReader, &task, &thread))
+            continue;
+        pthread_join(thread, NULL);
+
+        fprintf(stderr, "%6d %6d %12d %14.2f %14.2f\n", topology->nodeIds[node], task.cpu,
+                numaMemoryNode(replicas.replicas[node].buckets), task.originalNs, task.replicaNs);
+    }
+
+    hashTableReplicasDtor(&replicas);
+    hashTableDtor(&original);
+    textDtor(&requests);
+    #else
+    fprintf(stderr, "Replicas are implemented for HASH_TABLE_ARCH == 2 only\n");
+    #endif
+}
+
+typedef struct {
+    int64_t lookups;
+    size_t  keysSum;
+    size_t  keysMax;
+    size_t  linesSum;
+    size_t  linesMax;
+} probeSummary_t;
+
+static void probeKeys(hashTablePolicy_t *policy, void *table, char **keys, int64_t count, bool hits, uint64_t overhead,
+                      probeSummary_t *summary, latencyHistogram_t *hist) {
+    for (int64_t idx = 0; idx < count; idx++) {
+        hashTableProbe_t probe = {};
+        policy->probeCost(table, keys[idx], &probe);
+        // Random words may happen to be in the corpus, they are neither hits nor misses here
+        if (probe.found != hits)
+            continue;
+
+        summary->lookups++;
+        summary->keysSum  += probe.keysCompared;
+        summary->linesSum += probe.cacheLines;
+        if (probe.keysCompared > summary->keysMax) summary->keysMax = probe.keysCompared;
+        if (probe.cacheLines   > summary->linesMax) summary->linesMax = probe.cacheLines;
+
+        const uint64_t start = latencyStart();
+        void *value = policy->find(table, keys[idx]);
+        const uint64_t end = latencyStop();
+        (void) value;
+        recordLatency(hist, 0, start, end, overhead);
+    }
+}
+
+static int64_t countUniqueWords(text_t words) {
+    hashTable_t ht = {};
+    hashTableCtor(&ht, 0, HASH_TABLE_SIZE);
+    for (int64_t idx = 0; idx < words.wordsCount; idx++)
+        hashTableAccess(&ht, words.words[idx]);
+
+    const int64_t unique = (int64_t) ht.size;
+    hashTableDtor(&ht);
+    return unique;
+}
+
+void testProbeCost() {
+    static const char *const CORPORA[][2] = {{"shakespeare", "shakespeare.txt"}, {"tolkien", "tolkien.txt"}};
+    static const char *const POLICIES[] = {"v2_all", "v3_cuckoo", "v3_cuckoo8"};
+
+    const int cpu = benchPinThread(-1);
+    const uint64_t overhead = latencyCalibrate(LATENCY_CALIBRATION_SAMPLES);
+    text_t misses = generateRandomText(PROBE_TEST_MISSES, PROBE_TEST_MISSES, 0xC0C0);
+
+    fprintf(stderr, "CPU: %d, overhead of timing: %ju ticks (subtracted), v2 has one bucket per key, "
+                    "cuckoo tables grow from %d buckets\n", cpu, overhead, HASH_TABLE_SIZE);
+    fprintf(stderr, "%-12s %-12s %-5s %9s %9s %9s %9s %9s %8s %8s %8s %9s\n", "corpus", "policy", "kind", "lookups",
+            "keys avg", "keys max", "lines avg", "lines max", "p50", "p99", "p99.9", "max");
+
+    for (size_t corpusIdx = 0; corpusIdx < sizeof(CORPORA) / sizeof(CORPORA[0]); corpusIdx++) {
+        text_t words = readCorpusAligned(CORPORA[corpusIdx][1]);
+        if (!words.wordsCount) {
+            fprintf(stderr, "Skipping corpus %s\n", CORPORA[corpusIdx][0]);
+            continue;
+        }
+        const int64_t unique = countUniqueWords(words);
+
+        for (size_t policyIdx = 0; policyIdx < sizeof(POLICIES) / sizeof(POLICIES[0]); policyIdx++) {
+            hashTablePolicy_t *policy = hashTablePolicies();
+            while (policy && strcmp(policy->name, POLICIES[policyIdx]) != 0)
+                policy = policy->next;
+            if (!policy) {
+                fprintf(stderr, "Policy %s is not linked\n", POLICIES[policyIdx]);
+                continue;
+            }
+
+            // Load factor 1 is what hashTableReserve gives v2, cuckoo table keeps its load itself
+            const bool cuckoo = strncmp(policy->name, "v3_", 3) == 0;
+            void *table = policy->ctor(sizeof(int), cuckoo ? (size_t) HASH_TABLE_SIZE : (size_t) unique);
+            assert(table);
+            policy->accessAll(table, words.words, words.wordsCount);
+
+            for (int kind = 0; kind < 2; kind++) {
+                const bool hits = (kind == 0);
+                probeSummary_t summary = {};
+                latencyHistogram_t *hist = (latencyHistogram_t *) calloc(1, sizeof(latencyHistogram_t));
+                assert(hist);
+
+                if (hits)
+                    probeKeys(policy, table, words.words, words.wordsCount, true, overhead, &summary, hist);
+                else
+                    probeKeys(policy, table, misses.words, misses.wordsCount, false, overhead, &summary, hist);
+
+                const double lookups = (double) (summary.lookups ? summary.lookups : 1);
+                fprintf(stderr, "%-12s %-12s %-5s %9jd %9.2f %9zu %9.2f %9zu %8ju %8ju %8ju %9ju\n",
+                        CORPORA[corpusIdx][0], policy->name, hits ? "hit" : "miss", summary.lookups,
+                        (double) summary.keysSum / lookups, summary.keysMax,
+                        (double) summary.linesSum / lookups, summary.linesMax,
+                        latencyPercentile(hist, 50), latencyPercentile(hist, 99),
+                        latencyPercentile(hist, 99.9), hist->max);
+                free(hist);
+            }
+
+            policy->dtor(table);
+        }
+
+        textDtor(&words);
+    }
+
+    textDtor(&misses);
+}
+
+/* Keys that all fall into one bucket of v2 table: lookups in plain and in sorted overflow array.
+   Keys are picked from random words by the hash of the default build, which v2 policies share,
+   except v2_seededHash: its random seed spreads them over all buckets */
+void testCollisions() {
+    static const char *const POLICIES[] = {"v2_all", "v2_unsorted", "v2_seededHash"};
+
+    // Only the vocabulary of random words is used, it's the beginning of the text data
+    text_t candidates = generateRandomText(1, COLLISION_TEST_CANDIDATES, 0xC011);
+    assert(candidates.data);
+
+    // Short random words repeat, duplicates are dropped with the help of a table
+    hashTable_t unique = {};
+    hashTableCtor(&unique, 0, HASH_TABLE_SIZE);
+    const int64_t collidingNeeded = 2 * COLLISION_TEST_KEYS;
+    char **colliding = (char **) calloc((size_t) collidingNeeded, sizeof(char *));
+    assert(colliding);
+
+    int64_t collidingCount = 0;
+    for (int64_t idx = 0; idx < COLLISION_TEST_CANDIDATES && collidingCount < collidingNeeded; idx++) {
+        char *word = candidates.data + idx * (int64_t) SMALL_STR_LEN;
+        if (_HASH_FUNC(word) % COLLISION_TEST_BUCKETS != 0)
+            continue;
+
+        const size_t sizeBefore = unique.size;
+        hashTableAccess(&unique, word);
+        if (unique.size != sizeBefore)
+            colliding[collidingCount++] = word;
+    }
+    hashTableDtor(&unique);
+
+    // First half is inserted, second half is looked up as misses
+    const int64_t keysCount = collidingCount / 2;
+    char **hits = colliding, **misses = colliding + keysCount;
+    fprintf(stderr, "Keys in one bucket of %zu: %jd, misses: %jd, sorted from %d overflow nodes\n",
+            COLLISION_TEST_BUCKETS, keysCount, collidingCount - keysCount, BUCKET_SORT_THRESHOLD);
+    fprintf(stderr, "%-14s %10s %12s %12s %10s %10s\n", "policy", "build, ms", "ticks/hit", "ticks/miss",
+            "keys/hit", "keys/miss");
+
+    for (size_t policyIdx = 0; policyIdx < sizeof(POLICIES) / sizeof(POLICIES[0]); policyIdx++) {
+        hashTablePolicy_t *policy = hashTablePolicies();
+        while (policy && strcmp(policy->name, POLICIES[policyIdx]) != 0)
+            policy = policy->next;
+        if (!policy) {
+            fprintf(stderr, "Policy %s is not linked\n", POLICIES[policyIdx]);
+            continue;
+        }
+
+        double bestBuildMs = 0, bestHitTicks = 0, bestMissTicks = 0;
+        for (int round = 0; round < POLICY_ROUNDS; round++) {
+            void *table = policy->ctor(sizeof(int), COLLISION_TEST_BUCKETS);
+            assert(table);
+
+            codeClock_t clock;
+            MEASURE_TIME(clock,
+                policy->accessAll(table, hits, keysCount);
+            )
+            const double buildMs = codeClockGetTimeMs(&clock);
+
+            int64_t found = 0;
+            MEASURE_TIME(clock,
+                found = policy->findAll(table, hits, keysCount);
+            )
+            assert(found == keysCount);
+            const double hitTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) keysCount;
+
+            MEASURE_TIME(clock,
+                found = policy->findAll(table, misses, collidingCount - keysCount);
+            )
+            assert(found == 0);
+            const double missTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) (collidingCount - keysCount);
+
+            if (round == 0 || buildMs   < bestBuildMs)   bestBuildMs   = buildMs;
+            if (round == 0 || hitTicks  < bestHitTicks)  bestHitTicks  = hitTicks;
+            if (round == 0 || missTicks < bestMissTicks) bestMissTicks = missTicks;
+
+            if (round == POLICY_ROUNDS - 1) {
+                size_t hitKeys = 0, missKeys = 0;
+                for (int64_t idx = 0; idx < keysCount; idx++) {
+                    hashTableProbe_t probe = {};
+                    policy->probeCost(table, hits[idx], &probe);
+                    hitKeys += probe.keysCompared;
+                    policy->probeCost(table, misses[idx], &probe);
+                    missKeys += probe.keysCompared;
+                }
+                fprintf(stderr, "%-14s %10.2f %12.2f %12.2f %10.2f %10.2f\n", policy->name, bestBuildMs, bestHitTicks,
+                        bestMissTicks, (double) hitKeys / (double) keysCount, (double) missKeys / (double) keysCount);
+            }
+
+            policy->dtor(table);
+        }
+    }
+
+    free(colliding);
+    textDtor(&candidates);
+}
+
+/* Counting words with interned IDs and dense array of counters against counters stored in the table.
+   Counts of every word are compared, and every key is found again by its ID */
+void testInterning(const char *stringsFile) {
+    #if HASH_TABLE_ARCH == 2
+    text_t words = readFileSplitAligned(stringsFile);
+    int *counts = (int *) calloc((size_t) words.wordsCount, sizeof(int));
+    assert(counts);
+
+    double bestTableMs = 0, bestInternMs = 0, bestByIdMs = 0;
+    for (int round = 0; round < POLICY_ROUNDS; round++) {
+        codeClock_t clock;
+
+        hashTable_t ht = {};
+        hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+        MEASURE_TIME(clock,
+            for (int64_t idx = 0; idx < words.wordsCount; idx++)
+                (*(int *) hashTableAccess(&ht, words.words[idx]))++;
+        )
+        const double tableMs = codeClockGetTimeMs(&clock);
+
+        hashTableInterner_t interner = {};
+        hashTableInternerCtor(&interner, HASH_TABLE_SIZE);
+        memset(counts, 0, (size_t) words.wordsCount * sizeof(int));
+        MEASURE_TIME(clock,
+            for (int64_t idx = 0; idx < words.wordsCount; idx++)
+                counts[hashTableIntern(&interner, words.words[idx])]++;
+        )
+        const double internMs = codeClockGetTimeMs(&clock);
+
+        size_t keysBytes = 0;
+        MEASURE_TIME(clock,
+            for (int64_t idx = 0; idx < words.wordsCount; idx++)
+                keysBytes += hashTableKeyLengthById(&interner, (uint32_t) (idx % interner.count));
+        )
+        const double byIdMs = codeClockGetTimeMs(&clock);
+
+        assert(interner.count == ht.size);
+        for (uint32_t id = 0; id < interner.count; id++) {
+            const char *key = hashTableKeyById(&interner, id);
+            const int *count = (const int *) hashTableFind(&ht, key);
+            if (!count || *count != counts[id] || hashTableInternFind(&interner, key) != id)
+                fprintf(stderr, "Wrong count or ID of key \"%s\"\n", key);
+        }
+
+        if (round == 0 || tableMs  < bestTableMs)  bestTableMs  = tableMs;
+        if (round == 0 || internMs < bestInternMs) bestInternMs = internMs;
+        if (round == 0 || byIdMs   < bestByIdMs)   bestByIdMs   = byIdMs;
+        // Sum is printed, so the loop over IDs is not optimized out
+        if (round == POLICY_ROUNDS - 1)
+            fprintf(stderr, "Words: %jd, unique: %u, average length of key by ID: %.2f\n", words.wordsCount,
+                    interner.count, (double) keysBytes / (double) words.wordsCount);
+
+        hashTableInternerDtor(&interner);
+        hashTableDtor(&ht);
+    }
+
+    fprintf(stderr, "%-32s %10s %10s\n", "counting", "time, ms", "ns/word");
+    fprintf(stderr, "%-32s %10.2f %10.2f\n", "counters in table (access)", bestTableMs,
+            bestTableMs * 1e6 / (double) words.wordsCount);
+    fprintf(stderr, "%-32s %10.2f %10.2f\n", "intern + dense array", bestInternMs,
+            bestInternMs * 1e6 / (double) words.wordsCount);
+    fprintf(stderr, "%-32s %10.2f %10.2f\n", "key by ID", bestByIdMs,
+            bestByIdMs * 1e6 / (double) words.wordsCount);
+
+    free(counts);
+    textDtor(&words);
+    #else
+    (void) stringsFile;
+    fprintf(stderr, "Interning is implemented for HASH_TABLE_ARCH == 2 only\n");
+    #endif
+}
+
+/*! @brief Text of every key in its own aligned block, padded with zeros as ALIGNED_KEYS requires.
+    Keys are written in base 32: up to 13 chars, so they are short keys. Decimal text of random 64-bit keys
+    takes up to 20 chars, and all such keys would share the single array of long keys */
+static char **encodeIntKeys(const uint64_t *keys, int64_t count, char **buffer) {
+    static const char DIGITS[] = "0123456789abcdefghijklmnopqrstuv";
+    const size_t base = sizeof(DIGITS) - 1;
+
+    *buffer = (char *) aligned_alloc(KEY_ALIGNMENT, (size_t) count * SMALL_STR_LEN);
+    char **strings = (char **) calloc((size_t) count, sizeof(char *));
+    assert(*buffer && strings);
+    memset(*buffer, 0, (size_t) count * SMALL_STR_LEN);
+
+    for (int64_t idx = 0; idx < count; idx++) {
+        strings[idx] = *buffer + (size_t) idx * SMALL_STR_LEN;
+        size_t len = 0;
+        for (uint64_t key = keys[idx]; key || len == 0; key /= base)
+            strings[idx][len++] = DIGITS[key % base];
+    }
+
+    return strings;
+}
+
+/* Integer keys in hashTableInt against the same keys encoded as strings in hashTable.
+   Strings are encoded before measurement, so the string table isn't charged for encoding */
+void testIntKeys() {
+    static const char *const KINDS[] = {"random", "sequential"};
+
+    uint64_t *keys   = (uint64_t *) calloc((size_t) INT_TEST_KEYS, sizeof(uint64_t));
+    uint64_t *hits   = (uint64_t *) calloc((size_t) INT_TEST_KEYS, sizeof(uint64_t));
+    uint64_t *misses = (uint64_t *) calloc((size_t) INT_TEST_KEYS, sizeof(uint64_t));
+    assert(keys && hits && misses);
+
+    fprintf(stderr, "Keys: %jd, hits and misses: %jd each\n", INT_TEST_KEYS, INT_TEST_KEYS);
+    fprintf(stderr, "%-12s %-10s %10s %12s %12s\n", "keys", "table", "build, ms", "ticks/hit", "ticks/miss");
+
+    for (size_t kind = 0; kind < sizeof(KINDS) / sizeof(KINDS[0]); kind++) {
+        uint64_t state = 0x1D5 + kind;
+        for (int64_t idx = 0; idx < INT_TEST_KEYS; idx++) {
+            keys[idx]   = kind ? (uint64_t) idx + 1 : xorshiftNext(&state);
+            misses[idx] = kind ? (uint64_t) (INT_TEST_KEYS + idx) + 1 : xorshiftNext(&state);
+        }
+        for (int64_t idx = 0; idx < INT_TEST_KEYS; idx++)
+            hits[idx] = keys[xorshiftNext(&state) % (uint64_t) INT_TEST_KEYS];
+
+        char *keysText = NULL, *hitsText = NULL, *missesText = NULL;
+        char **keyStrings  = encodeIntKeys(keys,   INT_TEST_KEYS, &keysText);
+        char **hitStrings  = encodeIntKeys(hits,   INT_TEST_KEYS, &hitsText);
+        char **missStrings = encodeIntKeys(misses, INT_TEST_KEYS, &missesText);
+
+        double intBuild = 0, intHit = 0, intMiss = 0, strBuild = 0, strHit = 0, strMiss = 0;
+        for (int round = 0; round < POLICY_ROUNDS; round++) {
+            codeClock_t clock;
+            int64_t found = 0;
+
+            hashTableInt_t intTable = {};
+            hashTableIntCtor(&intTable, sizeof(int), (size_t) INT_TEST_KEYS / RESERVE_LOAD_FACTOR);
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < INT_TEST_KEYS; idx++)
+                    (*(int *) hashTableIntAccess(&intTable, keys[idx]))++;
+            )
+            const double intBuildMs = codeClockGetTimeMs(&clock);
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < INT_TEST_KEYS; idx++)
+                    found += hashTableIntFind(&intTable, hits[idx]) != NULL;
+            )
+            const double intHitTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) INT_TEST_KEYS;
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < INT_TEST_KEYS; idx++)
+                    found += hashTableIntFind(&intTable, misses[idx]) != NULL;
+            )
+            const double intMissTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) INT_TEST_KEYS;
+            assert(found == INT_TEST_KEYS);
+            assert(hashTableIntVerify(&intTable) == HT_SUCCESS);
+            hashTableIntDtor(&intTable);
+
+            found = 0;
+            hashTable_t strTable = {};
+            hashTableCtor(&strTable, sizeof(int), (size_t) INT_TEST_KEYS / RESERVE_LOAD_FACTOR);
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < INT_TEST_KEYS; idx++)
+                    (*(int *) hashTableAccess(&strTable, keyStrings[idx]))++;
+            )
+            const double strBuildMs = codeClockGetTimeMs(&clock);
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < INT_TEST_KEYS; idx++)
+                    found += hashTableFind(&strTable, hitStrings[idx]) != NULL;
+            )
+            const double strHitTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) INT_TEST_KEYS;
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < INT_TEST_KEYS; idx++)
+                    found += hashTableFind(&strTable, missStrings[idx]) != NULL;
+            )
+            const double strMissTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) INT_TEST_KEYS;
+            assert(found == INT_TEST_KEYS);
+            hashTableDtor(&strTable);
+
+            if (round == 0 || intBuildMs   < intBuild) intBuild = intBuildMs;
+            if (round == 0 || intHitTicks  < intHit)   intHit   = intHitTicks;
+            if (round == 0 || intMissTicks < intMiss)  intMiss  = intMissTicks;
+            if (round == 0 || strBuildMs   < strBuild) strBuild = strBuildMs;
+            if (round == 0 || strHitTicks  < strHit)   strHit   = strHitTicks;
+            if (round == 0 || strMissTicks < strMiss)  strMiss  = strMissTicks;
+        }
+
+        fprintf(stderr, "%-12s %-10s %10.2f %12.2f %12.2f\n", KINDS[kind], "integer", intBuild, intHit, intMiss);
+        fprintf(stderr, "%-12s %-10s %10.2f %12.2f %12.2f\n", KINDS[kind], "string", strBuild, strHit, strMiss);
+
+        free(keyStrings);
+        free(hitStrings);
+        free(missStrings);
+        free(keysText);
+        free(hitsText);
+        free(missesText);
+    }
+
+    free(keys);
+    free(hits);
+    free(misses);
+}
+
+#if HASH_TABLE_ARCH == 2
+/* Word count of one text in table of HASH_TABLE_SIZE buckets (long buckets, as in other tests) and in table
+   reserved for its unique words: counter accessed by hashTableAccess and incremented through returned pointer,
+   hashTableIncrement and hashTableIncrementBatch over all words. Counts are compared */
+static void incrementText(const char *name, text_t words) {
+    static const char *const METHODS[] = {"access + increment", "hashTableIncrement", "hashTableIncrementBatch"};
+    const size_t methodsCount = sizeof(METHODS) / sizeof(METHODS[0]);
+    const size_t reserved[] = {0, (size_t) countUniqueWords(words)};
+
+    for (size_t reserveIdx = 0; reserveIdx < sizeof(reserved) / sizeof(reserved[0]); reserveIdx++) {
+        double bestMs[sizeof(METHODS) / sizeof(METHODS[0])] = {};
+        size_t bucketsCount = 0;
+
+        for (int round = 0; round < POLICY_ROUNDS; round++) {
+            hashTable_t tables[sizeof(METHODS) / sizeof(METHODS[0])] = {};
+            double ms[sizeof(METHODS) / sizeof(METHODS[0])] = {};
+            codeClock_t clock;
+
+            for (size_t method = 0; method < methodsCount; method++) {
+                hashTableCtor(tables + method, sizeof(hashTableCounter_t), HASH_TABLE_SIZE);
+                hashTableReserve(tables + method, reserved[reserveIdx]);
+            }
+            bucketsCount = tables[0].bucketsCount;
+
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < words.wordsCount; idx++)
+                    (*(hashTableCounter_t *) hashTableAccess(tables, words.words[idx]))++;
+            )
+            ms[0] = codeClockGetTimeMs(&clock);
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < words.wordsCount; idx++)
+                    hashTableIncrement(tables + 1, words.words[idx], 1);
+            )
+            ms[1] = codeClockGetTimeMs(&clock);
+            MEASURE_TIME(clock,
+                hashTableIncrementBatch(tables + 2, (const char *const *) words.words, (size_t) words.wordsCount, 1);
+            )
+            ms[2] = codeClockGetTimeMs(&clock);
+
+            for (int64_t idx = 0; idx < words.wordsCount; idx++) {
+                const hashTableCounter_t expected = *(hashTableCounter_t *) hashTableFind(tables, words.words[idx]);
+                for (size_t method = 1; method < methodsCount; method++) {
+                    const hashTableCounter_t *count = (const hashTableCounter_t *) hashTableFind(tables + method,
+                                                                                                  words.words[idx]);
+                    if (!count || *count != expected)
+                        fprintf(stderr, "%s: wrong count of \"%s\"\n", METHODS[method], words.words[idx]);
+                }
+            }
+
+            for (size_t method = 0; method < methodsCount; method++) {
+                if (round == 0 || ms[method] < bestMs[method])
+                    bestMs[method] = ms[method];
+                hashTableDtor(tables + method);
+            }
+        }
+
+        for (size_t method = 0; method < methodsCount; method++)
+            fprintf(stderr, "%-12s %9zu %-24s %10.2f %10.2f\n", name, bucketsCount, METHODS[method], bestMs[method],
+                    bestMs[method] * 1e6 / (double) words.wordsCount);
+    }
+}
+#endif
+
+/* Word count on corpora and on Zipf-distributed text with big vocabulary, whose table doesn't fit in cache */
+void testIncrement() {
+    #if HASH_TABLE_ARCH == 2
+    static const char *const CORPORA[][2] = {{"shakespeare", "shakespeare.txt"}, {"tolkien", "tolkien.txt"}};
+
+    fprintf(stderr, "%-12s %9s %-24s %10s %10s\n", "text", "buckets", "counting", "time, ms", "ns/word");
+
+    for (size_t corpusIdx = 0; corpusIdx < sizeof(CORPORA) / sizeof(CORPORA[0]); corpusIdx++) {
+        text_t words = readCorpusAligned(CORPORA[corpusIdx][1]);
+        if (!words.wordsCount) {
+            fprintf(stderr, "Skipping corpus %s\n", CORPORA[corpusIdx][0]);
+            continue;
+        }
+        incrementText(CORPORA[corpusIdx][0], words);
+        textDtor(&words);
+    }
+
+    text_t zipf = generateZipfText(SKEW_TEST_REQUESTS, SKEW_TEST_VOCABULARY, SKEW_TEST_EXPONENT, 0x21BF);
+    assert(zipf.words);
+    incrementText("zipf", zipf);
+    textDtor(&zipf);
+    #else
+    fprintf(stderr, "Counters are implemented for HASH_TABLE_ARCH == 2 only\n");
+    #endif
+}
+
+#if HASH_TABLE_ARCH == 2
+typedef struct {
+    size_t   valSize;
+    uint64_t serial;            ///< Number of values created so far
+} emplaceValue_t;
+
+/// @brief Value of the serial-th new key: its words are serial, serial + 1, ...
+static void fillEmplaceValue(void *value, void *ctx) {
+    emplaceValue_t *creator = (emplaceValue_t *) ctx;
+    // ctx is read once: stores into value may alias it, so reading it in the loop would reload it every word
+    const uint64_t serial = creator->serial;
+    const size_t   words  = creator->valSize / sizeof(uint64_t);
+    for (size_t idx = 0; idx < words; idx++)
+        ((uint64_t *) value)[idx] = serial + idx;
+    creator->serial = serial + 1;
+}
+
+static const char *const EMPLACE_METHODS[] = {"find + insert", "access + fill", "hashTableEmplace"};
+
+/// @brief Get value of every key, creating missing ones by method (index in EMPLACE_METHODS)
+/// @return Sum of first and last words of values, so values are read and can be compared between methods
+static uint64_t emplaceKeys(size_t method, hashTable_t *ht, char **keys, int64_t count, emplaceValue_t *creator) {
+    uint64_t temporary[EMPLACE_TEST_MAX_VALUE / sizeof(uint64_t)];
+    const size_t lastWord = creator->valSize / sizeof(uint64_t) - 1;
+    uint64_t sum = 0;
+
+    for (int64_t idx = 0; idx < count; idx++) {
+        const uint64_t *value = NULL;
+        if (method == 0) {
+            value = (const uint64_t *) hashTableFind(ht, keys[idx]);
+            if (!value) {
+                fillEmplaceValue(temporary, creator);
+                hashTableInsert(ht, keys[idx], temporary);
+                value = temporary;
+            }
+        } else if (method == 1) {
+            const size_t sizeBefore = ht->size;
+            void *accessed = hashTableAccess(ht, keys[idx]);
+            if (ht->size != sizeBefore)
+                fillEmplaceValue(accessed, creator);
+            value = (const uint64_t *) accessed;
+        } else {
+            value = (const uint64_t *) hashTableEmplace(ht, keys[idx], fillEmplaceValue, creator);
+        }
+        sum += value[0] + value[lastWord];
+    }
+
+    return sum;
+}
+#endif
+
+/* Get-or-create of big values: value of new key is built only once, existing value is returned as is.
+   Values are built in temporary and inserted after missed find, filled in place after access that inserted
+   zeroed value, or written by initializer of hashTableEmplace. Every key of the vocabulary is got twice:
+   first time it is new, second time it exists. Sums of values must be the same for all methods */
+void testEmplace() {
+    #if HASH_TABLE_ARCH == 2
+    const size_t methodsCount = sizeof(EMPLACE_METHODS) / sizeof(EMPLACE_METHODS[0]);
+    const size_t valSizes[] = {64, EMPLACE_TEST_MAX_VALUE};
+
+    // Words of the vocabulary follow each other in aligned blocks, the text itself isn't used
+    text_t text = generateRandomText(1, EMPLACE_TEST_KEYS, 0xE3B1);
+    char **keys = (char **) calloc((size_t) EMPLACE_TEST_KEYS, sizeof(char *));
+    assert(text.data && keys);
+    for (int64_t idx = 0; idx < EMPLACE_TEST_KEYS; idx++)
+        keys[idx] = text.data + idx * (int64_t) SMALL_STR_LEN;
+
+    fprintf(stderr, "Keys: %jd, buckets: %jd\n", EMPLACE_TEST_KEYS, EMPLACE_TEST_KEYS / RESERVE_LOAD_FACTOR);
+    fprintf(stderr, "%-6s %-18s %14s %14s\n", "value", "get-or-create", "new, ns/key", "found, ns/key");
+
+    for (size_t valIdx = 0; valIdx < sizeof(valSizes) / sizeof(valSizes[0]); valIdx++) {
+        const size_t valSize = valSizes[valIdx];
+        double bestNew[sizeof(EMPLACE_METHODS) / sizeof(EMPLACE_METHODS[0])]   = {};
+        double bestFound[sizeof(EMPLACE_METHODS) / sizeof(EMPLACE_METHODS[0])] = {};
+        uint64_t sums[sizeof(EMPLACE_METHODS) / sizeof(EMPLACE_METHODS[0])]    = {};
+
+        for (int round = 0; round < POLICY_ROUNDS; round++) {
+            for (size_t step = 0; step < methodsCount; step++) {
+                // Order of methods is rotated, so none of them always runs on the heap freed by the same one
+                const size_t method = (step + (size_t) round) % methodsCount;
+                hashTable_t ht = {};
+                hashTableCtor(&ht, valSize, (size_t) EMPLACE_TEST_KEYS / RESERVE_LOAD_FACTOR);
+                emplaceValue_t creator = {valSize, 0};
+                codeClock_t clock;
+
+                MEASURE_TIME(clock,
+                    sums[method] = emplaceKeys(method, &ht, keys, EMPLACE_TEST_KEYS, &creator);
+                )
+                const double newNs = codeClockGetTimeMs(&clock) * 1e6 / (double) EMPLACE_TEST_KEYS;
+                MEASURE_TIME(clock,
+                    sums[method] += emplaceKeys(method, &ht, keys, EMPLACE_TEST_KEYS, &creator);
+                )
+                const double foundNs = codeClockGetTimeMs(&clock) * 1e6 / (double) EMPLACE_TEST_KEYS;
+
+                if (round == 0 || newNs   < bestNew[method])   bestNew[method]   = newNs;
+                if (round == 0 || foundNs < bestFound[method]) bestFound[method] = foundNs;
+
+                hashTableDtor(&ht);
+            }
+        }
+
+        for (size_t method = 0; method < methodsCount; method++) {
+            fprintf(stderr, "%-6zu %-18s %14.2f %14.2f\n", valSize, EMPLACE_METHODS[method], bestNew[method],
+                    bestFound[method]);
+            if (sums[method] != sums[0])
+                fprintf(stderr, "%s: wrong values\n", EMPLACE_METHODS[method]);
+        }
+    }
+
+    free(keys);
+    textDtor(&text);
+    #else
+    fprintf(stderr, "Emplace is implemented for HASH_TABLE_ARCH == 2 only\n");
+    #endif
+}
+
+/* Membership of requests in words of stringsFile: table with int values (as in testPerformance) against
+   set with key-only nodes, both with HASH_TABLE_SIZE buckets (long buckets) and reserved for unique words.
+   Table is looked up by hashTableFind, set by hashTableContains and hashTableContainsBatch */
+void testSet(const char *stringsFile, const char *requestsFile) {
+    #if HASH_TABLE_ARCH == 2
+    static const char *const METHODS[] = {"table: find", "set: contains", "set: contains batch"};
+    const size_t methodsCount = sizeof(METHODS) / sizeof(METHODS[0]);
+
+    text_t words    = readFileSplitAligned(stringsFile);
+    text_t requests = readFileSplitAligned(requestsFile);
+    bool *found = (bool *) calloc((size_t) requests.wordsCount, sizeof(bool));
+    assert(found);
+
+    const size_t uniqueWords = (size_t) countUniqueWords(words);
+
+    fprintf(stderr, "Unique words: %zu, requests: %jd x %d\n", uniqueWords, requests.wordsCount, TEST_LOOPS);
+    fprintf(stderr, "Node: %zu bytes in table, %zu bytes in set\n", sizeof(hashTableNode_t), sizeof(hashTableSetNode_t));
+    fprintf(stderr, "%8s %-20s %10s %10s %12s\n", "buckets", "lookup", "bytes/key", "build, ms", "ticks/lookup");
+
+    for (int reserve = 0; reserve < 2; reserve++) {
+        size_t bucketsCounts[sizeof(METHODS) / sizeof(METHODS[0])] = {};
+        double bestBuild[sizeof(METHODS) / sizeof(METHODS[0])]  = {};
+        double bestLookup[sizeof(METHODS) / sizeof(METHODS[0])] = {};
+        double bytesPerKey[sizeof(METHODS) / sizeof(METHODS[0])] = {};
+        int64_t totalFound[sizeof(METHODS) / sizeof(METHODS[0])] = {};
+
+        for (int round = 0; round < POLICY_ROUNDS; round++) {
+            for (size_t method = 0; method < methodsCount; method++) {
+                hashTable_t    ht  = {};
+                hashTableSet_t set = {};
+                codeClock_t clock;
+                int64_t foundCount = 0;
+
+                // Build is the same for both set methods, it's measured for each of them anyway
+                if (method == 0) {
+                    hashTableCtor(&ht, sizeof(int), HASH_TABLE_SIZE);
+                    if (reserve)
+                        hashTableReserve(&ht, uniqueWords);
+                    bucketsCounts[method] = ht.bucketsCount;
+                    MEASURE_TIME(clock,
+                        for (int64_t idx = 0; idx < words.wordsCount; idx++)
+                            hashTableAccess(&ht, words.words[idx]);
+                    )
+                    hashTableMemory_t usage = {};
+                    hashTableMemoryUsage(&ht, &usage);
+                    bytesPerKey[method] = (double) usage.total / (double) ht.size;
+                } else {
+                    hashTableSetCtor(&set, HASH_TABLE_SIZE);
+                    if (reserve)
+                        hashTableSetReserve(&set, uniqueWords);
+                    bucketsCounts[method] = set.bucketsCount;
+                    MEASURE_TIME(clock,
+                        for (int64_t idx = 0; idx < words.wordsCount; idx++)
+                            hashTableSetInsert(&set, words.words[idx], NULL);
+                    )
+                    bytesPerKey[method] = (double) hashTableSetMemoryUsage(&set) / (double) set.size;
+                    assert(hashTableSetVerify(&set) == HT_SUCCESS);
+                }
+                const double buildMs = codeClockGetTimeMs(&clock);
+
+                MEASURE_TIME(clock,
+                    for (int loop = 0; loop < TEST_LOOPS; loop++) {
+                        if (method == 0) {
+                            for (int64_t idx = 0; idx < requests.wordsCount; idx++)
+                                foundCount += hashTableFind(&ht, requests.words[idx]) != NULL;
+                        } else if (method == 1) {
+                            for (int64_t idx = 0; idx < requests.wordsCount; idx++)
+                                foundCount += hashTableContains(&set, requests.words[idx]);
+                        } else {
+                            foundCount += (int64_t) hashTableContainsBatch(&set, requests.words,
+                                                                           (size_t) requests.wordsCount, found);
+                        }
+                    }
+                )
+                const double lookupTicks = (double) (clock.clocksEnd - clock.clocksStart) /
+                                           (double) (requests.wordsCount * TEST_LOOPS);
+
+                if (round == 0 || buildMs     < bestBuild[method])  bestBuild[method]  = buildMs;
+                if (round == 0 || lookupTicks < bestLookup[method]) bestLookup[method] = lookupTicks;
+                totalFound[method] = foundCount;
+
+                if (method == 0)
+                    hashTableDtor(&ht);
+                else
+                    hashTableSetDtor(&set);
+            }
+        }
+
+        for (size_t method = 0; method < methodsCount; method++) {
+            fprintf(stderr, "%8zu %-20s %10.2f %10.2f %12.2f\n", bucketsCounts[method], METHODS[method], bytesPerKey[method],
+                    bestBuild[method], bestLookup[method]);
+            if (totalFound[method] != totalFound[0])
+                fprintf(stderr, "%s: found %jd keys instead of %jd\n", METHODS[method], totalFound[method], totalFound[0]);
+        }
+    }
+
+    free(found);
+    textDtor(&words);
+    textDtor(&requests);
+    #else
+    fprintf(stderr, "Comparison of set with table is implemented for HASH_TABLE_ARCH == 2 only\n");
+    #endif
+}
+
+/* Words of 16+ letters packed into short keys (v2_packedKeys) against the same words in array of long keys (v2_all).
+   Packing is timed alone on all occurrences of such words, lookups are timed on all words and on long words only */
+void testPackedKeys() {
+    static const char *const CORPORA[][2] = {{"shakespeare", "shakespeare.txt"}, {"tolkien", "tolkien.txt"}};
+    static const char *const POLICIES[] = {"v2_all", "v2_packedKeys"};
+
+    for (size_t corpusIdx = 0; corpusIdx < sizeof(CORPORA) / sizeof(CORPORA[0]); corpusIdx++) {
+        text_t words = readCorpusAligned(CORPORA[corpusIdx][1]);
+        if (!words.wordsCount) {
+            fprintf(stderr, "Skipping corpus %s\n", CORPORA[corpusIdx][0]);
+            continue;
+        }
+
+        // Occurrences of long words and unique words by the way they are stored
+        char **longWords = (char **) calloc((size_t) words.wordsCount, sizeof(char *));
+        char  *packed    = (char *)  aligned_alloc(KEY_ALIGNMENT, (size_t) words.wordsCount * SMALL_STR_LEN);
+        assert(longWords && packed);
+        int64_t longCount = 0, uniqueShort = 0, uniquePacked = 0, uniqueLong = 0;
+
+        hashTable_t unique = {};
+        hashTableCtor(&unique, 0, HASH_TABLE_SIZE);
+        for (int64_t idx = 0; idx < words.wordsCount; idx++) {
+            const size_t keyLen = strlen(words.words[idx]);
+            if (keyLen >= SMALL_STR_LEN)
+                longWords[longCount++] = words.words[idx];
+
+            const size_t sizeBefore = unique.size;
+            hashTableAccess(&unique, words.words[idx]);
+            if (unique.size == sizeBefore)
+                continue;
+            if (keyLen < SMALL_STR_LEN)
+                uniqueShort++;
+            else if (packKeyLetters(words.words[idx], keyLen, packed))
+                uniquePacked++;
+            else
+                uniqueLong++;
+        }
+        hashTableDtor(&unique);
+
+        const int64_t passes = longCount ? (PACKED_TEST_MIN_KEYS + longCount - 1) / longCount : 0;
+        const int64_t longLookupsCount = passes * longCount;
+        const double longLookups = (double) (longLookupsCount ? longLookupsCount : 1);
+
+        // Packed keys are stored, so packing can't be thrown away
+        double bestPackTicks = 0;
+        int64_t packedCount = 0;
+        for (int round = 0; round < POLICY_ROUNDS; round++) {
+            codeClock_t clock;
+            MEASURE_TIME(clock,
+                for (int64_t pass = 0; pass < passes; pass++) {
+                    packedCount = 0;
+                    for (int64_t idx = 0; idx < longCount; idx++)
+                        packedCount += packKeyLetters(longWords[idx], strlen(longWords[idx]),
+                                                      packed + packedCount * (int64_t) SMALL_STR_LEN);
+                }
+            )
+            const double packTicks = (double) (clock.clocksEnd - clock.clocksStart) / longLookups;
+            if (round == 0 || packTicks < bestPackTicks) bestPackTicks = packTicks;
+        }
+
+        const int64_t uniqueCount = uniqueShort + uniquePacked + uniqueLong;
+        fprintf(stderr, "%s: %jd words, %jd of them have %zu+ letters (%jd packed); unique %jd: %jd short, %jd packed, "
+                        "%jd long; kept in nodes %.2f%% -> %.2f%%, packing %.2f ticks/key\n",
+                CORPORA[corpusIdx][0], words.wordsCount, longCount, SMALL_STR_LEN, packedCount, uniqueCount,
+                uniqueShort, uniquePacked, uniqueLong, 100.0 * (double) uniqueShort / (double) uniqueCount,
+                100.0 * (double) (uniqueShort + uniquePacked) / (double) uniqueCount, bestPackTicks);
+        fprintf(stderr, "%-14s %10s %12s %14s\n", "policy", "build, ms", "ticks/word", "ticks/long word");
+
+        for (size_t policyIdx = 0; policyIdx < sizeof(POLICIES) / sizeof(POLICIES[0]); policyIdx++) {
+            hashTablePolicy_t *policy = hashTablePolicies();
+            while (policy && strcmp(policy->name, POLICIES[policyIdx]) != 0)
+                policy = policy->next;
+            if (!policy) {
+                fprintf(stderr, "Policy %s is not linked\n", POLICIES[policyIdx]);
+                continue;
+            }
+
+            double bestBuildMs = 0, bestWordTicks = 0, bestLongTicks = 0;
+            for (int round = 0; round < POLICY_ROUNDS; round++) {
+                // One bucket per key, as hashTableReserve gives
+                void *table = policy->ctor(sizeof(int), (size_t) uniqueCount);
+                assert(table);
+
+                codeClock_t clock;
+                MEASURE_TIME(clock,
+                    policy->accessAll(table, words.words, words.wordsCount);
+                )
+                const double buildMs = codeClockGetTimeMs(&clock);
+
+                int64_t found = 0;
+                MEASURE_TIME(clock,
+                    found = policy->findAll(table, words.words, words.wordsCount);
+                )
+                assert(found == words.wordsCount);
+                const double wordTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) words.wordsCount;
+
+                found = 0;
+                MEASURE_TIME(clock,
+                    for (int64_t pass = 0; pass < passes; pass++)
+                        found += policy->findAll(table, longWords, longCount);
+                )
+                assert(found == longLookupsCount);
+                const double longTicks = (double) (clock.clocksEnd - clock.clocksStart) / longLookups;
+
+                if (round == 0 || buildMs   < bestBuildMs)   bestBuildMs   = buildMs;
+                if (round == 0 || wordTicks < bestWordTicks) bestWordTicks = wordTicks;
+                if (round == 0 || longTicks < bestLongTicks) bestLongTicks = longTicks;
+
+                policy->dtor(table);
+            }
+            fprintf(stderr, "%-14s %10.2f %12.2f %14.2f\n", policy->name, bestBuildMs, bestWordTicks, bestLongTicks);
+        }
+
+        free(longWords);
+        free(packed);
+        textDtor(&words);
+    }
+}
+
+/// Bucket sizes produced by hashes: share of empty buckets, the biggest one, chi-squared against
+/// uniform distribution (about 1 per bucket for random hash), keys compared per hit and width of hash
+typedef struct {
+    double   emptyPercent;
+    uint32_t maxBucket;
+    double   chiSquared;
+    double   keysPerHit;
+    int      bits;
+} hashDispersion_t;
+
+static hashDispersion_t hashDispersion(const hash_t *hashes, int64_t count, size_t bucketsCount) {
+    uint32_t *sizes = (uint32_t *) calloc(bucketsCount, sizeof(uint32_t));
+    assert(sizes);
+
+    hash_t allBits = 0;
+    for (int64_t idx = 0; idx < count; idx++) {
+        sizes[hashes[idx] % bucketsCount]++;
+        allBits |= hashes[idx];
+    }
+
+    hashDispersion_t result = {};
+    const double expected = (double) count / (double) bucketsCount;
+    double comparedSum = 0;
+    size_t empty = 0;
+    for (size_t bucketIdx = 0; bucketIdx < bucketsCount; bucketIdx++) {
+        const double size = sizes[bucketIdx];
+        empty += (sizes[bucketIdx] == 0);
+        if (sizes[bucketIdx] > result.maxBucket)
+            result.maxBucket = sizes[bucketIdx];
+        result.chiSquared += (size - expected) * (size - expected) / expected;
+        // Hit of i-th key of the bucket compares i keys
+        comparedSum += size * (size + 1) / 2;
+    }
+    free(sizes);
+
+    result.emptyPercent = 100.0 * (double) empty / (double) bucketsCount;
+    result.chiSquared  /= (double) bucketsCount;
+    result.keysPerHit   = comparedSum / (double) count;
+    result.bits         = allBits ? 64 - __builtin_clzll(allBits) : 0;
+    return result;
+}
+
+/// @brief Dispersion of aligned short keys by fastCrc32_16 and aesHash16, one line for each
+static void printHashDispersion(const char *name, char *const *keys, int64_t count, size_t bucketsCount,
+                                const hashSeed_t *seed) {
+    hash_t *hashes = (hash_t *) calloc((size_t) count, sizeof(hash_t));
+    assert(hashes);
+
+    for (int hashIdx = 0; hashIdx < 2; hashIdx++) {
+        for (int64_t idx = 0; idx < count; idx++)
+            hashes[idx] = hashIdx ? aesHash16(keys[idx], seed) : fastCrc32_16(keys[idx]);
+
+        const hashDispersion_t dispersion = hashDispersion(hashes, count, bucketsCount);
+        fprintf(stderr, "%-12s %8jd %8zu %-13s %8.2f %6u %8.3f %9.3f %5d\n", name, count, bucketsCount,
+                hashIdx ? "aesHash16" : "fastCrc32_16", dispersion.emptyPercent, dispersion.maxBucket,
+                dispersion.chiSquared, dispersion.keysPerHit, dispersion.bits);
+    }
+
+    free(hashes);
+}
+
+/* Seeded AES hash against crc32 of the default build. Speed is measured on independent keys, as lookups of
+   different keys overlap. Dispersion is shown at one key per bucket (as after hashTableReserve) for words
+   and sequential keys, and for keys that all fall into bucket 0 of COLLISION_TEST_BUCKETS under crc32 */
+void testSeededHash() {
+    static const char *const CORPORA[][2] = {{"shakespeare", "shakespeare.txt"}, {"tolkien", "tolkien.txt"}};
+    static const char *const POLICIES[] = {"v2_all", "v2_seededHash"};
+    static const size_t LONG_KEY_LENGTHS[] = {16, 32, 64, 256};
+
+    hashSeed_t seed = {};
+    hashSeedInit(&seed);
+    volatile hash_t hashSink = 0;
+
+    // Keys of different lengths one after another: nothing is aligned but the first one
+    char *longKeys = (char *) malloc((size_t) SEEDED_TEST_KEYS * LONG_KEY_LENGTHS[3]);
+    assert(longKeys);
+    uint64_t state = 0x5EED;
+    for (size_t idx = 0; idx < (size_t) SEEDED_TEST_KEYS * LONG_KEY_LENGTHS[3]; idx++)
+        longKeys[idx] = (char) ('a' + xorshiftNext(&state) % 26);
+
+    fprintf(stderr, "%-12s %14s %14s\n", "key length", "fastCrc32", "aesHash");
+    for (size_t lenIdx = 0; lenIdx < sizeof(LONG_KEY_LENGTHS) / sizeof(LONG_KEY_LENGTHS[0]); lenIdx++) {
+        const size_t len = LONG_KEY_LENGTHS[lenIdx];
+        double bestCrcTicks = 0, bestAesTicks = 0;
+        for (int round = 0; round < POLICY_ROUNDS; round++) {
+            hash_t sum = 0;
+            codeClock_t clock;
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < SEEDED_TEST_KEYS; idx++)
+                    sum += fastCrc32(longKeys + (size_t) idx * len, len);
+            )
+            const double crcTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) SEEDED_TEST_KEYS;
+
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < SEEDED_TEST_KEYS; idx++)
+                    sum += aesHash(longKeys + (size_t) idx * len, len, &seed);
+            )
+            const double aesTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) SEEDED_TEST_KEYS;
+            hashSink = hashSink + sum;
+
+            if (round == 0 || crcTicks < bestCrcTicks) bestCrcTicks = crcTicks;
+            if (round == 0 || aesTicks < bestAesTicks) bestAesTicks = aesTicks;
+        }
+        fprintf(stderr, "%-12zu %14.2f %14.2f\n", len, bestCrcTicks, bestAesTicks);
+    }
+    free(longKeys);
+
+    fprintf(stderr, "%-12s %8s %8s %-13s %8s %6s %8s %9s %5s\n", "keys", "count", "buckets", "hash", "empty, %",
+            "max", "chi2/m", "keys/hit", "bits");
+
+    // Sequential keys differ in the last few chars only
+    char *sequential = (char *) aligned_alloc(KEY_ALIGNMENT, (size_t) SEEDED_TEST_KEYS * SMALL_STR_LEN);
+    char **sequentialKeys = (char **) calloc((size_t) SEEDED_TEST_KEYS, sizeof(char *));
+    assert(sequential && sequentialKeys);
+    memset(sequential, 0, (size_t) SEEDED_TEST_KEYS * SMALL_STR_LEN);
+    for (int64_t idx = 0; idx < SEEDED_TEST_KEYS; idx++) {
+        sequentialKeys[idx] = sequential + idx * (int64_t) SMALL_STR_LEN;
+        snprintf(sequentialKeys[idx], SMALL_STR_LEN, "k%07jd", idx);
+    }
+    printHashDispersion("sequential", sequentialKeys, SEEDED_TEST_KEYS, (size_t) SEEDED_TEST_KEYS, &seed);
+    free(sequentialKeys);
+    free(sequential);
+
+    // Flood: distinct random words picked by crc32 as testCollisions picks them
+    text_t candidates = generateRandomText(1, COLLISION_TEST_CANDIDATES, 0xC011);
+    assert(candidates.data);
+    hashTable_t unique = {};
+    hashTableCtor(&unique, 0, HASH_TABLE_SIZE);
+    char **flood = (char **) calloc((size_t) (2 * COLLISION_TEST_KEYS), sizeof(char *));
+    assert(flood);
+    int64_t floodCount = 0;
+    for (int64_t idx = 0; idx < COLLISION_TEST_CANDIDATES && floodCount < 2 * COLLISION_TEST_KEYS; idx++) {
+        char *word = candidates.data + idx * (int64_t) SMALL_STR_LEN;
+        if (fastCrc32_16(word) % COLLISION_TEST_BUCKETS != 0)
+            continue;
+
+        const size_t sizeBefore = unique.size;
+        hashTableAccess(&unique, word);
+        if (unique.size != sizeBefore)
+            flood[floodCount++] = word;
+    }
+    hashTableDtor(&unique);
+    printHashDispersion("flood", flood, floodCount, COLLISION_TEST_BUCKETS, &seed);
+    free(flood);
+    textDtor(&candidates);
+
+    for (size_t corpusIdx = 0; corpusIdx < sizeof(CORPORA) / sizeof(CORPORA[0]); corpusIdx++) {
+        text_t words = readCorpusAligned(CORPORA[corpusIdx][1]);
+        if (!words.wordsCount) {
+            fprintf(stderr, "Skipping corpus %s\n", CORPORA[corpusIdx][0]);
+            continue;
+        }
+
+        // Only short keys are hashed by the table, long ones live in array of long keys
+        char **shortWords  = (char **) calloc((size_t) words.wordsCount, sizeof(char *));
+        char **uniqueWords = (char **) calloc((size_t) words.wordsCount, sizeof(char *));
+        assert(shortWords && uniqueWords);
+        int64_t shortCount = 0, uniqueCount = 0;
+
+        unique = {};
+        hashTableCtor(&unique, 0, HASH_TABLE_SIZE);
+        for (int64_t idx = 0; idx < words.wordsCount; idx++) {
+            if (strlen(words.words[idx]) >= SMALL_STR_LEN)
+                continue;
+            shortWords[shortCount++] = words.words[idx];
+
+            const size_t sizeBefore = unique.size;
+            hashTableAccess(&unique, words.words[idx]);
+            if (unique.size != sizeBefore)
+                uniqueWords[uniqueCount++] = words.words[idx];
+        }
+        hashTableDtor(&unique);
+
+        printHashDispersion(CORPORA[corpusIdx][0], uniqueWords, uniqueCount, (size_t) uniqueCount, &seed);
+
+        double bestCrcTicks = 0, bestAesTicks = 0;
+        for (int round = 0; round < POLICY_ROUNDS; round++) {
+            hash_t sum = 0;
+            codeClock_t clock;
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < shortCount; idx++)
+                    sum += fastCrc32_16(shortWords[idx]);
+            )
+            const double crcTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) shortCount;
+
+            MEASURE_TIME(clock,
+                for (int64_t idx = 0; idx < shortCount; idx++)
+                    sum += aesHash16(shortWords[idx], &seed);
+            )
+            const double aesTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) shortCount;
+            hashSink = hashSink + sum;
+
+            if (round == 0 || crcTicks < bestCrcTicks) bestCrcTicks = crcTicks;
+            if (round == 0 || aesTicks < bestAesTicks) bestAesTicks = aesTicks;
+        }
+        fprintf(stderr, "%s: %jd short words, ticks/key: fastCrc32_16 %.2f, aesHash16 %.2f\n",
+                CORPORA[corpusIdx][0], shortCount, bestCrcTicks, bestAesTicks);
+
+        fprintf(stderr, "%-14s %10s %12s\n", "policy", "build, ms", "ticks/word");
+        for (size_t policyIdx = 0; policyIdx < sizeof(POLICIES) / sizeof(POLICIES[0]); policyIdx++) {
+            hashTablePolicy_t *policy = hashTablePolicies();
+            while (policy && strcmp(policy->name, POLICIES[policyIdx]) != 0)
+                policy = policy->next;
+            if (!policy) {
+                fprintf(stderr, "Policy %s is not linked\n", POLICIES[policyIdx]);
+                continue;
+            }
+
+            double bestBuildMs = 0, bestWordTicks = 0;
+            for (int round = 0; round < POLICY_ROUNDS; round++) {
+                void *table = policy->ctor(sizeof(int), (size_t) uniqueCount);
+                assert(table);
+
+                codeClock_t clock;
+                MEASURE_TIME(clock,
+                    policy->accessAll(table, words.words, words.wordsCount);
+                )
+                const double buildMs = codeClockGetTimeMs(&clock);
+
+                int64_t found = 0;
+                MEASURE_TIME(clock,
+                    found = policy->findAll(table, words.words, words.wordsCount);
+                )
+                assert(found == words.wordsCount);
+                const double wordTicks = (double) (clock.clocksEnd - clock.clocksStart) / (double) words.wordsCount;
+
+                if (round == 0 || buildMs   < bestBuildMs)   bestBuildMs   = buildMs;
+                if (round == 0 || wordTicks < bestWordTicks) bestWordTicks = wordTicks;
+
+                policy->dtor(table);
+            }
+            fprintf(stderr, "%-14s %10.2f %12.2f\n", policy->name, bestBuildMs, bestWordTicks);
+        }
+
+        free(shortWords);
+        free(uniqueWords);
+        textDtor(&words);
+    }
+}
+
+/* ========================== Benchmark harness scenarios ========================== */
+
+typedef struct {
+    text_t     *words;          ///< Words of the corpus, inserted into the table before lookups
+    char      **requests;       ///< Keys of lookup scenarios
+    char       *ops;            ///< Operations of mixed scenario (as in workload_t), NULL for finds only
+    int64_t     requestsCount;
+    hashTable_t table;
+} harnessScenario_t;
+
+static void harnessFillTable(harnessScenario_t *scenario) {
+    for (int64_t idx = 0; idx < scenario->words->wordsCount; idx++)
+        hashTableAccess(&scenario->table, scenario->words->words[idx]);
+}
+
+static void harnessSetupEmpty(void *ctx) {
+    harnessScenario_t *scenario = (harnessScenario_t *) ctx;
+    scenario->table = {};
+    hashTableCtor(&scenario->table, sizeof(int), HASH_TABLE_SIZE);
+}
+
+static void harnessSetupFilled(void *ctx) {
+    harnessSetupEmpty(ctx);
+    harnessFillTable((harnessScenario_t *) ctx);
+}
+
+static void harnessTeardown(void *ctx) {
+    hashTableDtor(&((harnessScenario_t *) ctx)->table);
+}
+
+static int64_t harnessRunBuild(void *ctx) {
+    harnessScenario_t *scenario = (harnessScenario_t *) ctx;
+    harnessFillTable(scenario);
+    return scenario->words->wordsCount;
+}
+
+static int64_t harnessRunRequests(void *ctx) {
+    harnessScenario_t *scenario = (harnessScenario_t *) ctx;
+    hashTable_t *table = &scenario->table;
+
+    for (int64_t idx = 0; idx < scenario->requestsCount; idx++) {
+        const char *key = scenario->requests[idx];
+        const char  op  = scenario->ops ? scenario->ops[idx] : 0;
+
+        if (op == WORKLOAD_INSERT) {
+            (*(int *) hashTableAccess(table, key))++;
+        } else if (op == WORKLOAD_ERASE) {
+            hashTableErase(table, key);
+        } else {
+            int *value = (int *) hashTableFind(table, key);
+            if (value)
+                (*value)++;
+        }
+    }
+
+    return scenario->requestsCount;
+}
+
+/// @brief Stream of keys: foundPart of them are words of the corpus (with their frequencies), others are gibberish
+static char **harnessRequests(const text_t *words, const text_t *gibberish, double foundPart, uint64_t *state) {
+    char **requests = (char **) calloc((size_t) HARNESS_REQUESTS, sizeof(char *));
+    assert(requests);
+
+    for (int64_t idx = 0; idx < HARNESS_REQUESTS; idx++) {
+        const double found = (double) (xorshiftNext(state) >> 11) * 0x1.0p-53;
+        const text_t *source = (found < foundPart) ? words : gibberish;
+        requests[idx] = source->words[xorshiftNext(state) % (uint64_t) source->wordsCount];
+    }
+
+    return requests;
+}
+
+static const char *harnessOption(const char *name, int argc, const char *argv[], const char *defaultValue) {
+    const size_t nameLen = strlen(name);
+    for (int idx = 0; idx < argc; idx++) {
+        if (strncmp(argv[idx], name, nameLen) == 0 && argv[idx][nameLen] == '=')
+            return argv[idx] + nameLen + 1;
+    }
+    return defaultValue;
+}
+
+/// @brief Switches of the default build as JSON object
+static void harnessConfigJson(char *buffer, size_t size) {
+    static const char *const SWITCHES[] = {
+    #ifdef FAST_STRCMP
+        "FAST_STRCMP",
+    #endif
+    #ifdef CMP_LEN_FIRST
+        "CMP_LEN_FIRST",
+    #endif
+    #ifdef ALIGNED_KEYS
+        "ALIGNED_KEYS",
+    #endif
+    #ifdef SHORT_VALUES_IN_NODE
+        "SHORT_VALUES_IN_NODE",
+    #endif
+    #ifdef FAST_CRC32
+        "FAST_CRC32",
+    #endif
+    #ifdef SELF_ORGANIZING_BUCKETS
+        "SELF_ORGANIZING_BUCKETS",
+    #endif
+    #ifdef HOT_KEY_CACHE
+        "HOT_KEY_CACHE",
+    #endif
+        NULL
+    };
+
+    int written = snprintf(buffer, size, "{\"arch\": %d, \"bucket_inline_nodes\": %d, \"table_size\": %d, \"switches\": [",
+                           HASH_TABLE_ARCH, BUCKET_INLINE_NODES, HASH_TABLE_SIZE);
+    for (int idx = 0; SWITCHES[idx] && written > 0 && (size_t) written < size; idx++)
+        written += snprintf(buffer + written, size - (size_t) written, "%s\"%s\"", idx ? ", " : "", SWITCHES[idx]);
+    if (written > 0 && (size_t) written < size)
+        snprintf(buffer + written, size - (size_t) written, "]}");
+}
+
+int testHarness(int argc, const char *argv[]) {
+    const int reps   = atoi(harnessOption("reps",   argc, argv, "11"));
+    const int warmup = atoi(harnessOption("warmup", argc, argv, "2"));
+    const int cpuArg = atoi(harnessOption("cpu",    argc, argv, "-1"));
+    const char *scenarioFilter = harnessOption("scenario", argc, argv, NULL);
+    const char *corpusFilter   = harnessOption("corpus",   argc, argv, NULL);
+    const char *jsonFile       = harnessOption("json",     argc, argv, NULL);
+
+    if (reps < 1 || reps > BENCH_MAX_REPS || warmup < 0) {
+        fprintf(stderr, "reps must be in [1, %d], warmup must be non-negative\n", BENCH_MAX_REPS);
+        return 1;
+    }
+
+    const int cpu = benchPinThread(cpuArg);
+    if (cpu < 0)
+        fprintf(stderr, "Failed to pin thread, running without affinity\n");
+
+    static const char *const CORPORA[][2] = {{"shakespeare", "shakespeare.txt"}, {"tolkien", "tolkien.txt"}};
+    static const char *const SCENARIOS[] = {"build", "hit", "miss-heavy", "mixed"};
+    const int corporaCount   = (int) (sizeof(CORPORA)   / sizeof(CORPORA[0]));
+    const int scenariosCount = (int) (sizeof(SCENARIOS) / sizeof(SCENARIOS[0]));
+
+    text_t gibberish = generateRandomText(HARNESS_GIBBERISH, HARNESS_GIBBERISH, 0x61BB);
+    assert(gibberish.words);
+
+    const int maxCases = corporaCount * scenariosCount;
+    text_t            *words     = (text_t *)            calloc((size_t) corporaCount, sizeof(text_t));
+    harnessScenario_t *scenarios = (harnessScenario_t *) calloc((size_t) maxCases, sizeof(harnessScenario_t));
+    benchCase_t       *cases     = (benchCase_t *)       calloc((size_t) maxCases, sizeof(benchCase_t));
+    benchResult_t     *results   = (benchResult_t *)     calloc((size_t) maxCases, sizeof(benchResult_t));
+    assert(words && scenarios && cases && results);
+
+    benchPrintHeader(stderr);
+
+    int casesCount = 0;
+    for (int corpusIdx = 0; corpusIdx < corporaCount; corpusIdx++) {
+        if (corpusFilter && strcmp(corpusFilter, CORPORA[corpusIdx][0]) != 0)
+            continue;
+
+        words[corpusIdx] = readCorpusAligned(CORPORA[corpusIdx][1]);
+        if (!words[corpusIdx].wordsCount) {
+            fprintf(stderr, "Skipping corpus %s\n", CORPORA[corpusIdx][0]);
+            continue;
+        }
+
+        for (int scenarioIdx = 0; scenarioIdx < scenariosCount; scenarioIdx++) {
+            const char *name = SCENARIOS[scenarioIdx];
+            if (scenarioFilter && strcmp(scenarioFilter, name) != 0)
+                continue;
+
+            // Streams depend only on corpus and scenario, so they are the same in every version of the table
+            uint64_t state = 0x4A55 + (uint64_t) (corpusIdx * scenariosCount + scenarioIdx);
+            harnessScenario_t *scenario = scenarios + casesCount;
+            benchCase_t *benchCase = cases + casesCount;
+            scenario->words = words + corpusIdx;
+
+            *benchCase = {name, CORPORA[corpusIdx][0], harnessSetupFilled, harnessRunRequests, harnessTeardown, scenario};
+
+            if (strcmp(name, "build") == 0) {
+                benchCase->setup = harnessSetupEmpty;
+                benchCase->run   = harnessRunBuild;
+            } else if (strcmp(name, "hit") == 0) {
+                scenario->requests = harnessRequests(scenario->words, &gibberish, 1, &state);
+            } else if (strcmp(name, "miss-heavy") == 0) {
+                scenario->requests = harnessRequests(scenario->words, &gibberish, HARNESS_MISS_HEAVY_FOUND, &state);
+            } else {
+                scenario->requests = harnessRequests(scenario->words, &gibberish, HARNESS_MIXED_FOUND, &state);
+                scenario->ops = (char *) calloc((size_t) HARNESS_REQUESTS, 1);
+                assert(scenario->ops);
+                for (int64_t idx = 0; idx < HARNESS_REQUESTS; idx++) {
+                    const double opRand = (double) (xorshiftNext(&state) >> 11) * 0x1.0p-53;
+                    scenario->ops[idx] = (opRand < HARNESS_MIXED_INSERT) ? WORKLOAD_INSERT :
+                                         (opRand < HARNESS_MIXED_INSERT + HARNESS_MIXED_ERASE) ? WORKLOAD_ERASE : 0;
+                }
+            }
+            scenario->requestsCount = scenario->requests ? HARNESS_REQUESTS : 0;
+
+            benchRun(benchCase, warmup, reps, results + casesCount);
+            benchPrintResult(stderr, results + casesCount);
+            casesCount++;
+        }
+    }
+
+    int status = 0;
+    if (jsonFile) {
+        char config[512] = "";
+        harnessConfigJson(config, sizeof(config));
+        status = benchWriteJson(jsonFile, config, cpu, results, casesCount) ? 0 : 1;
+    }
+
+    for (int caseIdx = 0; caseIdx < casesCount; caseIdx++) {
+        free(scenarios[caseIdx].requests);
+        free(scenarios[caseIdx].ops);
+    }
+    for (int corpusIdx = 0; corpusIdx < corporaCount; corpusIdx++)
+        textDtor(words + corpusIdx);
+    textDtor(&gibberish);
+    free(words);
+    free(scenarios);
+    free(cases);
+    free(results);
+
+    return status;
+}
+
 /* Wrapper for testRequests that loads test data from given files */
 void testPerformance(const char *stringsFile, const char *requestsFile, bool printLess) {
 
@@ -68,12 +2167,20 @@ void testPerformance(const char *stringsFile, const char *requestsFile, bool pri
     HDBG(ht.printElem = printInt;)
 
     codeClock_t clock;
+    // Every phase has its own counter group, so file parsing and build don't get into lookup numbers
+    perfCounters_t counters;
+    perfCountersOpen(&counters);
 
+    MEASURE_COUNTERS(counters,
     MEASURE_TIME(clock,
         for (int idx = 0; idx < words.wordsCount; idx++) {
             hashTableAccess(&ht, words.words[idx]); // inserting default values: 0
         }
     )
+    )
+    if (!printLess)
+        perfCountersPrint(stderr, "Build", &counters, words.wordsCount);
+    perfCountersClose(&counters);
 
     hashTableVerify(&ht);
     // hashTableDump(&ht);
@@ -93,7 +2200,11 @@ void testPerformance(const char *stringsFile, const char *requestsFile, bool pri
 
     /* ======================= Main test  ========================================== */
 
-    int64_t totalFound = testRequests(&ht, requests, &clock);
+    perfCountersOpen(&counters);
+    int64_t totalFound = 0;
+    MEASURE_COUNTERS(counters,
+        totalFound = testRequests(&ht, requests, &clock);
+    )
 
     double avgTicksPerFind = (double)(clock.clocksEnd - clock.clocksStart) / (double) (requests.wordsCount * TEST_LOOPS);
     double timeInMs = codeClockGetTimeMs(&clock);
@@ -104,9 +2215,11 @@ void testPerformance(const char *stringsFile, const char *requestsFile, bool pri
 
         fprintf(stderr, "Total requests: %ji, succesfull searches: %ji\n",
                                             requests.wordsCount,                totalFound);
+        perfCountersPrint(stderr, "Lookups", &counters, requests.wordsCount * TEST_LOOPS);
     } else {
         fprintf(stderr, "%.2f %.2f\n", timeInMs, avgTicksPerFind);
     }
+    perfCountersClose(&counters);
 
     // hashTableDump(&ht);
 
@@ -116,18 +2229,42 @@ void testPerformance(const char *stringsFile, const char *requestsFile, bool pri
 
         #if HASH_TABLE_ARCH == 2
         for (size_t bidx = 0; bidx < ht.bucketsCount; bidx++) {
-            hashTableBucket_t bucket = ht.buckets[bidx];
-            for (size_t idx = 0; idx < bucket.size; idx++) {
-                hashTableNode_t *node = bucket.elements+idx;
-                fprintf(result, "%s %d\n", (const char *)&node->key.MM, *(int *)getValueFromNode(&ht, node));
+            hashTableBucket_t *bucket = ht.buckets + bidx;
+            for (size_t idx = 0; idx < bucket->size; idx++) {
+                hashTableNode_t *node = bucketGetNode(bucket, idx);
+                const char *key = (const char *)&node->key.MM;
+                #ifdef PACKED_KEYS
+                char letters[PACKED_KEY_MAX_LEN + 1];
+                if (isPackedKey(key)) {
+                    unpackKeyLetters(key, letters);
+                    key = letters;
+                }
+                #endif
+                fprintf(result, "%s %d\n", key, *(int *)getValueFromNode(&ht, node));
             }
         }
 
-        hashTableBucket_t bucket = ht.longKeys;
-        for (size_t idx = 0; idx < bucket.size; idx++) {
-            hashTableNode_t *node = bucket.elements+idx;
+        hashTableBucket_t *bucket = &ht.longKeys;
+        for (size_t idx = 0; idx < bucket->size; idx++) {
+            hashTableNode_t *node = bucketGetNode(bucket, idx);
             fprintf(result, "%s %d\n", node->key.Ptr, *(int *)getValueFromNode(&ht, node));
         }
+        #elif HASH_TABLE_ARCH == 3
+        for (size_t bidx = 0; bidx < ht.bucketsCount; bidx++) {
+            const char *bucket = (const char *) ht.buckets + bidx * ht.bucketStride;
+            for (size_t idx = 0; idx < CUCKOO_SLOTS; idx++) {
+                const cuckooSlot_t *slot = ((const cuckooBucket_t *) bucket)->slots + idx;
+                const char *key = cuckooSlotIsLong(slot) ? slot->longKey.ptr : (const char *) &slot->MM;
+                if (*key)
+                    fprintf(result, "%s %d\n", key, *(const int *) (bucket + sizeof(cuckooBucket_t) + idx * ht.valSize));
+            }
+        }
+
+        for (size_t idx = 0; idx < ht.stashSize; idx++) {
+            const cuckooSlot_t *slot = ht.stash + idx;
+            const char *key = cuckooSlotIsLong(slot) ? slot->longKey.ptr : (const char *) &slot->MM;
+            fprintf(result, "%s %d\n", key, *(const int *) (ht.stashValues + idx * ht.valSize));
+        }
         #else
         for (size_t bidx = 0; bidx < ht.bucketsCount; bidx++) {
             hashTableNode_t *node = ht.buckets[bidx].next;
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
+#include <math.h>
 
 #include <perfTester.h>
 #include <hashTable.h>
@@ -90,6 +91,151 @@ text_t readFileSplitAligned(const char *fileName) {
     return result;
 }
 
+text_t readCorpusAligned(const char *fileName) {
+    text_t result = {0};
+
+    FILE *file = fopen(fileName, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", fileName);
+        return result;
+    }
+
+    const int64_t length = getFileLen(file);
+    if (length < 0) {
+        fprintf(stderr, "File is broken: non-positive length\n");
+        fclose(file);
+        return result;
+    }
+
+    char *text = (char *) calloc((size_t) length + 1, 1); // last byte serves as terminator
+    // Every word takes at least one letter and one separator: length / 2 + 1 words at most
+    const int64_t maxWords = length / 2 + 1;
+    char **words     = (char **) calloc((size_t) maxWords, sizeof(char *));
+    char  *wordsData = (char *)  aligned_alloc(KEY_ALIGNMENT, KEY_ALIGNMENT * ((size_t) length / KEY_ALIGNMENT + (size_t) maxWords + 1));
+    if (!text || !words || !wordsData) {
+        free(text); free(words); free(wordsData);
+        fprintf(stderr, "Failed to allocate memory for %s\n", fileName);
+        fclose(file);
+        return result;
+    }
+
+    size_t bytesRead = fread(text, 1, (size_t) length, file);
+    assert(bytesRead == (size_t) length);
+    fclose(file);
+
+    // Words are runs of letters in lower case, as in scripts/prepareText.c
+    int64_t wordCount = 0;
+    char *textPtr = text, *wordsPtr = wordsData;
+    while (*textPtr) {
+        while (*textPtr && !isalpha((unsigned char) *textPtr)) textPtr++;
+
+        int64_t wordLen = 0;
+        while (isalpha((unsigned char) textPtr[wordLen])) {
+            wordsPtr[wordLen] = (char) tolower((unsigned char) textPtr[wordLen]);
+            wordLen++;
+        }
+        if (wordLen == 0)
+            break;
+
+        words[wordCount++] = wordsPtr;
+        const int64_t wordsShift = (int64_t) KEY_ALIGNMENT * ((wordLen + 1 + (int64_t) KEY_ALIGNMENT - 1) / (int64_t) KEY_ALIGNMENT);
+        memset(wordsPtr + wordLen, 0, (size_t) (wordsShift - wordLen));
+        wordsPtr += wordsShift;
+        textPtr  += wordLen;
+    }
+
+    free(text);
+
+    result.data       = wordsData;
+    result.length     = wordsPtr - wordsData;
+    result.words      = words;
+    result.wordsCount = wordCount;
+
+    return result;
+}
+
+workload_t readWorkload(const char *fileName) {
+    workload_t result = {};
+
+    FILE *file = fopen(fileName, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", fileName);
+        return result;
+    }
+
+    const int64_t length = getFileLen(file);
+    if (length < 0) {
+        fprintf(stderr, "File is broken: non-positive length\n");
+        fclose(file);
+        return result;
+    }
+
+    char *text = (char *) calloc((size_t) length + 1, 1); // last byte serves as terminator
+    if (!text) {
+        fprintf(stderr, "Failed to allocate memory for %s\n", fileName);
+        fclose(file);
+        return result;
+    }
+    size_t bytesRead = fread(text, 1, (size_t) length, file);
+    assert(bytesRead == (size_t) length);
+    fclose(file);
+
+    int64_t linesCount = 1;
+    for (int64_t idx = 0; idx < length; idx++)
+        linesCount += (text[idx] == '\n');
+
+    // Every key is padded to the aligned block: at most KEY_ALIGNMENT extra bytes per line
+    // (size passed to aligned_alloc must be multiple of alignment)
+    const size_t dataSize = KEY_ALIGNMENT * ((size_t) length / KEY_ALIGNMENT + (size_t) linesCount + 1);
+    char **words     = (char **) calloc((size_t) linesCount, sizeof(char *));
+    char  *ops       = (char *)  calloc((size_t) linesCount, 1);
+    char  *wordsData = (char *)  aligned_alloc(KEY_ALIGNMENT, dataSize);
+    if (!words || !ops || !wordsData) {
+        free(text); free(words); free(ops); free(wordsData);
+        fprintf(stderr, "Failed to allocate memory for %s\n", fileName);
+        return result;
+    }
+
+    int64_t wordCount = 0;
+    char *textPtr = text, *wordsPtr = wordsData;
+    while (*textPtr) {
+        char op = 0;
+        if (*textPtr == WORKLOAD_INSERT || *textPtr == WORKLOAD_ERASE)
+            op = *textPtr++;
+
+        int64_t wordLen = 0;
+        while (textPtr[wordLen] && !isspace(textPtr[wordLen])) wordLen++;
+
+        if (wordLen > 0) {
+            ops[wordCount] = op;
+            words[wordCount++] = wordsPtr;
+            memcpy(wordsPtr, textPtr, (size_t) wordLen);
+
+            const int64_t wordsShift = (int64_t) KEY_ALIGNMENT * ((wordLen + 1 + (int64_t) KEY_ALIGNMENT - 1) / (int64_t) KEY_ALIGNMENT);
+            memset(wordsPtr + wordLen, 0, (size_t) (wordsShift - wordLen));
+            wordsPtr += wordsShift;
+        }
+
+        textPtr += wordLen;
+        while (*textPtr && isspace(*textPtr)) textPtr++;
+    }
+
+    free(text);
+
+    result.keys.data       = wordsData;
+    result.keys.length     = wordsPtr - wordsData;
+    result.keys.words      = words;
+    result.keys.wordsCount = wordCount;
+    result.ops = ops;
+
+    return result;
+}
+
+void workloadDtor(workload_t *workload) {
+    textDtor(&workload->keys);
+    free(workload->ops); workload->ops = NULL;
+}
+
 text_t readFileSplitUnaligned(const char *fileName) {
     text_t result = {0};
 
@@ -142,4 +288,119 @@ text_t readFileSplitUnaligned(const char *fileName) {
     result.words = words;
 
     return result;
-}
\ No newline at end of file
+}
+
+/* ========================== Synthetic texts ==================== */
+
+uint64_t xorshiftNext(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+/// @brief Vocabulary of random words (3-14 letters), each in its own aligned zero-padded block
+static char *generateVocabulary(int64_t vocabulary, uint64_t *state) {
+    // Every word of vocabulary is shorter than SMALL_STR_LEN and occupies one aligned block
+    char *wordsData = (char *) aligned_alloc(KEY_ALIGNMENT, (size_t) vocabulary * SMALL_STR_LEN);
+    if (!wordsData)
+        return NULL;
+    memset(wordsData, 0, (size_t) vocabulary * SMALL_STR_LEN);
+
+    for (int64_t idx = 0; idx < vocabulary; idx++) {
+        char *word = wordsData + idx * (int64_t) SMALL_STR_LEN;
+        const uint64_t len = RANDOM_WORD_MIN_LEN + xorshiftNext(state) % (RANDOM_WORD_MAX_LEN - RANDOM_WORD_MIN_LEN + 1);
+        for (uint64_t charIdx = 0; charIdx < len; charIdx++)
+            word[charIdx] = (char) ('a' + xorshiftNext(state) % 26);
+    }
+
+    return wordsData;
+}
+
+text_t generateRandomText(int64_t wordsCount, int64_t vocabulary, uint64_t seed) {
+    assert(wordsCount > 0);
+    assert(vocabulary > 0);
+
+    text_t result = {0};
+    uint64_t state = seed | 1;
+
+    char  *wordsData = generateVocabulary(vocabulary, &state);
+    char **words     = (char **) calloc((size_t) wordsCount, sizeof(char *));
+    if (!wordsData || !words) {
+        free(wordsData); free(words);
+        fprintf(stderr, "Failed to allocate memory for random text\n");
+        return result;
+    }
+
+    for (int64_t idx = 0; idx < wordsCount; idx++)
+        words[idx] = wordsData + (int64_t) (xorshiftNext(&state) % (uint64_t) vocabulary) * (int64_t) SMALL_STR_LEN;
+
+    result.data = wordsData;
+    result.length = vocabulary * (int64_t) SMALL_STR_LEN;
+    result.words = words;
+    result.wordsCount = wordsCount;
+
+    return result;
+}
+
+text_t generateZipfText(int64_t wordsCount, int64_t vocabulary, double exponent, uint64_t seed) {
+    assert(wordsCount > 0);
+    assert(vocabulary > 0);
+    assert(exponent >= 0);
+
+    text_t result = {0};
+    uint64_t state = seed | 1;
+
+    char    *wordsData = generateVocabulary(vocabulary, &state);
+    char   **words     = (char **)   calloc((size_t) wordsCount, sizeof(char *));
+    double  *cdf       = (double *)  calloc((size_t) vocabulary, sizeof(double));
+    int64_t *wordOfRank = (int64_t *) calloc((size_t) vocabulary, sizeof(int64_t));
+    if (!wordsData || !words || !cdf || !wordOfRank) {
+        free(wordsData); free(words); free(cdf); free(wordOfRank);
+        fprintf(stderr, "Failed to allocate memory for random text\n");
+        return result;
+    }
+
+    // P(rank) ~ 1 / (rank + 1)^exponent
+    double total = 0;
+    for (int64_t rank = 0; rank < vocabulary; rank++) {
+        total += pow((double) (rank + 1), -exponent);
+        cdf[rank] = total;
+    }
+
+    // Ranks are shuffled, so frequent words are spread over the vocabulary (and its insertion order)
+    for (int64_t idx = 0; idx < vocabulary; idx++)
+        wordOfRank[idx] = idx;
+    for (int64_t idx = vocabulary - 1; idx > 0; idx--) {
+        const int64_t swapIdx = (int64_t) (xorshiftNext(&state) % (uint64_t) (idx + 1));
+        const int64_t tmp = wordOfRank[idx];
+        wordOfRank[idx] = wordOfRank[swapIdx];
+        wordOfRank[swapIdx] = tmp;
+    }
+
+    for (int64_t idx = 0; idx < wordsCount; idx++) {
+        // 53 random bits -> uniform double in [0, total)
+        const double point = (double) (xorshiftNext(&state) >> 11) * 0x1.0p-53 * total;
+
+        int64_t left = 0, right = vocabulary - 1;
+        while (left < right) {
+            const int64_t mid = (left + right) / 2;
+            if (cdf[mid] <= point) left = mid + 1;
+            else                   right = mid;
+        }
+
+        words[idx] = wordsData + wordOfRank[left] * (int64_t) SMALL_STR_LEN;
+    }
+
+    free(cdf);
+    free(wordOfRank);
+
+    result.data = wordsData;
+    result.length = vocabulary * (int64_t) SMALL_STR_LEN;
+    result.words = words;
+    result.wordsCount = wordsCount;
+
+    return result;
+}